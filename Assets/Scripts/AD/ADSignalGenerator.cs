@@ -26,6 +26,7 @@
 // limitations under the License.
 
 using UnityEngine;
+using System;
 using System.Collections;
 using System.Runtime.InteropServices;
 
@@ -46,15 +47,23 @@ public class ADSignalGenerator : signalGenerator
     int minRelease;
     int maxRelease;
 
-    // inner state
+    // inner state, mirrored from the native envelope after every buffer; set from outside, it is handed back at the
+    // start of the next buffer
     bool isRunning = false;
     int stage = 0;
     int counter = 0;
     float glidedVal = 0f;
-    public bool IsRunning { get => isRunning; set => isRunning = value; }
-    public int Stage { get => stage; set => stage = value; }
-    public int Counter { get => counter; set => counter = value; }
-    public float GlidedVal { get => glidedVal; set => glidedVal = value; }
+    bool statePending = false;
+    public bool IsRunning { get => isRunning; set { isRunning = value; statePending = true; } }
+    public int Stage { get => stage; set { stage = value; statePending = true; } }
+    public int Counter { get => counter; set { counter = value; statePending = true; } }
+    public float GlidedVal { get => glidedVal; set { glidedVal = value; statePending = true; } }
+
+    // attack to 1 and decay to 0, both power curves with the linearity as exponent
+    const int ENVELOPE_POWER = 1;
+    const int ENVELOPE_NOSUSTAIN = -1;
+    const int ENVELOPE_IDLE = -1;
+    IntPtr x;
 
 
     float[] pulseBuffer = new float[] { -1, -1 };
@@ -69,6 +78,15 @@ public class ADSignalGenerator : signalGenerator
         maxAttack = Mathf.RoundToInt(20.000f * AudioSettings.outputSampleRate);
         minRelease = Mathf.RoundToInt(0.010f * AudioSettings.outputSampleRate);
         maxRelease = Mathf.RoundToInt(20.000f * AudioSettings.outputSampleRate);
+
+        x = Envelope_New();
+        Envelope_SetSegments(new int[] { minAttack, minRelease }, new float[] { 1f, 0f }, new float[] { 1f, 1f },
+            new int[] { ENVELOPE_POWER, ENVELOPE_POWER }, 2, ENVELOPE_NOSUSTAIN, x);
+    }
+
+    private void OnDestroy()
+    {
+        Envelope_Free(x);
     }
 
     public void setAttack(float val)
@@ -105,15 +123,48 @@ public class ADSignalGenerator : signalGenerator
     [DllImport("OSLNative")]
     public static extern void SetArrayToSingleValue(float[] a, int length, float val);
 
-    float prevLinearityA = 1f;
-    float prevLinearityD = 1f;
-    int prevAttackLengthFinal = 0;
-    int prevReleaseLengthFinal = 0;
+    [DllImport("OSLNative")]
+    private static extern IntPtr Envelope_New();
+
+    [DllImport("OSLNative")]
+    private static extern void Envelope_Free(IntPtr x);
+
+    [DllImport("OSLNative")]
+    private static extern int Envelope_Process(float[] buffer, int length, int channels, float[] gate, IntPtr x);
+
+    [DllImport("OSLNative")]
+    private static extern void Envelope_SetSegments(int[] frames, float[] targets, float[] curves, int[] shapes, int numSegments, int sustain, IntPtr x);
+
+    [DllImport("OSLNative")]
+    private static extern void Envelope_SetSegment(int index, int frames, float target, float curve, int shape, IntPtr x);
+
+    [DllImport("OSLNative")]
+    private static extern int Envelope_GetStage(IntPtr x);
+
+    [DllImport("OSLNative")]
+    private static extern float Envelope_GetLevel(IntPtr x);
+
+    [DllImport("OSLNative")]
+    private static extern int Envelope_GetElapsed(IntPtr x);
+
+    [DllImport("OSLNative")]
+    private static extern void Envelope_SetState(int stage, int elapsed, float level, IntPtr x);
+
+    float prevLinearityA = -1f;
+    float prevLinearityD = -1f;
+    int prevAttackLengthFinal = -1;
+    int prevReleaseLengthFinal = -1;
 
     public override void processBufferImpl(float[] buffer, double dspTime, int channels)
     {
         if (!recursionCheckPre()) return; // checks and avoids fatal recursions
 
+        if (statePending)
+        {
+            statePending = false;
+            Envelope_SetState(isRunning ? stage : ENVELOPE_IDLE, counter, glidedVal, x);
+        }
+
         if (incoming != null)
         {
             if (pulseBuffer.Length != buffer.Length)
@@ -151,83 +202,31 @@ public class ADSignalGenerator : signalGenerator
             releaseLengthFinal = releaseLength;
         }
 
-
-        for (int n = 0; n < buffer.Length; n += 2)
+        // PLEASE NOTE: the CV inputs are only sampled on the first sample of the buffer, see above. A running segment
+        // continues from its current level and ends after the new length.
+        if (attackLengthFinal != prevAttackLengthFinal || linearityA != prevLinearityA)
         {
-
-            // SHOULD BE NATIVE
-            if (incoming != null)
-            {
-                // this trigger implementation is good practice, carry over to other modules
-                if (pulseBuffer[n] > 0f && lastPulseFloat <= 0f)
-                { // left only
-                    counter = 0;
-                    stage = 0;
-                    isRunning = true;
-                }
-                lastPulseFloat = pulseBuffer[n];
-            }
-
-            // SHOULD BE NATIVE
-            if (isRunning)
-            {
-
-                if (stage == 0)
-                {
-                    // need speed up with pre-calculated lookups at some point?
-                    // PLEASE NOTE: this lerp interpolation here is also smoothing A and D changes that come via the CV inputs. Additionally, these inputs are only sampled on the first sample of the buffer, see above. But then again, audio rate modulation probably doesn't make much sense here anyways.
-                    buffer[n] = buffer[n + 1] = Mathf.Pow((float)counter / (prevAttackLengthFinal == attackLengthFinal ? (float)attackLengthFinal : Mathf.Lerp(prevAttackLengthFinal, attackLengthFinal, (float)n / buffer.Length)),
-                    prevLinearityA == linearityA ? linearityA : Mathf.Lerp(prevLinearityA, linearityA, (float)n / buffer.Length));
-
-                    counter++;
-                    if (counter > attackLengthFinal)
-                    {
-                        stage = 1;
-                        counter = 0;
-                    }
-                }
-                else if (stage == 1)
-                {
-                    buffer[n] = buffer[n + 1] = Mathf.Pow(1f - (float)counter / (prevReleaseLengthFinal == releaseLengthFinal ? (float)releaseLengthFinal : Mathf.Lerp(prevReleaseLengthFinal, releaseLengthFinal, (float)n / buffer.Length)),
-                    prevLinearityD == linearityD ? linearityD : Mathf.Lerp(prevLinearityD, linearityD, (float)n / buffer.Length));
-                    counter++;
-                    if (counter > releaseLengthFinal)
-                    {
-                        stage = 0;
-                        counter = 0;
-                        isRunning = false;
-                    }
-                }
-
-            }
-            else
-            {
-                SetArrayToSingleValue(buffer, buffer.Length, 0f);
-            }
-
-            // hotfix for occasional NaNs that crash other devices. occurs when linearity != 1
-            if (System.Single.IsNaN(buffer[n]))
-            {
-                buffer[n] = buffer[n + 1] = 0f;
-            }
-
-            // hotfix for when attack is modulated and glidedVal is stalled as NaN
-            if (System.Single.IsNaN(glidedVal))
-            {
-                glidedVal = 0f;
-            }
-
-            glidedVal += (buffer[n] - glidedVal) * 1f; // seems to smooth via float rounding error
-            buffer[n] = buffer[n + 1] = glidedVal;
-
-            prevLinearityA = linearityA;
-            prevLinearityD = linearityD;
+            Envelope_SetSegment(0, Mathf.Max(attackLengthFinal, minAttack), 1f, linearityA, ENVELOPE_POWER, x);
             prevAttackLengthFinal = attackLengthFinal;
+            prevLinearityA = linearityA;
+        }
+        if (releaseLengthFinal != prevReleaseLengthFinal || linearityD != prevLinearityD)
+        {
+            Envelope_SetSegment(1, Mathf.Max(releaseLengthFinal, minRelease), 0f, linearityD, ENVELOPE_POWER, x);
             prevReleaseLengthFinal = releaseLengthFinal;
-
+            prevLinearityD = linearityD;
         }
+
+        // rising edges of the incoming signal trigger at their exact sample
+        Envelope_Process(buffer, buffer.Length, channels, incoming != null ? pulseBuffer : null, x);
+
+        int s = Envelope_GetStage(x);
+        isRunning = s != ENVELOPE_IDLE;
+        stage = isRunning ? s : 0;
+        counter = Envelope_GetElapsed(x);
+        glidedVal = Envelope_GetLevel(x);
+
         recursionCheckPost();
     }
 
 }
-
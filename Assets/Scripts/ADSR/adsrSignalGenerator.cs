@@ -53,6 +53,7 @@
 // limitations under the License.
 
 using UnityEngine;
+using System;
 using System.Collections;
 using System.Collections.Generic;
 using System.Runtime.InteropServices;
@@ -63,27 +64,47 @@ public class adsrSignalGenerator : signalGenerator
     public float[] volumes = new float[] { 1, 0.8f };
     public bool active = false;
 
-    int[] frames = new int[] { 1, 1, 1, 1 };
+    // attack, decay and release segments of the native envelope, which holds the decay target while the gate is on.
+    // Unlike the former generator, a retrigger continues from the current level instead of restarting from 0, and
+    // there is no smoother on the output: instead, every segment lasts at least MIN_SEGMENT_TIME, so that the shortest
+    // attacks and releases don't click.
+    const int SUSTAIN_SEGMENT = 1;
+    const float MIN_SEGMENT_TIME = 0.001f; // in seconds
+    int[] frames = new int[] { 1, 1, 1 };
+    float[] targets = new float[] { 1, 0.8f, 0 };
 
-    float[] lastDur = new float[] { 0, 0, 0 };
-    float[] lastVol = new float[] { 0, 0 };
-    float ADSRvolume = -1;
+    float[] lastDur = new float[] { -1, -1, -1 };
+    float[] lastVol = new float[] { -1, -1 };
 
     public bool sustaining = false;
-    float sustainTime = 0;
-    double _lastPhase = 0;
+    bool lastSustaining = false;
 
     float[] pulseBuffer;
 
     public signalGenerator incoming;
     public adsrDeviceInterface _devinterface;
 
-    [DllImport("OSLNative", EntryPoint = "ADSRSignalGenerator")]
-    public static extern void ADSRSignalGenerator(float[] buffer, int length, int channels, int[] frames, ref int frameCount, bool active, ref float ADSRvolume,
-    float[] volumes, float startVal, ref int curFrame, bool sustaining);
+    private IntPtr x;
 
     [DllImport("OSLNative")]
-    public static extern bool GetBinaryState(float[] buffer, int length, int channels, ref float lastBuf);
+    private static extern IntPtr Envelope_New();
+
+    [DllImport("OSLNative")]
+    private static extern void Envelope_Free(IntPtr x);
+
+    [DllImport("OSLNative")]
+    private static extern int Envelope_Process(float[] buffer, int length, int channels, float[] gate, IntPtr x);
+
+    [DllImport("OSLNative")]
+    private static extern void Envelope_SetSegments(int[] frames, float[] targets, float[] curves, int[] shapes, int numSegments, int sustain, IntPtr x);
+
+    [DllImport("OSLNative")]
+    private static extern void Envelope_SetGate([MarshalAs(UnmanagedType.I1)] bool on, IntPtr x);
+
+    [DllImport("OSLNative")]
+    private static extern int Envelope_GetStage(IntPtr x);
+
+    const int ENVELOPE_IDLE = -1;
 
     [DllImport("OSLNative")]
     public static extern void SetArrayToSingleValue(float[] a, int length, float val);
@@ -92,33 +113,22 @@ public class adsrSignalGenerator : signalGenerator
     {
         base.Awake();
         pulseBuffer = new float[MAX_BUFFER_LENGTH];
+        x = Envelope_New();
     }
 
+    private void OnDestroy()
+    {
+        Envelope_Free(x);
+    }
+
+    // the gate is handed to the envelope at the start of the next buffer, on the audio thread
     public void hit(bool on)
     {
         if (on == sustaining) return;
-
-        if (on)
-        {
-            active = true;
-            _phase = 0;
-            sustainTime = 0;
-
-            startVal = 0;
-
-            adsrValUpdate();
-
-            curFrame = 0;
-            frameCount = 0;
-        }
-        else if (curFrame == 0 && frameCount == 0) active = false;
-
+        if (on) active = true;
         sustaining = on;
     }
 
-    float startVal = 0;
-    float lastPulseFloat = 0;
-
     void adsrValUpdate()
     {
         bool unchanged = true;
@@ -142,51 +152,27 @@ public class adsrSignalGenerator : signalGenerator
 
         if (!unchanged)
         {
-            frames[0] = Mathf.RoundToInt(durations[0] * (float)_sampleRate);
-            frames[1] = Mathf.RoundToInt(durations[1] * (float)_sampleRate);
-            frames[3] = Mathf.RoundToInt(durations[2] * (float)_sampleRate);
-
-            if (frames[0] == 0) frames[0] = 1;
-            if (frames[1] == 0) frames[1] = 1;
-            if (frames[3] == 0) frames[3] = 1;
-        }
-    }
-
-    float getADSR()
-    {
-        switch (curFrame)
-        {
-            case 0:
-                return startVal + (volumes[0] - startVal) * frameCount / frames[0];
-
-            case 1:
-                return volumes[0] + (volumes[1] - volumes[0]) * (float)frameCount / (float)frames[1];
-
-            case 2:
-                return volumes[1];
-
-            case 3:
-                return volumes[1] * (1f - (float)frameCount / (float)frames[3]);
-            case 4:
-                return 0;
-            default:
-                break;
+            int minFrames = Mathf.Max(1, Mathf.RoundToInt(MIN_SEGMENT_TIME * (float)_sampleRate));
+            for (int i = 0; i < 3; i++)
+                frames[i] = Mathf.Max(minFrames, Mathf.RoundToInt(durations[i] * (float)_sampleRate));
+            targets[0] = volumes[0];
+            targets[1] = volumes[1];
+
+            // a running envelope continues from its current level
+            Envelope_SetSegments(frames, targets, null, null, 3, SUSTAIN_SEGMENT, x);
         }
-        return 0;
     }
 
-    float lastBuffer = -1;
-    int curFrame = 0;
-    int frameCount = 0;
-    bool markForReleaseInNextFrame = false; // workaround, ADSRSignalGenerator expects to be released not 1 sample, but one buffer later...
     public override void processBufferImpl(float[] buffer, double dspTime, int channels)
     {
         if (!recursionCheckPre()) return; // checks and avoids fatal recursions
 
-        if (markForReleaseInNextFrame)
+        adsrValUpdate();
+
+        if (sustaining != lastSustaining)
         {
-            markForReleaseInNextFrame = false;
-            hit(false);
+            lastSustaining = sustaining;
+            Envelope_SetGate(sustaining, x);
         }
 
         if (incoming != null)
@@ -196,23 +182,12 @@ public class adsrSignalGenerator : signalGenerator
 
             SetArrayToSingleValue(pulseBuffer, pulseBuffer.Length, 0f);
             incoming.processBuffer(pulseBuffer, dspTime, channels);
-
-            for (int n = 0; n < buffer.Length; n += 2)
-            {
-                if (pulseBuffer[n] > 0f && lastPulseFloat <= 0f) // high
-                {
-                    hit(true);
-                }
-                else if (pulseBuffer[n] <= 0f && lastPulseFloat >= 0f)
-                { // low
-                    markForReleaseInNextFrame = true;
-                }
-                lastPulseFloat = pulseBuffer[n];
-            }
-
         }
 
-        ADSRSignalGenerator(buffer, buffer.Length, channels, frames, ref frameCount, active, ref ADSRvolume, volumes, startVal, ref curFrame, sustaining);
+        // gate edges of the incoming signal take effect at their exact sample
+        Envelope_Process(buffer, buffer.Length, channels, incoming != null ? pulseBuffer : null, x);
+        if (Envelope_GetStage(x) != ENVELOPE_IDLE) active = true;
+
         recursionCheckPost();
     }
 
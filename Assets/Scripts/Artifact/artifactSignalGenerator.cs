@@ -27,13 +27,23 @@
 
 using System.Collections;
 using System.Collections.Generic;
+using System;
 using System.Runtime.InteropServices;
 using UnityEngine;
 
 public class artifactSignalGenerator : signalGenerator
 {
     [DllImport("OSLNative")]
-    public static extern void Artefact_Process(float[] buffer, float noiseAmount, int downsampleFactor, float jitterAmount, int bitReduction, int channels, int n);
+    private static extern void Artefact_Process(float[] buffer, int n, int channels, IntPtr x);
+
+    [DllImport("OSLNative")]
+    private static extern void Artefact_SetParam(float value, int param, IntPtr x);
+
+    [DllImport("OSLNative")]
+    private static extern IntPtr Artefact_New(ulong seed);
+
+    [DllImport("OSLNative")]
+    private static extern void Artefact_Free(IntPtr x);
 
     public float noiseAmount = 0;
     public float jitterAmount = 0;
@@ -47,6 +57,19 @@ public class artifactSignalGenerator : signalGenerator
 
     public signalGenerator input;
 
+    private IntPtr x;
+
+    public override void Awake()
+    {
+        base.Awake();
+        x = Artefact_New((ulong)GetInstanceID());
+    }
+
+    private void OnDestroy()
+    {
+        Artefact_Free(x);
+    }
+
     public override void processBufferImpl(float[] buffer, double dspTime, int channels)
     {
         if (!recursionCheckPre()) return; // checks and avoids fatal recursions
@@ -54,14 +77,12 @@ public class artifactSignalGenerator : signalGenerator
         {
             input.processBuffer(buffer, dspTime, channels);
 
-            float noise, jitter;
-            int dwnmpl, bitrdx;
-            noise = Mathf.Pow(noiseAmount, 3);
-            jitter = Mathf.Pow(jitterAmount, 0.5f);
-            dwnmpl = (int)Utils.map(downsampleFactor, 0, 1, 1, 50);
-            bitrdx = (int)Utils.map(bitReduction, 0, 1, 0, 32);
+            Artefact_SetParam(Mathf.Pow(noiseAmount, 3), P_NOISE, x);
+            Artefact_SetParam(Mathf.Pow(jitterAmount, 0.5f), P_JITTER, x);
+            Artefact_SetParam((int)Utils.map(downsampleFactor, 0, 1, 1, 50), P_DOWNSAMPLE, x);
+            Artefact_SetParam((int)Utils.map(bitReduction, 0, 1, 0, 32), P_BITREDUCTION, x);
 
-            Artefact_Process(buffer, noise, dwnmpl, jitter, bitrdx, channels, buffer.Length);
+            Artefact_Process(buffer, buffer.Length, channels, x);
         }
         if (!recursionCheckPre()) return; // checks and avoids fatal recursions
     }
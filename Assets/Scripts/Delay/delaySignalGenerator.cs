@@ -46,6 +46,7 @@ public class delaySignalGenerator : signalGenerator
         P_INTERPOLATION,
         P_MIN_SAMPLES,
         P_MAX_SAMPLES,
+        P_TAPE,
         P_N
     };
 
@@ -55,6 +56,7 @@ public class delaySignalGenerator : signalGenerator
     //const int DELAYMODE_SIMPLE = 0; deprecated
     const int DELAYMODE_OVERSAMPLED = 1;
     const int DELAYMODE_EFFICIENT = 2;
+    const int DELAYMODE_FRACTIONAL = 3;
 
     public float MIN_TIME; // in seconds
     public float MAX_TIME; // in seconds
@@ -90,7 +92,7 @@ public class delaySignalGenerator : signalGenerator
         int maxDelaySamples = (int)(MAX_TIME * sampleRate);
         x = Delay_New(maxDelaySamples);
         Delay_SetParam(INTERPOLATION_LINEAR, (int)Param.P_INTERPOLATION, x);
-        Delay_SetMode(DELAYMODE_EFFICIENT, x);
+        Delay_SetMode(DELAYMODE_EFFICIENT, x); // DELAYMODE_FRACTIONAL costs less per sample, but does not pitch-shift on time changes
     }
 
     private void OnDestroy()
@@ -38,11 +38,9 @@ public class filterSignalGenerator : signalGenerator
     //MonoFilter[] filters;
 
     public float cutoffFrequency = 0f;
-    float lastCutoffFrequency = 0f;
     public float bandWidthHalfed = 0.05f;
     public float resonance = .5f;
 
-    float[] bufferCopy;
     float[] frequencyBuffer;
 
     // Changing this number requires changing native code.
@@ -71,27 +69,33 @@ public class filterSignalGenerator : signalGenerator
     public static extern void AddArrays(float[] a, float[] b, int length);
 
     [DllImport("OSLNative")]
-    public static extern void processStereoFilter(float[] buffer, int length, ref mfValues mfL, ref mfValues mfR, float cutoffFrequency, float lastCutoffFrequency, [MarshalAs(UnmanagedType.I1)] bool freqGen, float[] frequencyBuffer, float resonance/*, IntPtr logger*/);
+    private static extern void Ladder_Process(float[] buffer, int length, float[] fm, float cutoff, float bandwidth, float resonance, int type, IntPtr x);
 
-    // create structs for passing to native code
-    mfValues mf1L = new mfValues();
-    mfValues mf1R = new mfValues();
+    [DllImport("OSLNative")]
+    private static extern IntPtr Ladder_New();
+
+    [DllImport("OSLNative")]
+    private static extern void Ladder_Free(IntPtr x);
 
-    mfValues mf2L = new mfValues();
-    mfValues mf2R = new mfValues();
+    private IntPtr x;
 
     //IntPtr delegatePtr;
 
     public override void Awake()
     {
         base.Awake();
-        bufferCopy = new float[MAX_BUFFER_LENGTH];
         frequencyBuffer = new float[MAX_BUFFER_LENGTH];
+        x = Ladder_New();
 
         //LogDelegate callback_delegate = new LogDelegate(LogCallback);
         //delegatePtr = Marshal.GetFunctionPointerForDelegate(callback_delegate);
     }
 
+    private void OnDestroy()
+    {
+        Ladder_Free(x);
+    }
+
     //[UnmanagedFunctionPointer(CallingConvention.Cdecl)]
     //public delegate void LogDelegate(int level, string str);
 
@@ -108,9 +112,6 @@ public class filterSignalGenerator : signalGenerator
     public override void processBufferImpl(float[] buffer, double dspTime, int channels)
     {
         if (!recursionCheckPre()) return; // checks and avoids fatal recursions
-        if (bufferCopy.Length != buffer.Length)
-            System.Array.Resize(ref bufferCopy, buffer.Length);
-
         if (frequencyBuffer.Length != buffer.Length)
             System.Array.Resize(ref frequencyBuffer, buffer.Length);
 
@@ -128,46 +129,9 @@ public class filterSignalGenerator : signalGenerator
         if (incoming != null) incoming.processBuffer(buffer, dspTime, channels);
 
 
-        if (curType != filterType.Notch && curType != filterType.BP) // not a double filter setup, either LP or HP
-        {
-            mf1R.LP = mf1L.LP = curType == filterType.LP;
-            processStereoFilter(buffer, buffer.Length, ref mf1L, ref mf1R, cutoffFrequency, lastCutoffFrequency, freqIncoming != null, frequencyBuffer, resonance/*, delegatePtr*/);
-        }
-        else if (curType == filterType.Notch) // duplicate buffer in order to process two filters in parallel
-        {
-            CopyArray(buffer, bufferCopy, buffer.Length);
-
-            mf1R.LP = mf1L.LP = true;
-            processStereoFilter(buffer, buffer.Length, ref mf1L, ref mf1R, cutoffFrequency - bandWidthHalfed, lastCutoffFrequency - bandWidthHalfed, freqIncoming != null, frequencyBuffer, resonance * 0.7f/*, delegatePtr*/); // less resonance for double filter mode
-
-            mf2R.LP = mf2L.LP = false;
-            processStereoFilter(bufferCopy, bufferCopy.Length, ref mf2L, ref mf2R, cutoffFrequency + bandWidthHalfed, lastCutoffFrequency + bandWidthHalfed, freqIncoming != null, frequencyBuffer, resonance * 0.7f/*, delegatePtr*/);
+        // LP and HP run one filter, BP and Notch two of them in the same native call
+        Ladder_Process(buffer, buffer.Length, freqIncoming != null ? frequencyBuffer : null, cutoffFrequency, bandWidthHalfed, resonance, (int)curType, x);
 
-            AddArrays(buffer, bufferCopy, buffer.Length);
-        }
-
-        else if (curType == filterType.BP) // process two filter in series
-        {
-
-            mf1R.LP = mf1L.LP = false;
-            processStereoFilter(buffer, buffer.Length, ref mf1L, ref mf1R, cutoffFrequency - bandWidthHalfed, lastCutoffFrequency - bandWidthHalfed, freqIncoming != null, frequencyBuffer, resonance * 0.7f/*, delegatePtr*/);
-
-            mf2R.LP = mf2L.LP = true;
-            processStereoFilter(buffer, buffer.Length, ref mf2L, ref mf2R, cutoffFrequency + bandWidthHalfed, lastCutoffFrequency + bandWidthHalfed, freqIncoming != null, frequencyBuffer, resonance * 0.7f/*, delegatePtr*/);
-        }
-
-        CopyArray(buffer, bufferCopy, buffer.Length);
-
-        lastCutoffFrequency = cutoffFrequency; // for slope limiting in native code
         recursionCheckPost();
     }
 }
-
-public struct mfValues
-{
-    public float f, p, q; // filter coefficients
-    public float b0, b1, b2, b3, b4; // filter buffers (beware denormals!)
-    public bool LP;
-};
-
-
@@ -39,6 +39,7 @@ public class oscillatorSignalGenerator : signalGenerator
     public float frequency = 261.6256f; // C4, MIDI 60, will usually be overwritten for Oscillator because of dial
     public float amplitude = 1;
     public float analogWave = 0;
+    public bool bandLimited = true; // PolyBLEP/PolyBLAMP corrected edges for audio-rate oscillators, LFOs stay naive
 
     double lastIncomingDspTime = -1;
     float keyMultConst = Mathf.Pow(2, 1f / 12);
@@ -71,6 +72,16 @@ public class oscillatorSignalGenerator : signalGenerator
                                 [MarshalAs(UnmanagedType.I1)] bool bPwmGen,
                                 double _sampleDuration, ref double dspTime);
 
+    [DllImport("OSLNative")]
+    public static extern void OscillatorSignalGeneratorBandLimited(float[] buffer, int length, int channels, ref double _phase, float analogWave, float frequency, float prevFrequency, float amplitude, float prevAmplitude, ref float prevSyncValue,
+                                float[] frequencyExpBuffer, float[] frequencyLinBuffer, float[] amplitudeBuffer, float[] syncBuffer, float[] pwmBuffer,
+                                [MarshalAs(UnmanagedType.I1)] bool bFreqExpGen,
+                                [MarshalAs(UnmanagedType.I1)] bool bFreqLinGen,
+                                [MarshalAs(UnmanagedType.I1)] bool bAmpGen,
+                                [MarshalAs(UnmanagedType.I1)] bool bSyncGen,
+                                [MarshalAs(UnmanagedType.I1)] bool bPwmGen,
+                                double _sampleDuration, ref double dspTime);
+
     [DllImport("OSLNative")]
     public static extern void SetArrayToSingleValue(float[] a, int length, float val);
 
@@ -112,8 +123,12 @@ public class oscillatorSignalGenerator : signalGenerator
             Debug.LogWarning("catched a stackoverflow because of recursive patch connections");
         }
 
-        OscillatorSignalGenerator(buffer, buffer.Length, channels, ref _phase, analogWave, frequency, prevFrequency, amplitude, prevAmplitude, ref lastSyncValue, frequencyExpBuffer, frequencyLinBuffer, amplitudeBuffer, syncBuffer, pwmBuffer,
-            freqExpGen != null, freqLinGen != null, ampGen != null, syncGen != null, pwmGen != null, _sampleDuration, ref dspTime);
+        if (bandLimited && !lfo)
+            OscillatorSignalGeneratorBandLimited(buffer, buffer.Length, channels, ref _phase, analogWave, frequency, prevFrequency, amplitude, prevAmplitude, ref lastSyncValue, frequencyExpBuffer, frequencyLinBuffer, amplitudeBuffer, syncBuffer, pwmBuffer,
+                freqExpGen != null, freqLinGen != null, ampGen != null, syncGen != null, pwmGen != null, _sampleDuration, ref dspTime);
+        else
+            OscillatorSignalGenerator(buffer, buffer.Length, channels, ref _phase, analogWave, frequency, prevFrequency, amplitude, prevAmplitude, ref lastSyncValue, frequencyExpBuffer, frequencyLinBuffer, amplitudeBuffer, syncBuffer, pwmBuffer,
+                freqExpGen != null, freqLinGen != null, ampGen != null, syncGen != null, pwmGen != null, _sampleDuration, ref dspTime);
 
 
         // wave viz if there
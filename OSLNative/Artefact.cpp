@@ -31,23 +31,199 @@
 
 #include "Artefact.h"
 #include "util.h"
+#include <math.h>
+#include <string.h>
 
-OSL_API void Artefact_Process(float buffer[], float noiseAmount, int downsampleFactor, float jitterAmount,
-                              int bitReduction, int channels, int n) {
-    if (channels > 1) {
-        _fDeinterleave(buffer, buffer, n, channels);
+enum ArtefactParams {
+    P_NOISE,        // 0
+    P_JITTER,       // 1
+    P_DOWNSAMPLE,   // 2
+    P_BITREDUCTION, // 3
+    P_N
+};
+
+/// Multiplies each sample with noise around 1, so the noise follows the signal: x * (1 - amount + amount * random).
+static void Artefact_Noise(float* __restrict buf, const float* __restrict random, int n, float amount) {
+    float dry = 1 - amount;
+    for (int i = 0; i < n; i++)
+        buf[i] *= dry + amount * random[i];
+}
+
+/// Selects a where mask is all ones and b where it is zero. Selecting between floats through their bits lets gcc
+/// vectorise the loop under the default -ftrapping-math, which keeps it from if-converting float conditionals.
+static inline float Artefact_Select(uint32_t mask, float a, float b) {
+    uint32_t ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    uint32_t result = (ia & mask) | (ib & ~mask);
+    float f;
+    memcpy(&f, &result, sizeof(f));
+    return f;
+}
+
+/// Rounds down to an integer without a libm call, so that the loop vectorises. Adding and subtracting 2^23 rounds to
+/// the nearest integer, floats beyond +-2^23 are integers already.
+static inline float Artefact_Floor(float t) {
+    const float limit = 8388608.0f; // 2^23
+    float magic = copysignf(limit, t);
+    float rounded = (t + magic) - magic;
+    rounded -= Artefact_Select(-(uint32_t) (rounded > t), 1.0f, 0.0f);
+    return Artefact_Select(-(uint32_t) (fabsf(t) < limit), rounded, t);
+}
+
+/// Moves each sample to a random position between its neighbours. As in an in-place pass over the block, the left
+/// neighbour has been moved already and the right one has not. The first and the last frame of the block stay, as
+/// they miss a neighbour. previous holds the last moved frame, which the caller may have crushed in the meantime.
+///
+/// Moving left interpolates with the moved left neighbour, which chains the samples of a channel. The part that does
+/// not depend on the left neighbour is computed upfront, in a loop that vectorises, which leaves a first order linear
+/// recurrence, out = base + weight * previous, with a single multiply-add per sample on the serial path.
+static void Artefact_Jitter(float buf[], float* __restrict random, float* __restrict base, int start, int end,
+                            int frames, int channels, float amount, float previous[]) {
+    amount *= 0.999f; // keeps the position strictly between the neighbours
+
+    int first = start > 0 ? start : 1;
+    int last = end < frames - 1 ? end : frames - 1;
+    if (first < last) {
+        const float* cur = buf + first * channels;
+        const float* next = cur + channels;
+        int offset = (first - start) * channels;
+        float* __restrict w = random + offset;
+        float* __restrict b = base + offset;
+        int count = (last - first) * channels;
+        for (int k = 0; k < count; k++) {
+            float shift = amount * w[k];
+            uint32_t left = -(uint32_t) (shift < 0);
+            b[k] = Artefact_Select(left, cur[k] * (1 + shift), cur[k] + shift * (next[k] - cur[k]));
+            w[k] = Artefact_Select(left, -shift, 0.0f);
+        }
+    }
+    for (int i = start; i < end; i++) {
+        if (i < first || i >= last) {
+            for (int c = 0; c < channels; c++) {
+                base[(i - start) * channels + c] = buf[i * channels + c];
+                random[(i - start) * channels + c] = 0;
+            }
+        }
+    }
+
+    for (int i = start; i < end; i++) {
+        float* frame = buf + i * channels;
+        const float* b = base + (i - start) * channels;
+        const float* w = random + (i - start) * channels;
+        for (int c = 0; c < channels; c++) {
+            frame[c] = b[c] + w[c] * previous[c];
+            previous[c] = frame[c];
+        }
+    }
+}
+
+/// Drops the lowest bits of a 32 bit signed representation, i.e. rounds down to a multiple of 2^(bitReduction - 31).
+static void Artefact_Crush(float* __restrict buf, int n, float scale) {
+    float inverse = 1 / scale;
+    for (int i = 0; i < n; i++)
+        buf[i] = Artefact_Floor(buf[i] * scale) * inverse;
+}
+
+/// Samples every downsampleFactor-th frame and holds it. The phase carries over to the next block.
+static void Artefact_Hold(float buf[], int frames, int channels, ArtefactData* x) {
+    for (int i = 0; i < frames; i++) {
+        float* frame = buf + i * channels;
+        if (x->holdCounter == 0) {
+            for (int c = 0; c < channels; c++)
+                x->held[c] = frame[c];
+            x->holdCounter = x->downsampleFactor;
+        }
+        x->holdCounter--;
+        for (int c = 0; c < channels; c++)
+            frame[c] = x->held[c];
     }
+}
+
+/* Processing audio */
+
+OSL_API void Artefact_Process(float buffer[], int n, int channels, ArtefactData* x) {
+    if (channels < 1 || channels > ARTEFACT_MAX_CHANNELS)
+        return;
 
-    int nPerChan = n / channels;
+    bool noise = x->noiseAmount > 0;
+    bool jitter = x->jitterAmount > 0;
+    bool crush = x->bitReduction > 0;
+    bool downsample = x->downsampleFactor > 1;
+    if (!noise && !jitter && !crush && !downsample)
+        return;
 
-    for (int i = 0; i < channels; i++) {
-        _fNoiseAdditive(buffer + i * nPerChan, noiseAmount, nPerChan);
-        _fJitter(buffer + i * nPerChan, jitterAmount, nPerChan);
-        _fBitCrush(buffer + i * nPerChan, bitReduction, nPerChan);
-        _fDownSample(buffer + i * nPerChan, downsampleFactor, nPerChan);
+    int frames = n / channels;
+    int chunkFrames = ARTEFACT_CHUNK / channels;
+    float random[ARTEFACT_CHUNK];
+    float base[ARTEFACT_CHUNK];
+    float previous[ARTEFACT_MAX_CHANNELS] = {0};
+
+    /// jitter reads one frame ahead, hence noise is applied one frame ahead of the other stages
+    if (noise && frames > 0) {
+        Noise_Process(random, channels, &x->noise);
+        Artefact_Noise(buffer, random, channels, x->noiseAmount);
     }
 
-    if (channels > 1) {
-        _fInterleave(buffer, buffer, n, channels);
+    for (int start = 0; start < frames; start += chunkFrames) {
+        int end = start + chunkFrames < frames ? start + chunkFrames : frames;
+        float* chunk = buffer + start * channels;
+        int count = (end - start) * channels;
+
+        if (noise) {
+            int ahead = end < frames ? count : count - channels; // frames start + 1 ... end
+            Noise_Process(random, ahead, &x->noise);
+            Artefact_Noise(chunk + channels, random, ahead, x->noiseAmount);
+        }
+        if (jitter) {
+            Noise_Process(random, count, &x->noise);
+            Artefact_Jitter(buffer, random, base, start, end, frames, channels, x->jitterAmount, previous);
+        }
+        if (crush)
+            Artefact_Crush(chunk, count, x->crushScale);
+        if (downsample)
+            Artefact_Hold(chunk, end - start, channels, x);
     }
 }
+
+/* Setting parameters */
+
+OSL_API void Artefact_SetParam(float value, int param, ArtefactData* x) {
+    switch (param) {
+    case P_NOISE:
+        x->noiseAmount = _clamp(value, 0, 1);
+        break;
+    case P_JITTER:
+        x->jitterAmount = _clamp(value, 0, 1);
+        break;
+    case P_DOWNSAMPLE:
+        x->downsampleFactor = (int) _clamp(value, 1, 64);
+        if (x->holdCounter >= x->downsampleFactor)
+            x->holdCounter = 0;
+        break;
+    case P_BITREDUCTION:
+        x->bitReduction = (int) _clamp(value, 0, 32);
+        x->crushScale = ldexpf(1, 31 - x->bitReduction);
+        break;
+    }
+}
+
+/* Allocating and Freeing */
+
+OSL_API ArtefactData* Artefact_New(uint64_t seed) {
+    ArtefactData* x = (ArtefactData*) _malloc(sizeof(ArtefactData));
+    Noise_Seed(seed, &x->noise);
+    x->noiseAmount = 0;
+    x->jitterAmount = 0;
+    x->downsampleFactor = 1;
+    x->bitReduction = 0;
+    x->crushScale = ldexpf(1, 31);
+    x->holdCounter = 0;
+    for (int c = 0; c < ARTEFACT_MAX_CHANNELS; c++)
+        x->held[c] = 0;
+    return x;
+}
+
+OSL_API void Artefact_Free(ArtefactData* x) {
+    _free(x);
+}
@@ -29,18 +29,60 @@
 //  Created by hb on 22.02.22.
 //
 // Artefact creates all kinds of digital havoc: white noise, jitter, bit crushing, downsampling.
+//
+// All four stages run in a single pass over the interleaved buffer, chunk by chunk, so every sample is loaded and
+// stored once per stage while it is still in the L1 cache and no deinterleaving is needed. Noise, bit crushing and most
+// of the jitter are written so that the compiler can vectorise them; the rest of the jitter and the downsampling carry
+// state from frame to frame and run as tight scalar loops over the chunk. Each instance owns its random number
+// generator, so that instances can be processed concurrently on different threads.
+//
+// Artefact_New() and Artefact_Free() must not be called from the audio thread. All other functions are not
+// thread-safe, hence the caller must avoid simultaneous access to the same instance from multiple threads.
 
 #ifndef Artefact_h
 #define Artefact_h
 
 #include "main.h"
+#include "Noise.h"
+
+#define ARTEFACT_MAX_CHANNELS 8
+#define ARTEFACT_CHUNK 256 // samples processed per chunk
+
+struct ArtefactData {
+    Noise noise;
+
+    // params
+    float noiseAmount;    // 0...1
+    float jitterAmount;   // 0...1
+    int downsampleFactor; // 1...64, 1 keeps the sample rate
+    int bitReduction;     // 0...32, 0 keeps all bits
+    float crushScale;     // 2^(31 - bitReduction)
+
+    // downsampling state, carried across blocks
+    int holdCounter; // frames left until the next frame is sampled
+    float held[ARTEFACT_MAX_CHANNELS];
+};
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-OSL_API void Artefact_Process(float buffer[], float noiseAmount, int downsampleFactor, float jitterAmount,
-                              int bitReduction, int channels, int n);
+/* Processing audio */
+
+/// Processes n interleaved samples in place. Buffers with more than ARTEFACT_MAX_CHANNELS channels are left unchanged.
+OSL_API void Artefact_Process(float buffer[], int n, int channels, ArtefactData* x);
+
+/* Setting parameters */
+
+/// Sets the parameter to the specified value.
+OSL_API void Artefact_SetParam(float value, int param, ArtefactData* x);
+
+/* Allocating and Freeing */
+
+/// Returns a new instance with all stages bypassed, whose noise and jitter are determined by the given seed.
+OSL_API ArtefactData* Artefact_New(uint64_t seed);
+/// Frees all resources of an instance.
+OSL_API void Artefact_Free(ArtefactData* x);
 
 #ifdef __cplusplus
 }
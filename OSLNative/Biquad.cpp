@@ -27,9 +27,20 @@
 
 #include "Biquad.h"
 #include <math.h>
+#include <stdint.h>
+#include <string.h>
 
 #define BIQUAD_UNDEFINED 0 // unlike the other const types, this one should not be accessible from the public API
 
+#define BIQUAD_TABLE_MIN_FREQUENCY 10.f // Hz
+#define BIQUAD_TABLE_OCTAVES 11         // 10 Hz ... 20.48 kHz
+#define BIQUAD_TABLE_STEPS_PER_OCTAVE 24
+#define BIQUAD_TABLE_MIN_Q 0.125f
+#define BIQUAD_TABLE_Q_OCTAVES 8 // 0.125 ... 32
+#define BIQUAD_TABLE_Q_STEPS_PER_OCTAVE 4
+#define BIQUAD_TABLE_COEFFS 8 // b0, b1, b2, a1, a2 and padding, so that a grid point is two SIMD vectors
+#define BIQUAD_MODULATION_CHUNK 64
+
 void Biquad_calculateCoeffs(Biquad* x) {
     x->A = sqrtf(powf(10, x->gain / 20));
     x->w0 = 2 * M_PI * x->frequency / x->sampleRate;
@@ -135,6 +146,10 @@ Biquad* Biquad_new(int type, float frequency, float Q, float gain, float sampleR
     // need to remember z^-1 and z^-2 for both input and output and for each channel:
     x->xMem = (float*) _malloc(channels * 2 * sizeof(float));
     x->yMem = (float*) _malloc(channels * 2 * sizeof(float));
+    _fZero(x->xMem, channels * 2);
+    _fZero(x->yMem, channels * 2);
+    x->tableFrequency = -1;
+    x->tableQ = -1;
     return x;
 }
 
@@ -171,10 +186,10 @@ void Biquad_processChannel(Biquad* x, int type, float frequency, float Q, float
     }
 
     // permanent memory
-    x->yMem[offset + 1] = y1;
-    x->yMem[offset] = y0;
-    x->xMem[offset + 1] = x1;
-    x->xMem[offset] = x0;
+    x->yMem[offset + 1] = y2;
+    x->yMem[offset] = y1;
+    x->xMem[offset + 1] = x2;
+    x->xMem[offset] = x1;
 }
 
 void Biquad_process(Biquad* x, int type, float frequency, float Q, float gain, float sampleRate, float* in, float* out,
@@ -197,3 +212,288 @@ void Biquad_process(Biquad* x, int type, float frequency, float Q, float gain, f
     // interleave audio data
     _fInterleave(out, out, n, channels);
 }
+
+BiquadTable* BiquadTable_new(int type, float gain, float sampleRate, float smoothingTime) {
+    BiquadTable* table = (BiquadTable*) _malloc(sizeof(BiquadTable));
+    table->type = type;
+    table->gain = gain;
+    table->sampleRate = sampleRate;
+    table->smoothing = smoothingTime > 0 ? 1 - expf(-1 / (smoothingTime * sampleRate)) : 1;
+    // every axis has a guard point at both ends that repeats its neighbour, so that a coordinate needs no clamping if
+    // the approximate log2 overshoots the range by a hair
+    table->frequencies = BIQUAD_TABLE_OCTAVES * BIQUAD_TABLE_STEPS_PER_OCTAVE + 3;
+    table->qs = BIQUAD_TABLE_Q_OCTAVES * BIQUAD_TABLE_Q_STEPS_PER_OCTAVE + 3;
+    table->coeffs = (float*) _malloc(table->frequencies * table->qs * BIQUAD_TABLE_COEFFS * sizeof(float));
+
+    Biquad design;
+    design.type = type;
+    design.gain = gain;
+    design.sampleRate = sampleRate;
+    float* c = table->coeffs;
+    for (int q = 0; q < table->qs; q++) {
+        for (int f = 0; f < table->frequencies; f++) {
+            int fg = f < 1 ? 1 : f > table->frequencies - 2 ? table->frequencies - 2 : f; // skipping the guard points
+            int qg = q < 1 ? 1 : q > table->qs - 2 ? table->qs - 2 : q;
+            // the grid continues above Nyquist with the design just below it, so that it is the same for all rates
+            design.frequency = BIQUAD_TABLE_MIN_FREQUENCY * powf(2, (float) (fg - 1) / BIQUAD_TABLE_STEPS_PER_OCTAVE);
+            if (design.frequency > 0.49f * sampleRate)
+                design.frequency = 0.49f * sampleRate;
+            design.Q = BIQUAD_TABLE_MIN_Q * powf(2, (float) (qg - 1) / BIQUAD_TABLE_Q_STEPS_PER_OCTAVE);
+            Biquad_calculateCoeffs(&design);
+            *c++ = design.b0_over_a0;
+            *c++ = design.b1_over_a0;
+            *c++ = design.b2_over_a0;
+            *c++ = design.a1_over_a0;
+            *c++ = design.a2_over_a0;
+            *c++ = 0;
+            *c++ = 0;
+            *c++ = 0;
+        }
+    }
+    return table;
+}
+
+void BiquadTable_free(BiquadTable* table) {
+    _free(table->coeffs);
+    _free(table);
+}
+
+/* log2 of the magnitude of v, from its exponent bits and a series for the mantissa instead of log2f. The error is below
+ 2e-5, i.e. well below the spacing of the table. */
+static inline float Biquad_log2(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    int exponent = (int) ((bits >> 23) & 0xff) - 127;
+    bits = (bits & 0x007fffffu) | 0x3f800000u;
+    float m; // 1 ... 2
+    memcpy(&m, &bits, sizeof(m));
+    float t = (m - 1) / (m + 1); // log(m) = 2 * atanh(t), t is 0 ... 1/3
+    float t2 = t * t;
+    return exponent + 2.8853901f * t * (1.f + t2 * (0.33333333f + t2 * (0.2f + t2 * 0.14285714f)));
+}
+
+/* Clamps a value to min ... max, both positive, comparing the bits as integers: positive floats are ordered like
+ their bits, negative ones have the sign bit set and end up at min, NaN ends up at max. Unlike float comparisons, this
+ lets the compiler vectorise the loop it is in. */
+static inline float Biquad_clampPositive(float v, int32_t min, int32_t max) {
+    int32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    bits = bits < min ? min : bits;
+    bits = bits > max ? max : bits;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+/* Maps values onto a table axis that starts at min and spans the given octaves, clamped to that range. The coordinate
+ of min is 1, behind the guard point. */
+static void Biquad_tableCoordinates(const float* v, float* coordinates, int length, float min, int octaves,
+                                    float stepsPerOctave) {
+    float max = min * powf(2, (float) octaves);
+    int32_t minBits, maxBits;
+    memcpy(&minBits, &min, sizeof(minBits));
+    memcpy(&maxBits, &max, sizeof(maxBits));
+    float log2Min = Biquad_log2(min);
+    for (int t = 0; t < length; t++)
+        coordinates[t] = (Biquad_log2(Biquad_clampPositive(v[t], minBits, maxBits)) - log2Min) * stepsPerOctave + 1;
+}
+
+void Biquad_processModulated(Biquad* x, const BiquadTable* table, const float* frequency, const float* Q, float* in,
+                             float* out, int n) {
+    int channels = x->channels;
+    int frames = n / channels;
+    int stride = table->frequencies * BIQUAD_TABLE_COEFFS; // from one Q to the next
+    float smoothing = table->smoothing;
+    float qCoordinate; // of the Q of x, if there is no Q buffer
+    Biquad_tableCoordinates(&x->Q, &qCoordinate, 1, BIQUAD_TABLE_MIN_Q, BIQUAD_TABLE_Q_OCTAVES,
+                            BIQUAD_TABLE_Q_STEPS_PER_OCTAVE);
+
+    // the coefficients of a chunk of frames are looked up first, so that the filter loops below keep their state in
+    // registers and the lookups of different frames can overlap
+    float targetF[BIQUAD_MODULATION_CHUNK], targetQ[BIQUAD_MODULATION_CHUNK];
+    float coeffs[BIQUAD_MODULATION_CHUNK * BIQUAD_TABLE_COEFFS];
+
+    float tf = x->tableFrequency;
+    float tq = x->tableQ;
+    for (int start = 0; start < frames; start += BIQUAD_MODULATION_CHUNK) {
+        int length = frames - start < BIQUAD_MODULATION_CHUNK ? frames - start : BIQUAD_MODULATION_CHUNK;
+
+        Biquad_tableCoordinates(frequency + start, targetF, length, BIQUAD_TABLE_MIN_FREQUENCY, BIQUAD_TABLE_OCTAVES,
+                                BIQUAD_TABLE_STEPS_PER_OCTAVE);
+        if (Q)
+            Biquad_tableCoordinates(Q + start, targetQ, length, BIQUAD_TABLE_MIN_Q, BIQUAD_TABLE_Q_OCTAVES,
+                                    BIQUAD_TABLE_Q_STEPS_PER_OCTAVE);
+        else
+            for (int t = 0; t < length; t++)
+                targetQ[t] = qCoordinate;
+        if (tf < 0) { // first call, nothing to smooth from
+            tf = targetF[0];
+            tq = targetQ[0];
+        }
+
+        // the smoothed coordinates replace the targets in place
+        for (int t = 0; t < length; t++) {
+            targetF[t] = tf += smoothing * (targetF[t] - tf);
+            targetQ[t] = tq += smoothing * (targetQ[t] - tq);
+        }
+
+        for (int t = 0; t < length; t++) {
+            // bilinear interpolation between the four surrounding designs, see BiquadTable_new for the range
+            int fi = (int) targetF[t];
+            int qi = (int) targetQ[t];
+            float ff = targetF[t] - fi;
+            float qf = targetQ[t] - qi;
+            float w00 = (1 - ff) * (1 - qf);
+            float w10 = ff * (1 - qf);
+            float w01 = (1 - ff) * qf;
+            float w11 = ff * qf;
+            const float* c00 = table->coeffs + qi * stride + fi * BIQUAD_TABLE_COEFFS;
+            const float* c10 = c00 + BIQUAD_TABLE_COEFFS;
+            const float* c01 = c00 + stride;
+            const float* c11 = c01 + BIQUAD_TABLE_COEFFS;
+            float* c = coeffs + t * BIQUAD_TABLE_COEFFS;
+            for (int i = 0; i < BIQUAD_TABLE_COEFFS; i++)
+                c[i] = w00 * c00[i] + w10 * c10[i] + w01 * c01[i] + w11 * c11[i];
+        }
+
+        // direct form I, see Biquad_processChannel
+        for (int ch = 0; ch < channels; ch++) {
+            float x1 = x->xMem[2 * ch];
+            float x2 = x->xMem[2 * ch + 1];
+            float y1 = x->yMem[2 * ch];
+            float y2 = x->yMem[2 * ch + 1];
+            const float* src = in + start * channels + ch;
+            float* dst = out + start * channels + ch;
+            for (int t = 0; t < length; t++) {
+                const float* c = coeffs + t * BIQUAD_TABLE_COEFFS;
+                float x0 = src[t * channels];
+                // the feedback of y1 comes last, as it is the only term that waits for the previous sample
+                float y0 = (c[0] * x0 + c[1] * x1 + c[2] * x2 - c[4] * y2) - c[3] * y1;
+                dst[t * channels] = y0;
+                y2 = y1;
+                y1 = y0;
+                x2 = x1;
+                x1 = x0;
+            }
+            x->xMem[2 * ch] = x1;
+            x->xMem[2 * ch + 1] = x2;
+            x->yMem[2 * ch] = y1;
+            x->yMem[2 * ch + 1] = y2;
+        }
+    }
+    x->tableFrequency = tf;
+    x->tableQ = tq;
+}
+
+BiquadCascade* BiquadCascade_new(int sections, int channels) {
+    if (sections < 1)
+        sections = 1;
+    if (channels < 1)
+        channels = 1;
+
+    BiquadCascade* x = (BiquadCascade*) _malloc(sizeof(BiquadCascade));
+    x->sections = sections;
+    x->channels = channels;
+    x->lanes = sections * channels;
+    x->b0 = (float*) _malloc(x->lanes * sizeof(float));
+    x->b1 = (float*) _malloc(x->lanes * sizeof(float));
+    x->b2 = (float*) _malloc(x->lanes * sizeof(float));
+    x->a1 = (float*) _malloc(x->lanes * sizeof(float));
+    x->a2 = (float*) _malloc(x->lanes * sizeof(float));
+    x->s1 = (float*) _malloc(x->lanes * sizeof(float));
+    x->s2 = (float*) _malloc(x->lanes * sizeof(float));
+    x->in = (float*) _malloc(x->lanes * sizeof(float));
+    x->out = (float*) _malloc(x->lanes * sizeof(float));
+
+    for (int s = 0; s < sections; s++)
+        BiquadCascade_setCoefficients(x, s, 1, 0, 0, 0, 0);
+    _fZero(x->in, x->lanes);
+    _fZero(x->out, x->lanes);
+    BiquadCascade_clear(x);
+    return x;
+}
+
+void BiquadCascade_free(BiquadCascade* x) {
+    _free(x->b0);
+    _free(x->b1);
+    _free(x->b2);
+    _free(x->a1);
+    _free(x->a2);
+    _free(x->s1);
+    _free(x->s2);
+    _free(x->in);
+    _free(x->out);
+    _free(x);
+}
+
+void BiquadCascade_setCoefficients(BiquadCascade* x, int section, float b0, float b1, float b2, float a1, float a2) {
+    if (section < 0 || section >= x->sections)
+        return;
+    for (int c = 0; c < x->channels; c++) {
+        int lane = section * x->channels + c;
+        x->b0[lane] = b0;
+        x->b1[lane] = b1;
+        x->b2[lane] = b2;
+        x->a1[lane] = a1;
+        x->a2[lane] = a2;
+    }
+}
+
+void BiquadCascade_setSection(BiquadCascade* x, int section, int type, float frequency, float Q, float gain,
+                              float sampleRate) {
+    Biquad design;
+    design.type = type;
+    design.frequency = frequency;
+    design.Q = Q;
+    design.gain = gain;
+    design.sampleRate = sampleRate;
+    Biquad_calculateCoeffs(&design);
+    BiquadCascade_setCoefficients(x, section, design.b0_over_a0, design.b1_over_a0, design.b2_over_a0,
+                                  design.a1_over_a0, design.a2_over_a0);
+}
+
+void BiquadCascade_clear(BiquadCascade* x) {
+    _fZero(x->s1, x->lanes);
+    _fZero(x->s2, x->lanes);
+}
+
+/* Advances a range of lanes by one sample each, in transposed direct form II. The arrays are passed as restrict
+ parameters, so that the compiler knows that they do not overlap and can vectorise across lanes. */
+static void BiquadCascade_step(int lanes, const float* __restrict in, float* __restrict out,
+                               const float* __restrict b0, const float* __restrict b1, const float* __restrict b2,
+                               const float* __restrict a1, const float* __restrict a2, float* __restrict s1,
+                               float* __restrict s2) {
+    for (int l = 0; l < lanes; l++) {
+        float x0 = in[l];
+        float y0 = b0[l] * x0 + s1[l];
+        s1[l] = b1[l] * x0 - a1[l] * y0 + s2[l];
+        s2[l] = b2[l] * x0 - a2[l] * y0;
+        out[l] = y0;
+    }
+}
+
+void BiquadCascade_process(BiquadCascade* x, float* in, float* out, int n) {
+    int channels = x->channels;
+    int sections = x->sections;
+    int frames = n / channels;
+
+    // in step t, section s works on frame t - s. The first and last sections - 1 steps fill and drain the pipeline, so
+    // only the sections with a valid frame run in them; that range of sections is contiguous and so are its lanes.
+    for (int t = 0; t < frames + sections - 1; t++) {
+        // section s takes the output of section s - 1 from the previous step, section 0 takes frame t
+        memcpy(x->in + channels, x->out, (x->lanes - channels) * sizeof(float));
+        if (t < frames)
+            memcpy(x->in, in + t * channels, channels * sizeof(float));
+
+        int first = t - frames + 1 > 0 ? t - frames + 1 : 0;
+        int last = t < sections - 1 ? t : sections - 1;
+        int offset = first * channels;
+        BiquadCascade_step((last - first + 1) * channels, x->in + offset, x->out + offset, x->b0 + offset,
+                           x->b1 + offset, x->b2 + offset, x->a1 + offset, x->a2 + offset, x->s1 + offset,
+                           x->s2 + offset);
+
+        // the last section finished frame t - (sections - 1); in and out can be identical, but that frame of the
+        // input has been read already
+        if (t >= sections - 1)
+            memcpy(out + (t - sections + 1) * channels, x->out + x->lanes - channels, channels * sizeof(float));
+    }
+}
@@ -43,6 +43,27 @@
  3. Don't forget to free memory:
     Biquad_free(biquad);
 
+ BiquadCascade runs several second-order sections in series, e.g. for multi-band EQs or steep crossovers, directly on
+ interleaved audio data in transposed direct form II. Its lanes are section x channel: section s works on frame t - s
+ while section 0 works on frame t, so all sections and channels of a frame advance in the same SIMD instructions. The
+ pipeline is filled and drained within every call, hence there is no added latency.
+
+ 1. IntPtr cascade = BiquadCascade_new(4, 2);
+ 2. BiquadCascade_setSection(cascade, 0, BIQUAD_LOWSHELF, 100, 0.7, 3.0, 48000); ... for every section
+ 3. BiquadCascade_process(cascade, buffer, buffer, buffer.Length);
+ 4. BiquadCascade_free(cascade);
+
+ For audio-rate modulation, Biquad_processModulated takes a cutoff (and optionally a Q) per frame and looks the
+ coefficients up in a BiquadTable instead of calling sin, cos and pow. A table holds the designs of one type and gain on
+ a grid of log-frequency x log-Q and is read with bilinear interpolation. The table coordinates are smoothed with a
+ one-pole filter before the lookup. Both interpolation and smoothing only ever mix designs of the grid with positive
+ weights that sum up to one, and since the region of stable (a1, a2) is convex, the result is stable as well. The
+ filter itself runs in direct form I, whose state does not depend on the coefficients and thus tolerates their change.
+
+ 1. IntPtr table = BiquadTable_new(BIQUAD_LOWPASS, 1.0, 48000, 0.001); // can be shared by many filters
+ 2. Biquad_processModulated(biquad, table, cutoffBuffer, null, buffer, buffer, buffer.Length);
+ 3. BiquadTable_free(table);
+
  */
 
 #ifndef Biquad_h
@@ -80,8 +101,40 @@ typedef struct Biquad {
     float b2_over_a0;
     float a1_over_a0;
     float a2_over_a0;
+
+    // smoothed coordinates of Biquad_processModulated in its table, negative until the first call
+    float tableFrequency;
+    float tableQ;
 } Biquad;
 
+typedef struct BiquadTable {
+    int type;
+    float gain;
+    float sampleRate;
+    float smoothing; // one-pole coefficient of the table coordinates, 1 means no smoothing
+
+    int frequencies; // grid points along log-frequency
+    int qs;          // grid points along log-Q
+    float* coeffs;   // b0, b1, b2, a1, a2 over a0 and padding for every grid point, frequency by frequency for every Q
+} BiquadTable;
+
+typedef struct BiquadCascade {
+    int sections;
+    int channels;
+    int lanes; // sections * channels, lane = section * channels + channel
+
+    // per lane, i.e. repeated for every channel of a section
+    float* b0;
+    float* b1;
+    float* b2;
+    float* a1;
+    float* a2;
+    float* s1; // z^-1 and z^-2 state of transposed direct form II
+    float* s2;
+    float* in;  // the input of each lane in the current step
+    float* out; // the output of each lane in the current step
+} BiquadCascade;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -113,6 +166,50 @@ Params:
 OSL_API void Biquad_process(Biquad* x, int type, float frequency, float Q, float gain, float sampleRate, float* in,
                             float* out, int n);
 
+/* Precomputes the coefficients of one filter type and gain for Biquad_processModulated. The grid covers 10 Hz to
+ 20.48 kHz (or Nyquist) in 1/24 octaves and Q from 0.125 to 32 in 1/4 octaves; values outside are clamped.
+ smoothingTime: the time constant in seconds with which the filter follows its controls, 0 to follow them immediately.
+ A table is read-only after creation and can be shared by any number of filters. */
+OSL_API BiquadTable* BiquadTable_new(int type, float gain, float sampleRate, float smoothingTime);
+
+/* Deletes an existing table. */
+OSL_API void BiquadTable_free(BiquadTable* table);
+
+/*
+Processes a block of INTERLEAVED (!) audio data with a modulated frequency and Q.
+
+Params:
+ table: the filter design, see BiquadTable_new. The type, gain and sampleRate of x are ignored.
+ frequency: the center frequency in Hertz, one value per frame, i.e. n / channels values.
+ Q: the quality factor, one value per frame, or NULL for the Q x was created with.
+ in, out, n: See Biquad_process.
+
+ Shares its state with Biquad_process, so both can be used alternately on the same instance.
+ */
+OSL_API void Biquad_processModulated(Biquad* x, const BiquadTable* table, const float* frequency, const float* Q,
+                                     float* in, float* out, int n);
+
+/* Allocates a cascade of sections second-order sections for the given number of channels. All sections pass their
+ input unchanged until set. */
+OSL_API BiquadCascade* BiquadCascade_new(int sections, int channels);
+
+/* Deletes an existing cascade. */
+OSL_API void BiquadCascade_free(BiquadCascade* x);
+
+/* Sets one section to a cookbook filter, with the parameters of Biquad_process. */
+OSL_API void BiquadCascade_setSection(BiquadCascade* x, int section, int type, float frequency, float Q, float gain,
+                                      float sampleRate);
+
+/* Sets one section to arbitrary coefficients, normalised so that a0 = 1. */
+OSL_API void BiquadCascade_setCoefficients(BiquadCascade* x, int section, float b0, float b1, float b2, float a1,
+                                           float a2);
+
+/* Resets the state of all sections. */
+OSL_API void BiquadCascade_clear(BiquadCascade* x);
+
+/* Processes n samples of INTERLEAVED (!) audio data through all sections. in and out can be identical. */
+OSL_API void BiquadCascade_process(BiquadCascade* x, float* in, float* out, int n);
+
 #ifdef __cplusplus
 }
 #endif
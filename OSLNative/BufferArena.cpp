@@ -0,0 +1,73 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "BufferArena.h"
+#include "util.h"
+#include <stdint.h>
+
+int BufferArena_Acquire(struct BufferArena* x) {
+    if (x->numFree > 0)
+        return x->freeSlots[--x->numFree];
+    if (x->numSlots < x->maxSlots)
+        return x->numSlots++;
+    return -1;
+}
+
+void BufferArena_Release(int slot, struct BufferArena* x) {
+    if (slot < 0 || slot >= x->numSlots)
+        return;
+    x->freeSlots[x->numFree++] = slot;
+}
+
+float* BufferArena_Get(int slot, struct BufferArena* x) {
+    return x->data + (size_t) slot * x->stride;
+}
+
+void BufferArena_Reset(struct BufferArena* x) {
+    x->numSlots = 0;
+    x->numFree = 0;
+}
+
+struct BufferArena* BufferArena_New(int maxSlots, int length) {
+    struct BufferArena* x = (struct BufferArena*) _malloc(sizeof(struct BufferArena));
+    int floatsPerLine = BUFFERARENA_ALIGNMENT / sizeof(float);
+    x->stride = (length + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+    x->maxSlots = maxSlots;
+    /// malloc only guarantees 8 or 16 bytes, so we over-allocate and align by hand
+    x->block = _malloc((size_t) maxSlots * x->stride * sizeof(float) + BUFFERARENA_ALIGNMENT);
+    uintptr_t p = ((uintptr_t) x->block + BUFFERARENA_ALIGNMENT - 1) & ~(uintptr_t) (BUFFERARENA_ALIGNMENT - 1);
+    x->data = (float*) p;
+    x->freeSlots = (int*) _malloc(maxSlots * sizeof(int));
+    BufferArena_Reset(x);
+    return x;
+}
+
+void BufferArena_Free(struct BufferArena* x) {
+    _free(x->block);
+    _free(x->freeSlots);
+    _free(x);
+}
@@ -0,0 +1,78 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// A pool of equally sized block buffers that are handed out by index.
+///
+/// Every slot starts on a 64-byte boundary (one cache line, and enough for any SIMD load), and slots are laid out back
+/// to back in one allocation. Released slots are reused in LIFO order, so the buffer that was freed last, which is most
+/// likely still in cache, is handed out first.
+///
+/// The arena is sized for the worst case in BufferArena_New(). Pages of slots that are never handed out are never
+/// touched, so on the usual platforms they do not cost physical memory either.
+///
+/// All functions are not thread-safe, hence the caller must avoid simultaneous access from multiple threads.
+
+#ifndef BufferArena_h
+#define BufferArena_h
+
+#include "main.h"
+
+#define BUFFERARENA_ALIGNMENT 64 // bytes
+
+struct BufferArena {
+    float* data; // first slot, aligned to BUFFERARENA_ALIGNMENT
+    void* block; // the allocation that contains data
+    int stride;  // floats per slot, rounded up to whole cache lines
+    int maxSlots;
+    int numSlots;   // slots handed out since the last reset, including released ones
+    int* freeSlots; // stack of released slots
+    int numFree;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Returns the index of an unused slot, or -1 if the arena is exhausted.
+int BufferArena_Acquire(struct BufferArena* x);
+/// Marks slot as unused. Its contents are kept until the slot is handed out again.
+void BufferArena_Release(int slot, struct BufferArena* x);
+/// Returns the buffer of slot.
+float* BufferArena_Get(int slot, struct BufferArena* x);
+/// Marks all slots as unused.
+void BufferArena_Reset(struct BufferArena* x);
+
+/// Allocates an arena with maxSlots slots of length floats each.
+struct BufferArena* BufferArena_New(int maxSlots, int length);
+/// Frees all resources.
+void BufferArena_Free(struct BufferArena* x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BufferArena_h */
@@ -32,110 +32,131 @@
 #include <algorithm>
 #include "util.h"
 #include <assert.h>
+#include <math.h>
 #include "resample.h"
 #include "RingBuffer.h"
 
 #define _MAX(a, b) a > b ? a : b
 #define _MIN(a, b) a < b ? a : b
 
-FrameRingBuffer* FrameRingBuffer_New(int n) {
-    FrameRingBuffer* x = new FrameRingBuffer();
-    x->data = (float*) _malloc(n * sizeof(float));
-    _fZero(x->data, n);
+#define FRAMERINGBUFFER_MIRROR CONV_LENGTH // samples behind the end, enough for a linear and a wsinc read
+#define FRAMERINGBUFFER_CHUNK 64           // samples whose read positions are computed in one go
+#define FRAMERINGBUFFER_REBASE 16          // rebase the positions once the oldest frame is this many buffers away
+#define FRAMERINGBUFFER_MAX_FRAMES 4096    // headers in the pool, see InsertFrame for when it is full
+
+/* The i-th frame, counting from the oldest one. */
+static inline FrameHeader* FrameRingBuffer_Header(int i, FrameRingBuffer* x) {
+    i += x->first;
+    if (i >= x->capacity)
+        i -= x->capacity;
+    return &x->headers[i];
+}
+
+/* Normalised position of the most recent frame's end, i.e. of the write pointer. */
+static inline double FrameRingBuffer_End(FrameRingBuffer* x) {
+    return x->count ? FrameRingBuffer_Header(x->count - 1, x)->end : x->start;
+}
+
+/* Copies the first samples behind the end of the buffer. */
+static void FrameRingBuffer_Mirror(FrameRingBuffer* x) {
+    for (int i = 0; i < FRAMERINGBUFFER_MIRROR; i++)
+        x->data[x->n + i] = x->data[i % x->n];
+}
+
+static void FrameRingBuffer_Reset(FrameRingBuffer* x) {
     x->ptr = 0;
-    x->n = n;
-    x->headers.push_back(FrameHeader());
-    x->headers[0].length = n;
+    x->first = 0;
+    x->count = 1;
+    x->start = 0;
+    x->headers[0].length = x->n;
     x->headers[0].oversampling = 1;
     x->headers[0].head = 0;
     x->headers[0].tail = 0;
+    x->headers[0].end = x->n;
+}
+
+FrameRingBuffer* FrameRingBuffer_New(int n) {
+    FrameRingBuffer* x = (FrameRingBuffer*) _malloc(sizeof(FrameRingBuffer));
+    x->data = (float*) _malloc((n + FRAMERINGBUFFER_MIRROR) * sizeof(float));
+    _fZero(x->data, n + FRAMERINGBUFFER_MIRROR);
+    x->n = n;
+    x->capacity = _min(n, FRAMERINGBUFFER_MAX_FRAMES);
+    x->headers = (FrameHeader*) _malloc(x->capacity * sizeof(FrameHeader));
+    FrameRingBuffer_Reset(x);
 
     return x;
 }
 
 void FrameRingBuffer_Free(FrameRingBuffer* x) {
+    _free(x->headers);
     _free(x->data);
     _free(x);
 }
 
 void InsertFrame(int n, float oversampling, FrameRingBuffer* x) {
-    int p = -1, length = 0, head = x->ptr, tail = head, delta1, delta2;
+    int length = 0, delta1;
+    double end = FrameRingBuffer_End(x);
     FrameHeader* existingFrame;
 
-    /*printv("\n\n=======Start:InsertAndRestore========\n");
-    printv("ptr: %d\n", x->ptr);
-    printv("n: %d\n", n);
-    printv("ptrFrame: %d\n", p);
-    printv("======\n");
-    printv("before insert:\n");
-    for(int i = 0; i < x->headers.size(); i++)
-    {
-        FrameHeader h = x->headers[i];
-        printv("%d: start=%d, length=%d, tail=%d, stride=%f\n", i, h.head, h.length, h.tail, h.oversampling);
-    }*/
-
-    /// 1. Consume existing frames until length is reached.
+    /// 1. Consume existing frames, starting with the oldest, until length is reached.
     while (length < n) {
-        p = (p + 1) % x->headers.size();
-        existingFrame = &x->headers[p];
+        existingFrame = FrameRingBuffer_Header(0, x);
         delta1 = n - length;
         /// 1a. The existing frame must be completely consumed, so we delete it.
         if (existingFrame->length <= delta1) {
             length += existingFrame->length;
-            x->headers.erase(x->headers.begin() + p);
-            p--;
+            x->start = existingFrame->end;
+            x->first = (x->first + 1) % x->capacity;
+            x->count--;
         }
         /// 1b. The existing frame does not need to be consumed completely, so we just decrease its size.
         else {
-            delta2 = existingFrame->length - delta1;
             existingFrame->head = (existingFrame->head + delta1) % x->n;
-            existingFrame->length = delta2;
+            existingFrame->length -= delta1;
+            x->start = existingFrame->end - (double) existingFrame->length * existingFrame->oversampling;
             length = n;
         }
     }
 
-    /// 2. If a previous frame exists and it has the same oversampling, we consume its samples and delete it.
+    /// 2. If a previous frame exists and it has the same oversampling, we append the samples to it.
     /// This way, we guarantee that adjacent frames always have different oversampling, except at array boundaries
-    if (x->headers.size() > 1) {
-        existingFrame = &x->headers[x->headers.size() - 1]; // most recent frame
-        if (existingFrame->oversampling == oversampling) {
-            length += existingFrame->length;
-            head = existingFrame->head;
-            x->headers.pop_back();
-        }
+    existingFrame = x->count > 1 ? FrameRingBuffer_Header(x->count - 1, x) : NULL; // most recent frame
+    if (existingFrame && existingFrame->oversampling == oversampling) {
+        existingFrame->length += n;
+        existingFrame->tail = (existingFrame->head + existingFrame->length) % x->n;
     }
 
-    /// 3. To guarantee no adjacent frames with same oversampling also at array boundaries, we could do the same check
-    /// as in 5. also for the NEXT frame. The code below is an incomplete stub; it does not work correctly. Use as an
-    /// inspiration if you want to extend.
-    /*if(x->headers.size() > 1)
-    {
-        existingFrame = &x->headers[0]; //nextFrame
-        if(existingFrame->oversampling == oversampling)
-        {
-            length += existingFrame->length;
-            x->headers.erase(x->headers.begin());
+    /// 3. Otherwise, we append a new frame header. It starts where the write pointer is.
+    else {
+        /// 3a. If the pool is full, the two oldest frames are merged into one. Its oversampling is chosen so that the
+        /// normalised length stays the same, so only the samples of these two frames, which are the next to be
+        /// overwritten, are read at a slightly different rate. No other read position moves.
+        if (x->count == x->capacity) {
+            FrameHeader* oldest = FrameRingBuffer_Header(0, x);
+            existingFrame = FrameRingBuffer_Header(1, x);
+            existingFrame->head = oldest->head;
+            existingFrame->length += oldest->length;
+            existingFrame->oversampling = (float) ((existingFrame->end - x->start) / existingFrame->length);
+            x->first = (x->first + 1) % x->capacity;
+            x->count--;
         }
-    }*/
 
-    /// 4. Finally, we calculate the new tail and insert the new frame header.
-    tail = (head + length) % x->n;
-    FrameHeader h;
-    h.oversampling = oversampling;
-    h.length = length;
-    h.head = head;
-    h.tail = tail;
-    x->headers.push_back(h);
-
-    // TODO: debug only
-    /*printv("after insert:\n");
-    for(int i = 0; i < x->headers.size(); i++)
-    {
-        FrameHeader h = x->headers[i];
-        printv("%d: start=%d, length=%d, tail=%d, stride=%f\n", i, h.head, h.length, h.tail, h.oversampling);
+        existingFrame = FrameRingBuffer_Header(x->count, x);
+        x->count++;
+        existingFrame->oversampling = oversampling;
+        existingFrame->length = n;
+        existingFrame->head = x->ptr;
+        existingFrame->tail = (x->ptr + n) % x->n;
+    }
+    end += (double) n * oversampling;
+    existingFrame->end = end;
+
+    /// 4. The positions only ever grow, so we move them back to 0 from time to time to keep their precision.
+    if (x->start > FRAMERINGBUFFER_REBASE * (end - x->start)) {
+        for (int i = 0; i < x->count; i++)
+            FrameRingBuffer_Header(i, x)->end -= x->start;
+        x->start = 0;
     }
-    bool legit = FrameRingBuffer_Validate(x);
-    printv("=======End:InsertAndRestore========\n\n\n");*/
 }
 
 /* This is efficient as long as n is reasonably large, e.g. writing buffers of 256 samples. */
@@ -145,6 +166,8 @@ void FrameRingBuffer_Write(float* src, int n, float oversampling, FrameRingBuffe
         src = src + (n - x->n);
         n = x->n;
     }
+    if (n <= 0)
+        return;
 
     /// 2. Insert new frame header
     InsertFrame(n, oversampling, x);
@@ -159,6 +182,9 @@ void FrameRingBuffer_Write(float* src, int n, float oversampling, FrameRingBuffe
         memcpy(x->data, src, m * sizeof(float));
         x->ptr = m; // bc x->ptr is 0 if we reach this block
     }
+    if (x->ptr == x->n)
+        x->ptr = 0;
+    FrameRingBuffer_Mirror(x);
 }
 
 void FrameRingBuffer_GetFrame(int sampleIndex, int* frameIndex, float* frameOffset, FrameRingBuffer* x) {
@@ -166,8 +192,8 @@ void FrameRingBuffer_GetFrame(int sampleIndex, int* frameIndex, float* frameOffs
         sampleIndex += x->n;
 
     FrameHeader* h;
-    for (int i = 0; i < x->headers.size(); i++) {
-        h = &x->headers[i];
+    for (int i = 0; i < x->count; i++) {
+        h = FrameRingBuffer_Header(i, x);
         if (h->head == h->tail) {
             *frameIndex = i;
             *frameOffset = (float) (sampleIndex - h->head);
@@ -189,207 +215,153 @@ void FrameRingBuffer_GetFrame(int sampleIndex, int* frameIndex, float* frameOffs
     assert(false);
 }
 
-// Normalize value to samplerate of 1. Is identical to _convert(numSamples, srcOversampling, 1.0f).
-inline double _normalize(double numSamples, double oversampling) {
-    return numSamples * oversampling;
-}
-
-// Convert numSamples from srcOversampliing to targetOversampling.
-inline double _convert(double numSamples, double srcOversampling, double targetOversampling) {
-    return numSamples / targetOversampling * srcOversampling;
+/* The oldest frame whose end lies beyond the normalised position, by binary search over the frame ends. */
+static int FrameRingBuffer_FindFrame(double position, FrameRingBuffer* x) {
+    int lo = 0, hi = x->count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (FrameRingBuffer_Header(mid, x)->end > position)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
 }
 
-// Note: The occasional use of double precision is intended here, as using single precision can cause offsets of
-// multiple samples!
-float FrameRingBuffer_Read(float* dest, int n, int offset, float oversampling, int interpolation, FrameRingBuffer* x) {
-    assert(offset < 0);
-    assert(oversampling > 0);
-    assert(abs(offset) <= x->n);
-    assert(n <= x->n);
-
-    int headerIndex = x->headers.size();
-    double samplesInFrame;
-    double samplesNeeded = _normalize((double) -offset, (double) oversampling);
-    FrameHeader* header = NULL;
-
-    /// 1. Back-trace the frame headers to find where to start reading from
-    while (samplesNeeded > 0) {
-        headerIndex--;
-        if (headerIndex < 0)
-            headerIndex = x->headers.size() - 1;
-        header = &(x->headers[headerIndex]);
-        samplesInFrame = _normalize((double) header->length, (double) header->oversampling);
-        samplesNeeded -= samplesInFrame;
+/* Reads n samples, the first one located distance normalised samples before the write pointer. Every sample i is
+ followed by the next one after x->n / delays[i] normalised samples, or after step if delays is NULL. Reading further
+ back than the buffer reaches wraps around, as the frames form a ring.
+
+ Positions are computed in double precision for a chunk of samples at a time, as a running sum of the steps. Single
+ precision can cause offsets of multiple samples! The positions are then converted to buffer indices in runs of
+ samples that lie in the same frame, and finally the samples are interpolated. */
+static float FrameRingBuffer_ReadNormalised(float* dest, int n, double distance, const float* delays, double step,
+                                            int interpolation, FrameRingBuffer* x) {
+    double end = FrameRingBuffer_End(x), total = end - x->start;
+    if (distance > total) {
+        distance = fmod(distance, total);
+        if (distance <= 0)
+            distance = total;
     }
 
-    int ptr;
-    double fPtr = header->head; // the start index of the frame in which the first sample to read is located
-
-    /// At this point, samplesNeeded is either 0 or negative; negative meaning we backtracked "too far", so we have to
-    /// start reading somewhere in the middle of the frame. In other words: The position to start reading from is in the
-    /// current frame with an offset of (-samplesNeeded).
-    samplesNeeded = -samplesNeeded;
-    float frac, a, b;
-    int wsincPtr;
-
-    /// 2. Copy n samples into the destination buffer
-    for (int i = 0; i < n; i++) {
-        /// To advance 1 sample from the reader's perspective, we have to take into account oversampling rates as
-        /// follows:
-        fPtr += _convert(samplesNeeded, 1.0, (double) header->oversampling);
-        if (fPtr >= x->n)
-            fPtr -= x->n;
-
-        if (interpolation == INTERPOLATION_LINEAR) {
-            ptr = (int) fPtr;
-            frac = fPtr - ptr;
-            a = x->data[ptr];
-            b = x->data[(ptr + 1) % x->n];
-
-            dest[i] = a + frac * (b - a); // bc (1-c)a + cb = a + c(b-a)
-        } else if (interpolation == INTERPOLATION_NONE) {
-            ptr = (int) (fPtr + 0.5f) % x->n;
-            /// Sometimes it still happens that ptr == tail, which is not correct, ptr should always be < tail... reason
-            /// is probably floating point imprecision / rounding errors. Quickfix for now:
-            if (ptr == header->tail)
-                ptr = _MAX(0, ptr - 1);
-            dest[i] = x->data[ptr];
-        } else if (interpolation == INTERPOLATION_WSINC) {
-            ptr = (int) (fPtr + 0.5f);
-            frac = fPtr - ptr;
-            ptr = ptr % x->n;
-            wsincPtr = ptr - ZEROCROSSINGS_PER_AXIS;
-            if (wsincPtr < 0)
-                wsincPtr += x->n;
-            for (int j = 0; j < CONV_LENGTH; j++) {
-                wsinc_convBuffer[j] = x->data[wsincPtr];
-                wsincPtr = (wsincPtr + 1) % x->n;
-            }
-            dest[i] = wsinc_resample(wsinc_convBuffer, -frac);
+    double position = end - distance, shift = 0; // shift: total for every time the reader wrapped around the ring
+    double steps[FRAMERINGBUFFER_CHUNK], positions[FRAMERINGBUFFER_CHUNK];
+    int indices[FRAMERINGBUFFER_CHUNK];
+    float fractions[FRAMERINGBUFFER_CHUNK];
+    float lastIndex = 0;
+    int frame = FrameRingBuffer_FindFrame(position, x);
+    FrameHeader* header = FrameRingBuffer_Header(frame, x);
+
+    for (int i = 0; i < n; i += FRAMERINGBUFFER_CHUNK) {
+        int m = _min(FRAMERINGBUFFER_CHUNK, n - i);
+
+        /// 1. The normalised position of every sample
+        if (delays) {
+            for (int j = 0; j < m; j++)
+                steps[j] = (double) x->n / delays[i + j];
+        } else {
+            std::fill(steps, steps + m, step);
         }
-
-        /// we advanced samplesNeeded samples into the frame, so they are not available anymore.
-        samplesInFrame -= samplesNeeded;
-
-        /// We copied a sample, so we need 1 whole new sample now.
-        samplesNeeded = oversampling;
-
-        /// Skip frame(s) if they don't contain the next sample to read:
-        while (samplesInFrame < samplesNeeded) {
-            // assert(i != 0); //in first iteration we should always be in the correct frame
-            samplesNeeded -= samplesInFrame;
-            headerIndex = (headerIndex + 1) % x->headers.size();
-            header = &x->headers[headerIndex];
-            samplesInFrame = _normalize((double) header->length, (double) header->oversampling);
-            fPtr = header->head;
+        for (int j = 0; j < m; j++) {
+            positions[j] = position;
+            position += steps[j];
         }
-    }
 
-    return fPtr;
-}
+        /// 2. Buffer indices, frame by frame. A run ends at the first sample beyond its frame's end.
+        for (int j = 0; j < m;) {
+            while (positions[j] - shift > header->end) {
+                if (++frame == x->count) {
+                    frame = 0;
+                    shift += total;
+                }
+                header = FrameRingBuffer_Header(frame, x);
+            }
 
-float FrameRingBuffer_Read2(float* dest, int n, int offsetTotal, float* offsets, int singleValueDelay,
-                            int interpolation, FrameRingBuffer* x) {
-    int headerIndex = x->headers.size();
-    double samplesInFrame;
-    double samplesNeeded = (double) -offsetTotal;
-    FrameHeader* header = NULL;
-    double oversampling = (double) x->n / *offsets; // only used if singleValueDelay == true
-
-    /// 1. Back-trace the frame headers to find where to start reading from
-    while (samplesNeeded > 0) {
-        headerIndex--;
-        if (headerIndex < 0)
-            headerIndex = x->headers.size() - 1;
-        header = &(x->headers[headerIndex]);
-        samplesInFrame = _normalize((double) header->length, (double) header->oversampling);
-        samplesNeeded -= samplesInFrame;
-    }
+            double limit = header->end + shift;
+            double base = limit - (double) header->length * header->oversampling;
+            double scale = 1.0 / header->oversampling;
+            int run = j + 1;
+            while (run < m && positions[run] <= limit)
+                run++;
+
+            int head = header->head, length = header->length, nBuf = x->n;
+            if (interpolation == INTERPOLATION_NONE) {
+                for (int k = j; k < run; k++) {
+                    int r = (int) ((positions[k] - base) * scale + 0.5);
+                    r = r < length ? r : length - 1; // rounding must not leave the frame
+                    r += head;
+                    indices[k] = r >= nBuf ? r - nBuf : r;
+                    fractions[k] = 0;
+                }
+            } else if (interpolation == INTERPOLATION_WSINC) {
+                for (int k = j; k < run; k++) {
+                    double offset = (positions[k] - base) * scale;
+                    int r = (int) (offset + 0.5);
+                    fractions[k] = (float) (offset - r);
+                    r += head - ZEROCROSSINGS_PER_AXIS;
+                    r = r < 0 ? r + nBuf : r;
+                    indices[k] = r >= nBuf ? r - nBuf : r;
+                }
+            } else {
+                for (int k = j; k < run; k++) {
+                    double offset = (positions[k] - base) * scale;
+                    int r = (int) offset;
+                    fractions[k] = (float) (offset - r);
+                    r += head;
+                    indices[k] = r >= nBuf ? r - nBuf : r;
+                }
+            }
+            lastIndex = (float) fmod(head + (positions[run - 1] - base) * scale, nBuf);
+            j = run;
+        }
 
-    int ptr;
-    double fPtr = header->head; // the start index of the frame in which the first sample to read is located
-
-    /// At this point, samplesNeeded is either 0 or negative; negative meaning we backtracked "too far", so we have to
-    /// start reading somewhere in the middle of the frame. In other words: The position to start reading from is in the
-    /// current frame with an offset of (-samplesNeeded).
-    samplesNeeded = -samplesNeeded;
-    float frac, a, b;
-    int wsincPtr;
-
-    /// 2. Copy n samples into the destination buffer
-    for (int i = 0; i < n; i++) {
-        /// To advance 1 sample from the reader's perspective, we have to take into account oversampling rates as
-        /// follows:
-        fPtr += _convert(samplesNeeded, 1.0, (double) header->oversampling);
-        if (fPtr >= x->n)
-            fPtr -= x->n;
-
-        if (interpolation == INTERPOLATION_LINEAR) {
-            ptr = (int) fPtr;
-            frac = fPtr - ptr;
-            a = x->data[ptr];
-            b = x->data[(ptr + 1) % x->n];
-
-            dest[i] = a + frac * (b - a); // bc (1-c)a + cb = a + c(b-a)
-        } else if (interpolation == INTERPOLATION_NONE) {
-            ptr = (int) (fPtr + 0.5f) % x->n;
-            /// Sometimes it still happens that ptr == tail, which is not correct, ptr should always be < tail... reason
-            /// is probably floating point imprecision / rounding errors. Quickfix for now:
-            if (ptr == header->tail)
-                ptr = _MAX(0, ptr - 1);
-            dest[i] = x->data[ptr];
+        /// 3. Copy m samples into the destination buffer
+        float* d = dest + i;
+        const float* data = x->data;
+        if (interpolation == INTERPOLATION_NONE) {
+            for (int j = 0; j < m; j++)
+                d[j] = data[indices[j]];
         } else if (interpolation == INTERPOLATION_WSINC) {
-            ptr = (int) (fPtr + 0.5f);
-            frac = fPtr - ptr;
-            ptr = ptr % x->n;
-            wsincPtr = ptr - ZEROCROSSINGS_PER_AXIS;
-            if (wsincPtr < 0)
-                wsincPtr += x->n;
-            for (int j = 0; j < CONV_LENGTH; j++) {
-                wsinc_convBuffer[j] = x->data[wsincPtr];
-                wsincPtr = (wsincPtr + 1) % x->n;
+            for (int j = 0; j < m; j++)
+                d[j] = wsinc_resample(x->data + indices[j], fractions[j]);
+        } else {
+            for (int j = 0; j < m; j++) {
+                float a = data[indices[j]], b = data[indices[j] + 1]; // the mirror saves the modulus
+                d[j] = a + fractions[j] * (b - a);                     // bc (1-c)a + cb = a + c(b-a)
             }
-            dest[i] = wsinc_resample(wsinc_convBuffer, -frac);
         }
+    }
 
-        /// we advanced samplesNeeded samples into the frame, so they are not available anymore.
-        samplesInFrame -= samplesNeeded;
+    return lastIndex;
+}
 
-        /// We copied a sample, so we need 1 whole new sample now.
-        samplesNeeded = singleValueDelay ? oversampling : (double) x->n / offsets[i];
+float FrameRingBuffer_Read(float* dest, int n, int offset, float oversampling, int interpolation, FrameRingBuffer* x) {
+    assert(offset < 0);
+    assert(oversampling > 0);
+    assert(abs(offset) <= x->n);
+    assert(n <= x->n);
 
-        /// Skip frame(s) if they don't contain the next sample to read:
-        while (samplesInFrame < samplesNeeded) {
-            // assert(i != 0); //in first iteration we should always be in the correct frame
-            samplesNeeded -= samplesInFrame;
-            headerIndex = (headerIndex + 1) % x->headers.size();
-            header = &x->headers[headerIndex];
-            samplesInFrame = _normalize((double) header->length, (double) header->oversampling);
-            fPtr = header->head;
-        }
-    }
+    return FrameRingBuffer_ReadNormalised(dest, n, (double) -offset * oversampling, NULL, oversampling, interpolation,
+                                          x);
+}
 
-    return fPtr;
+float FrameRingBuffer_Read2(float* dest, int n, int offsetTotal, float* offsets, int singleValueDelay,
+                            int interpolation, FrameRingBuffer* x) {
+    return FrameRingBuffer_ReadNormalised(dest, n, (double) -offsetTotal, singleValueDelay ? NULL : offsets,
+                                          (double) x->n / *offsets, interpolation, x);
 }
 
 void FrameRingBuffer_Clear(FrameRingBuffer* x) {
-    _fZero(x->data, x->n);
-    x->headers.clear();
-    FrameHeader h;
-    h.length = x->n;
-    h.head = 0;
-    h.tail = 0;
-    h.oversampling = 1;
-    x->headers.emplace_back(h);
-    x->ptr = 0;
+    _fZero(x->data, x->n + FRAMERINGBUFFER_MIRROR);
+    FrameRingBuffer_Reset(x);
 }
 
 bool FrameRingBuffer_Validate(FrameRingBuffer* x) {
     bool legit = true;
 
     int numSmpls = 0;
-    for (int i = 0; i < x->headers.size(); i++)
-        numSmpls += x->headers[i].length;
+    for (int i = 0; i < x->count; i++)
+        numSmpls += FrameRingBuffer_Header(i, x)->length;
     if (numSmpls != x->n) {
         printv("VALIDATION FAILED: the buffer contains %d samples, but the headers sum up to %d samples: \n", x->n,
                numSmpls);
@@ -397,10 +369,10 @@ bool FrameRingBuffer_Validate(FrameRingBuffer* x) {
     }
 
     int adjacentFramesWithSameStride = 0;
-    if (x->headers.size() > 1) {
-        for (int i = 0; i < x->headers.size(); i++) {
-            float stride1 = x->headers[i].oversampling;
-            float stride2 = x->headers[(i + 1) % x->headers.size()].oversampling;
+    if (x->count > 1) {
+        for (int i = 0; i < x->count; i++) {
+            float stride1 = FrameRingBuffer_Header(i, x)->oversampling;
+            float stride2 = FrameRingBuffer_Header((i + 1) % x->count, x)->oversampling;
             if (stride1 == stride2)
                 adjacentFramesWithSameStride++;
         }
@@ -414,12 +386,16 @@ bool FrameRingBuffer_Validate(FrameRingBuffer* x) {
     }
 
     int corruptCounds = 0;
-    for (int i = 0; i < x->headers.size(); i++) {
-        int tail = (x->headers[i].head + x->headers[i].length) % x->n;
-        int nextHead = x->headers[(i + 1) % x->headers.size()].head;
-        if (tail != nextHead || tail != x->headers[i].tail) {
+    double start = x->start;
+    for (int i = 0; i < x->count; i++) {
+        FrameHeader* h = FrameRingBuffer_Header(i, x);
+        int tail = (h->head + h->length) % x->n;
+        int nextHead = FrameRingBuffer_Header((i + 1) % x->count, x)->head;
+        double length = (double) h->length * h->oversampling;
+        if (tail != nextHead || tail != h->tail || fabs(h->end - start - length) > 1e-6 * length) {
             corruptCounds++;
         }
+        start = h->end;
     }
     if (corruptCounds != 0) {
         printv("VALIDATION FAILED: the buffer contains %d corrupt bounds. \n", corruptCounds);
@@ -437,9 +413,10 @@ void FrameRingBuffer_Print(FrameRingBuffer* x) {
     printv("======\n");
     printv("HEADERS:\n");
     FrameHeader h;
-    for (int i = 0; i < x->headers.size(); i++) {
-        h = x->headers[i];
-        printv("%d: start=%d, length=%d, tail=%d, stride=%f\n", i, h.head, h.length, h.tail, h.oversampling);
+    for (int i = 0; i < x->count; i++) {
+        h = *FrameRingBuffer_Header(i, x);
+        printv("%d: start=%d, length=%d, tail=%d, stride=%f, end=%f\n", i, h.head, h.length, h.tail, h.oversampling,
+               h.end);
     }
     printv("======\n");
     /*printv("BUFFER:\n");
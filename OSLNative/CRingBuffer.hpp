@@ -47,30 +47,38 @@
 /// 5. Frames are non-overlapping
 /// 6. Frames cover the whole ringbuffer
 ///
-/// The RingBuffer itself is identical to RingBuffer.cpp. The frames are stored in an additional vector of FrameHeader
-/// metastructs. The overhead for storing the frames is very small.
+/// The RingBuffer itself is identical to RingBuffer.cpp, except that the first samples are mirrored behind its end so
+/// that the interpolators can read contiguously. The frames are stored in an additional ring of FrameHeader
+/// metastructs, from the oldest to the most recent one. Every header also holds the sum of the normalised lengths
+/// (length * oversampling) of all frames up to and including itself, so a read finds its start frame by binary search
+/// instead of walking the headers, and then reads frame by frame in runs of samples.
+///
+/// The number of frames is limited by a fixed pool of headers. If it is full, the two oldest frames are merged, which
+/// slightly changes the rate at which the oldest samples are read back.
 ///
 /// FrameRingBuffer is not thread-safe.
 
 #ifndef CRingBuffer_hpp
 #define CRingBuffer_hpp
 
-#include <vector>
-
-using std::vector;
-
 typedef struct _FrameHeader {
     int head; // inclusive
     int tail; // exclusive
     int length;
     float oversampling;
+    double end; // normalised position of the frame's end, i.e. start + sum of all normalised lengths up to this frame
 } FrameHeader;
 
 typedef struct _FrameRingBuffer {
-    float* data;
+    float* data; // n samples, followed by a copy of the first ones
     int ptr;
     int n;
-    vector<FrameHeader> headers;
+
+    FrameHeader* headers; // ring of capacity headers, holding count frames from the oldest one at index first on
+    int capacity;         // allocated once, writing never allocates or frees memory
+    int first;
+    int count;
+    double start; // normalised position of the oldest frame's head
 } FrameRingBuffer;
 
 /* Writing into the buffer */
@@ -0,0 +1,394 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Clip.h"
+#include "SamplePool.h"
+#include "Signal.h"
+#include "resample.h"
+#include "util.h"
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+
+#define CLIP_ONE ((int64_t) 1 << 32) // 1 sample in the fixed-point playhead
+
+static inline int64_t Clip_ToFixed(double position) {
+    return (int64_t) floor(position * 4294967296.0);
+}
+
+static inline double Clip_ToDouble(int64_t playhead) {
+    return playhead / 4294967296.0;
+}
+
+/// The last two decoded ADPCM blocks, indexed by the parity of the block, so the two frames of an interpolation never
+/// evict each other.
+struct ClipAdpcmCache {
+    int block[2];
+    float frames[2][SAMPLECODEC_ADPCM_BLOCK * SAMPLECODEC_ADPCM_MAXCHANNELS];
+};
+
+static inline const float* Clip_AdpcmFrame(int frame, const void* clip, int clipChannels, ClipAdpcmCache& cache) {
+    int block = frame >> SAMPLECODEC_ADPCM_SHIFT;
+    int slot = block & 1;
+    if (cache.block[slot] != block) {
+        SampleCodec_DecodeAdpcmBlock(clip, block, clipChannels, cache.frames[slot]);
+        cache.block[slot] = block;
+    }
+    return cache.frames[slot] + (frame & (SAMPLECODEC_ADPCM_BLOCK - 1)) * clipChannels;
+}
+
+/// Decodes the frames [from, from + n) into planar left and right buffers. Frames outside of the bounds repeat the
+/// first or last frame, so the taps of the wider interpolations never read outside of the clip.
+static void Clip_Fill(float* left, float* right, int from, int n, int lower, int upper, const void* clip,
+                      int clipChannels, int clipFormat, ClipAdpcmCache& cache) {
+    int second = clipChannels == 2 ? 1 : 0; // mono clips are played on both channels
+    for (int k = 0; k < n; k++) {
+        int frame = from + k < lower ? lower : (from + k > upper ? upper : from + k);
+        if (clipFormat == SAMPLECODEC_ADPCM) {
+            const float* a = Clip_AdpcmFrame(frame, clip, clipChannels, cache);
+            left[k] = a[0];
+            right[k] = a[second];
+        } else if (clipFormat == SAMPLECODEC_INT16) {
+            const int16_t* a = (const int16_t*) clip + frame * clipChannels;
+            left[k] = SampleCodec_Int16(a[0]);
+            right[k] = SampleCodec_Int16(a[second]);
+        } else {
+            const float* a = (const float*) clip + frame * clipChannels;
+            left[k] = a[0];
+            right[k] = a[second];
+        }
+    }
+}
+
+/// Catmull-Rom spline through x[0] to x[3], between x[1] and x[2].
+static inline float Clip_Cubic(const float* x, float t) {
+    return x[1] + 0.5f * t *
+                      (x[2] - x[0] +
+                       t * (2.f * x[0] - 5.f * x[1] + 4.f * x[2] - x[3] + t * (3.f * (x[1] - x[2]) + x[3] - x[0])));
+}
+
+static_assert(CLIP_SINC_TAPS == WSINC_POLYPHASE_TAPS, "the window of a chunk must fit the polyphase sinc");
+
+/// One sinc output frame. The coefficients are interpolated between two rows of the polyphase table. The products are
+/// summed in a fixed tree instead of a running sum, so the compiler can vectorise both loops without having to reorder
+/// float additions.
+static inline void Clip_Sinc(const float* __restrict left, const float* __restrict right,
+                             const float* __restrict row, const float* __restrict nextRow, float w, bool stereo,
+                             float& outLeft, float& outRight) {
+    float l[CLIP_SINC_TAPS], r[CLIP_SINC_TAPS];
+    for (int k = 0; k < CLIP_SINC_TAPS; k++) {
+        float c = row[k] + w * (nextRow[k] - row[k]);
+        l[k] = c * left[k];
+        r[k] = c * right[k];
+    }
+    for (int k = 0; k < CLIP_SINC_TAPS / 2; k++) {
+        l[k] += l[k + CLIP_SINC_TAPS / 2];
+        r[k] += r[k + CLIP_SINC_TAPS / 2];
+    }
+    for (int k = 0; k < 4; k++) { // 12 -> 4
+        l[k] += l[k + 4] + l[k + 8];
+        r[k] += r[k + 4] + r[k + 8];
+    }
+    outLeft = (l[0] + l[2]) + (l[1] + l[3]);
+    outRight = stereo ? (r[0] + r[2]) + (r[1] + r[3]) : outLeft;
+}
+
+/// ClipSignalGenerator() for clip data in any SAMPLECODEC_ format and with any INTERPOLATION_ mode.
+static double Clip_Generate(float buffer[], float freqExpBuffer[], float freqLinBuffer[], float ampBuffer[],
+                            float seqBuffer[], int length, float lastSeqGen[2], int channels, bool freqExpGen,
+                            bool freqLinGen, bool ampGen, bool seqGen, double floatingBufferCount,
+                            int sampleBounds[2], float playbackSpeed, float lastPlaybackSpeed, const void* clip,
+                            int clipChannels, int clipFormat, float amplitude, float lastAmplitude, bool looping,
+                            bool& active, int windowLength, int interpolation) {
+    // clip not yet or not available anymore; outdated pointers are not detected here, see ClipSignalGeneratorPooled()
+    if (!clip) {
+        return floatingBufferCount;
+    }
+
+    const float* clipdata = (const float*) clip;
+    const int16_t* clipdata16 = (const int16_t*) clip;
+    ClipAdpcmCache cache;
+    cache.block[0] = cache.block[1] = -1;
+    int frames = length / channels;
+    int64_t start = (int64_t) sampleBounds[0] << 32;
+    int64_t end = (int64_t) sampleBounds[1] << 32;
+    int64_t range = end - start;
+    int64_t playhead = Clip_ToFixed(floatingBufferCount);
+
+    /// A constant exp fm input only needs one pow() per block
+    float freqExpValue;
+    bool freqExpConst = freqExpGen && Signal_Classify(freqExpBuffer, length, &freqExpValue) != SIGNAL_AUDIO;
+    float freqExpFactor = freqExpConst ? powf(2, _clamp(freqExpValue, -1.f, 1.f) * 10.f) : 1.f;
+
+    float increments[CLIP_CHUNK];
+    int32_t index[CLIP_CHUNK]; // left sample of the interpolation
+    int32_t next[CLIP_CHUNK];  // right sample, the same as index if the playhead sits exactly on a sample
+    float frac[CLIP_CHUNK];
+    float position[CLIP_CHUNK]; // playhead for the window
+    bool live[CLIP_CHUNK];      // frames are only written while the clip is active
+    float left[CLIP_CHUNK];
+    float right[CLIP_CHUNK];
+    float gain[CLIP_CHUNK];
+    int offset[CLIP_CHUNK];        // first tap of every frame in the window, CUBIC and WSINC only
+    float windowLeft[CLIP_WINDOW]; // planar decoded frames, CUBIC and WSINC only
+    float windowRight[CLIP_WINDOW];
+    bool gathered = interpolation == INTERPOLATION_CUBIC || interpolation == INTERPOLATION_WSINC;
+    int taps = interpolation == INTERPOLATION_CUBIC ? 4 : CLIP_SINC_TAPS;
+    int tapsBefore = interpolation == INTERPOLATION_CUBIC ? 1 : ZEROCROSSINGS_PER_AXIS; // taps left of the index
+
+    for (int chunk = 0; chunk < frames; chunk += CLIP_CHUNK) {
+        int m = frames - chunk < CLIP_CHUNK ? frames - chunk : CLIP_CHUNK;
+
+        /// 1. Playhead increment per frame
+        for (int j = 0; j < m; j++) {
+            float t = (float) ((chunk + j) * channels) / length;
+            float speed = lastPlaybackSpeed + t * (playbackSpeed - lastPlaybackSpeed); // slope limiting
+            increments[j] = speed * freqExpFactor;
+        }
+        if (freqExpGen && !freqExpConst) {
+            for (int j = 0; j < m; j++) // exp fm, upscale 0.1V/Oct to 1V/Oct
+                increments[j] *= powf(2, _clamp(freqExpBuffer[(chunk + j) * channels], -1.f, 1.f) * 10.f);
+        }
+        if (freqLinGen) {
+            for (int j = 0; j < m; j++)
+                increments[j] += freqLinBuffer[(chunk + j) * channels] * 20.f; // lin fm
+        }
+
+        /// 2. Advancing the playhead, sample by sample
+        int numLive = 0;
+        for (int j = 0; j < m; j++) {
+            int i = (chunk + j) * channels;
+            if (active)
+                playhead += (int64_t) (increments[j] * 4294967296.0);
+
+            bool endOfSample = false;
+            if (playhead > end) {
+                endOfSample = true;
+                if (range > 0)
+                    playhead = (playhead - start) % range + start + CLIP_ONE; // wrap over playhead offset
+            } else if (playhead < start + CLIP_ONE) {
+                // still needed? this introduces problems when resetting to 0 (instead of 1) while having playback
+                // speeds below 1, this will always be caught here and then playback stops immediately
+                endOfSample = true;
+                if (range > 0)
+                    playhead = end - (playhead - start) % range; // wrap over playhead offset
+            }
+
+            if (endOfSample && !looping)
+                active = false;
+
+            if (seqGen) {
+                if (seqBuffer[i] > 0.f && lastSeqGen[0] <= 0.f) {
+                    // WARNING: resetting to 0 (instead of 0 + 1) would mean that playback does not work anymore for
+                    // speeds lower than 1f. It would always floor() to 0 and would not move through the file anymore.
+                    playhead = playbackSpeed >= 0 ? start + CLIP_ONE : end;
+                    active = true;
+                }
+                lastSeqGen[0] = seqBuffer[i];
+            }
+
+            /// inactive frames are not read, so they must not point outside of the clip either
+            int64_t read = active ? playhead : start;
+            if (interpolation == INTERPOLATION_NONE)
+                read = (read + CLIP_ONE / 2) & ~(CLIP_ONE - 1); // nearest sample, fraction 0
+            uint32_t fraction = (uint32_t) read;
+            index[j] = (int32_t) (read >> 32);
+            next[j] = index[j] + (fraction != 0);
+            frac[j] = fraction * (1.f / 4294967296.f);
+            position[j] = (float) Clip_ToDouble(playhead);
+            live[j] = active;
+            numLive += active;
+        }
+
+        if (numLive == 0)
+            continue;
+
+        /// 3. Gather from the interleaved clip data, decode and interpolate
+        if (gathered) {
+            /// Decode the frames that the taps of the chunk cover once. If they are too far apart for the window, e.g.
+            /// after a wrap, every frame gets its own taps in the window instead.
+            int lowest = index[0], highest = index[0];
+            for (int j = 1; j < m; j++) {
+                lowest = std::min(lowest, index[j]);
+                highest = std::max(highest, index[j]);
+            }
+            int from = lowest - tapsBefore;
+            int span = highest - lowest + taps;
+            if (span <= CLIP_WINDOW) {
+                Clip_Fill(windowLeft, windowRight, from, span, sampleBounds[0], sampleBounds[1], clip, clipChannels,
+                          clipFormat, cache);
+                for (int j = 0; j < m; j++)
+                    offset[j] = index[j] - from;
+            } else {
+                for (int j = 0; j < m; j++) {
+                    offset[j] = j * taps + tapsBefore;
+                    Clip_Fill(windowLeft + j * taps, windowRight + j * taps, index[j] - tapsBefore, taps,
+                              sampleBounds[0], sampleBounds[1], clip, clipChannels, clipFormat, cache);
+                }
+            }
+
+            if (interpolation == INTERPOLATION_CUBIC) {
+                for (int j = 0; j < m; j++) {
+                    left[j] = Clip_Cubic(windowLeft + offset[j] - 1, frac[j]);
+                    right[j] = Clip_Cubic(windowRight + offset[j] - 1, frac[j]);
+                }
+            } else {
+                const float* sinc = wsinc_polyphase_table();
+                for (int j = 0; j < m; j++) {
+                    float phase = frac[j] * WSINC_POLYPHASE_PHASES;
+                    int row = (int) phase;
+                    Clip_Sinc(windowLeft + offset[j] - tapsBefore, windowRight + offset[j] - tapsBefore,
+                              sinc + row * CLIP_SINC_TAPS, sinc + (row + 1) * CLIP_SINC_TAPS, phase - row,
+                              clipChannels == 2, left[j], right[j]);
+                }
+            }
+        } else if (clipFormat == SAMPLECODEC_ADPCM) {
+            for (int j = 0; j < m; j++) {
+                const float* a = Clip_AdpcmFrame(index[j], clip, clipChannels, cache);
+                const float* b = Clip_AdpcmFrame(next[j], clip, clipChannels, cache);
+                left[j] = a[0] + frac[j] * (b[0] - a[0]);
+                right[j] = clipChannels == 2 ? a[1] + frac[j] * (b[1] - a[1]) : left[j];
+            }
+        } else if (clipFormat == SAMPLECODEC_INT16 && clipChannels == 2) {
+            for (int j = 0; j < m; j++) {
+                const int16_t* a = clipdata16 + index[j] * 2;
+                const int16_t* b = clipdata16 + next[j] * 2;
+                float a0 = SampleCodec_Int16(a[0]), a1 = SampleCodec_Int16(a[1]);
+                left[j] = a0 + frac[j] * (SampleCodec_Int16(b[0]) - a0);
+                right[j] = a1 + frac[j] * (SampleCodec_Int16(b[1]) - a1);
+            }
+        } else if (clipFormat == SAMPLECODEC_INT16) {
+            for (int j = 0; j < m; j++) {
+                float a = SampleCodec_Int16(clipdata16[index[j] * clipChannels]);
+                float b = SampleCodec_Int16(clipdata16[next[j] * clipChannels]);
+                left[j] = right[j] = a + frac[j] * (b - a);
+            }
+        } else if (clipChannels == 2) {
+            for (int j = 0; j < m; j++) {
+                const float* a = clipdata + index[j] * 2;
+                const float* b = clipdata + next[j] * 2;
+                left[j] = a[0] + frac[j] * (b[0] - a[0]);
+                right[j] = a[1] + frac[j] * (b[1] - a[1]);
+            }
+        } else {
+            for (int j = 0; j < m; j++) {
+                float a = clipdata[index[j] * clipChannels];
+                float b = clipdata[next[j] * clipChannels];
+                left[j] = right[j] = a + frac[j] * (b - a);
+            }
+        }
+
+        /// 4. Amplitude and window ramps
+        for (int j = 0; j < m; j++) {
+            float t = (float) ((chunk + j) * channels) / length;
+            gain[j] = lastAmplitude + t * (amplitude - lastAmplitude); // slope limiting
+        }
+        if (ampGen) {
+            for (int j = 0; j < m; j++)
+                gain[j] *= ampBuffer[(chunk + j) * channels]; // -1,1, allows for ring modulation
+        }
+        if (windowLength != 0) {
+            /// Linear fade-in from the start and fade-out towards the end. Left of the center, the fade-in is always
+            /// the smaller one, so the minimum picks the right ramp without a branch.
+            float lower = (float) sampleBounds[0], upper = (float) sampleBounds[1];
+            float scale = 1.f / windowLength;
+            for (int j = 0; j < m; j++) {
+                float in = (position[j] - lower) * scale;
+                float out = (upper - position[j]) * scale;
+                gain[j] *= std::max(std::min(std::min(in, out), 1.f), 0.f);
+            }
+        }
+
+        /// 5. Output
+        float* dest = buffer + chunk * channels;
+        if (numLive == m) {
+            for (int j = 0; j < m; j++) {
+                dest[j * channels] = left[j] * gain[j];
+                dest[j * channels + 1] = right[j] * gain[j];
+            }
+        } else {
+            for (int j = 0; j < m; j++) {
+                if (live[j]) {
+                    dest[j * channels] = left[j] * gain[j];
+                    dest[j * channels + 1] = right[j] * gain[j];
+                }
+            }
+        }
+    }
+
+    return Clip_ToDouble(playhead);
+}
+
+double ClipSignalGenerator(float buffer[], float freqExpBuffer[], float freqLinBuffer[], float ampBuffer[],
+                           float seqBuffer[], int length, float lastSeqGen[2], int channels, bool freqExpGen,
+                           bool freqLinGen, bool ampGen, bool seqGen, double floatingBufferCount, int sampleBounds[2],
+                           float playbackSpeed, float lastPlaybackSpeed, void* clip, int clipChannels, float amplitude,
+                           float lastAmplitude, bool playdirection, bool looping, double _sampleDuration,
+                           int bufferCount, bool& active, int windowLength) {
+    (void) playdirection, (void) _sampleDuration, (void) bufferCount; // legacy, playback is forward only
+    return Clip_Generate(buffer, freqExpBuffer, freqLinBuffer, ampBuffer, seqBuffer, length, lastSeqGen, channels,
+                         freqExpGen, freqLinGen, ampGen, seqGen, floatingBufferCount, sampleBounds, playbackSpeed,
+                         lastPlaybackSpeed, clip, clipChannels, SAMPLECODEC_FLOAT32, amplitude, lastAmplitude, looping,
+                         active, windowLength, INTERPOLATION_LINEAR);
+}
+
+double ClipSignalGeneratorInterpolated(float buffer[], float freqExpBuffer[], float freqLinBuffer[], float ampBuffer[],
+                                       float seqBuffer[], int length, float lastSeqGen[2], int channels,
+                                       bool freqExpGen, bool freqLinGen, bool ampGen, bool seqGen,
+                                       double floatingBufferCount, int sampleBounds[2], float playbackSpeed,
+                                       float lastPlaybackSpeed, void* clip, int clipChannels, float amplitude,
+                                       float lastAmplitude, bool looping, bool& active, int windowLength,
+                                       int interpolation) {
+    return Clip_Generate(buffer, freqExpBuffer, freqLinBuffer, ampBuffer, seqBuffer, length, lastSeqGen, channels,
+                         freqExpGen, freqLinGen, ampGen, seqGen, floatingBufferCount, sampleBounds, playbackSpeed,
+                         lastPlaybackSpeed, clip, clipChannels, SAMPLECODEC_FLOAT32, amplitude, lastAmplitude, looping,
+                         active, windowLength, interpolation);
+}
+
+double ClipSignalGeneratorPooled(float buffer[], float freqExpBuffer[], float freqLinBuffer[], float ampBuffer[],
+                                 float seqBuffer[], int length, float lastSeqGen[2], int channels, bool freqExpGen,
+                                 bool freqLinGen, bool ampGen, bool seqGen, double floatingBufferCount,
+                                 int sampleBounds[2], float playbackSpeed, float lastPlaybackSpeed, int sample,
+                                 float amplitude, float lastAmplitude, bool looping, bool& active, int windowLength,
+                                 int interpolation) {
+    int frames, clipChannels, clipFormat;
+    const void* clip = SamplePool_Lock(sample, &frames, &clipChannels, &clipFormat);
+    if (!clip)
+        return floatingBufferCount;
+
+    /// the bounds may still belong to a longer sample that was played before
+    int bounds[2];
+    bounds[1] = sampleBounds[1] < frames - 1 ? sampleBounds[1] : frames - 1;
+    bounds[0] = sampleBounds[0] < bounds[1] ? sampleBounds[0] : bounds[1];
+
+    double position = Clip_Generate(buffer, freqExpBuffer, freqLinBuffer, ampBuffer, seqBuffer, length, lastSeqGen,
+                                    channels, freqExpGen, freqLinGen, ampGen, seqGen, floatingBufferCount, bounds,
+                                    playbackSpeed, lastPlaybackSpeed, clip, clipChannels, clipFormat, amplitude,
+                                    lastAmplitude, looping, active, windowLength, interpolation);
+    SamplePool_Unlock(sample);
+    return position;
+}
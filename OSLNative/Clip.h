@@ -0,0 +1,56 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Clip playback. ClipSignalGenerator() (declared in main.h) plays a section of a sample that is owned by the managed
+/// side, with exp and lin fm, amplitude modulation, retriggering and an optional fade-in/fade-out window.
+/// ClipSignalGeneratorPooled() plays a sample from the SamplePool instead, which may also be stored as int16 or ADPCM;
+/// the decoding happens in the gather loop, ADPCM through a cache of the last two decoded blocks.
+///
+/// The playhead is a 32.32 fixed-point sample position: the upper 32 bits are the sample index, the lower 32 bits the
+/// fraction for the interpolation. It is converted from and to the managed double position once per block.
+///
+/// The block is processed in chunks. Only the playhead, which depends on wrapping and retriggering, is advanced sample
+/// by sample; the playback speed ramp, the gather from the interleaved clip data and the window and amplitude ramps are
+/// separate loops without dependencies between samples, which the compiler can vectorise.
+///
+/// The interpolation is selectable with the INTERPOLATION_ constants from util.h. NONE rounds to the nearest sample,
+/// LINEAR reads two samples, CUBIC is a 4 point Catmull-Rom spline and WSINC a 24 tap polyphase windowed sinc, see
+/// wsinc_polyphase_table(). For CUBIC and WSINC, the frames that the taps of a chunk cover are decoded once into a
+/// planar window, so every output frame is a dot product over contiguous memory. The sinc is not widened when pitching
+/// up: it removes the imaging of pitched-down playback, not the aliasing of pitched-up playback.
+
+#ifndef Clip_h
+#define Clip_h
+
+#include "main.h"
+
+#define CLIP_CHUNK 64 // frames per chunk
+
+#define CLIP_SINC_TAPS 24                         // taps -11 to 12 around the left sample of the interpolation
+#define CLIP_WINDOW (CLIP_CHUNK * CLIP_SINC_TAPS) // decoded frames per chunk, enough for separate taps per frame
+
+#endif /* Clip_h */
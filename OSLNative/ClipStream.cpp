@@ -0,0 +1,506 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ClipStream.h"
+#include "util.h"
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define CLIPSTREAM_BLOCK 4096 // frames per read
+
+/* Reader thread, shared by all streams */
+
+static std::mutex clipStreamMutex; // guards the list, held by the reader during a pass
+static std::vector<ClipStream*> clipStreams;
+static std::thread clipStreamReader;
+static std::atomic<unsigned> clipStreamGeneration(0); // a reader quits when this is no longer the one it started with
+
+static const float clipStreamSilence[2] = {0, 0};
+
+/* Reading and decoding */
+
+static int ClipStream_FileSeek(FILE* f, int64_t offset) {
+#if defined(_WIN32)
+    return _fseeki64(f, offset, SEEK_SET);
+#else
+    return fseeko(f, (off_t) offset, SEEK_SET);
+#endif
+}
+
+/// Copies n bytes at the given offset of the source to dest.
+static bool ClipStream_ReadBytes(int64_t offset, int n, void* dest, int64_t size, ClipStream* x) {
+    if (x->memory) {
+        if (offset < 0 || offset + n > size)
+            return false;
+        memcpy(dest, x->memory + offset, n);
+        return true;
+    }
+    return ClipStream_FileSeek(x->file, offset) == 0 && fread(dest, 1, n, x->file) == (size_t) n;
+}
+
+/// Returns the raw bytes of n frames starting at frame, or NULL on a read error. n must not exceed CLIPSTREAM_BLOCK.
+static const unsigned char* ClipStream_ReadRaw(int64_t frame, int n, ClipStream* x) {
+    int64_t offset = x->dataOffset + frame * x->bytesPerFrame;
+    if (x->memory)
+        return x->memory + offset;
+    if (ClipStream_FileSeek(x->file, offset) != 0 ||
+        fread(x->scratch, x->bytesPerFrame, n, x->file) != (size_t) n)
+        return NULL;
+    return x->scratch;
+}
+
+static inline float ClipStream_Sample(const unsigned char* p, int format) {
+    switch (format) {
+    case CLIPSTREAM_PCM16:
+        return (int16_t) (p[0] | p[1] << 8) * (1.f / 32768.f);
+    case CLIPSTREAM_PCM24:
+        return (int32_t) ((uint32_t) p[0] << 8 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 24) * (1.f / 2147483648.f);
+    case CLIPSTREAM_PCM32:
+        return (int32_t) ((uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24) *
+               (1.f / 2147483648.f);
+    default: {
+        float f;
+        memcpy(&f, p, sizeof(float));
+        return f;
+    }
+    }
+}
+
+/// Decodes n frames to stereo interleaved floats, mono files are copied to both channels.
+static void ClipStream_Decode(const unsigned char* src, int n, float* dest, ClipStream* x) {
+    int bytesPerSample = x->bytesPerFrame / x->fileChannels;
+    for (int f = 0; f < n; f++) {
+        const unsigned char* p = src + f * x->bytesPerFrame;
+        dest[2 * f] = ClipStream_Sample(p, x->format);
+        dest[2 * f + 1] = x->fileChannels > 1 ? ClipStream_Sample(p + bytesPerSample, x->format) : dest[2 * f];
+    }
+}
+
+/// Reads the fmt and data chunks of a RIFF/WAVE file of the given size in bytes.
+static bool ClipStream_ParseHeader(int64_t size, ClipStream* x) {
+    unsigned char riff[12];
+    if (!ClipStream_ReadBytes(0, 12, riff, size, x) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0)
+        return false;
+
+    bool haveFormat = false;
+    int64_t offset = 12;
+    unsigned char chunk[8];
+    while (ClipStream_ReadBytes(offset, 8, chunk, size, x)) {
+        uint32_t chunkSize = chunk[4] | chunk[5] << 8 | chunk[6] << 16 | (uint32_t) chunk[7] << 24;
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            unsigned char fmt[26];
+            if (chunkSize < 16 || !ClipStream_ReadBytes(offset + 8, chunkSize < 26 ? 16 : 26, fmt, size, x))
+                return false;
+            int tag = fmt[0] | fmt[1] << 8;
+            if (tag == 0xFFFE && chunkSize >= 26) // WAVE_FORMAT_EXTENSIBLE, the tag is the start of the sub format
+                tag = fmt[24] | fmt[25] << 8;
+            x->fileChannels = fmt[2] | fmt[3] << 8;
+            x->sampleRate = (float) (fmt[4] | fmt[5] << 8 | fmt[6] << 16 | (uint32_t) fmt[7] << 24);
+            x->bytesPerFrame = fmt[12] | fmt[13] << 8;
+            int bits = fmt[14] | fmt[15] << 8;
+
+            if (tag == 1 && bits == 16)
+                x->format = CLIPSTREAM_PCM16;
+            else if (tag == 1 && bits == 24)
+                x->format = CLIPSTREAM_PCM24;
+            else if (tag == 1 && bits == 32)
+                x->format = CLIPSTREAM_PCM32;
+            else if (tag == 3 && bits == 32)
+                x->format = CLIPSTREAM_FLOAT32;
+            else
+                return false;
+            if (x->fileChannels < 1 || x->fileChannels > 2 || x->bytesPerFrame != x->fileChannels * bits / 8)
+                return false;
+            haveFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat)
+                return false;
+            x->dataOffset = offset + 8;
+            /// recorders that were interrupted leave a size of 0 or 0xFFFFFFFF, so trust the file size instead
+            int64_t available = size - x->dataOffset;
+            int64_t dataSize = chunkSize == 0 || chunkSize > available ? available : chunkSize;
+            x->numFrames = dataSize / x->bytesPerFrame;
+            return x->numFrames > 0;
+        }
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+    return false;
+}
+
+/// Decodes the loop head for a new start bound into the buffer that the audio thread does not use. Returns true if
+/// anything was read.
+static bool ClipStream_ServiceLoop(ClipStream* x) {
+    int64_t start = x->loopRequest.load(std::memory_order_acquire);
+    int front = x->loopFront.load(std::memory_order_relaxed);
+    if (start == x->loopStart[front] || x->loopInUse.load(std::memory_order_seq_cst) != front)
+        return false;
+
+    int back = 1 - front;
+    int64_t n = x->numFrames - start < x->headFrames ? x->numFrames - start : x->headFrames;
+    for (int f = 0; f < n; f += CLIPSTREAM_BLOCK) {
+        int m = n - f < CLIPSTREAM_BLOCK ? (int) (n - f) : CLIPSTREAM_BLOCK;
+        const unsigned char* src = ClipStream_ReadRaw(start + f, m, x);
+        if (!src)
+            return false;
+        ClipStream_Decode(src, m, x->loopHead[back] + f * 2, x);
+    }
+    x->loopStart[back] = start;
+    x->loopFrames[back] = (int) n;
+    x->loopFront.store(back, std::memory_order_seq_cst);
+    return true;
+}
+
+/// Refills the ring of one stream. Returns true if anything was read.
+static bool ClipStream_Service(ClipStream* x) {
+    uint32_t request = x->seekRequest.load(std::memory_order_acquire);
+    if (request != x->seekDone.load(std::memory_order_relaxed)) {
+        x->writeFrame.store(x->seekFrame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        x->seekDone.store(request, std::memory_order_release);
+    }
+
+    int64_t write = x->writeFrame.load(std::memory_order_relaxed);
+    int64_t read = x->readFrame.load(std::memory_order_acquire);
+    int64_t n = read + x->ringFrames - write;
+    if (n > x->numFrames - write)
+        n = x->numFrames - write;
+    if (n > CLIPSTREAM_BLOCK)
+        n = CLIPSTREAM_BLOCK;
+    if (n <= 0)
+        return false;
+
+    const unsigned char* src = ClipStream_ReadRaw(write, (int) n, x);
+    if (!src)
+        return false;
+    int slot = (int) (write & (x->ringFrames - 1));
+    int n1 = n < x->ringFrames - slot ? (int) n : x->ringFrames - slot;
+    ClipStream_Decode(src, n1, x->ring + slot * 2, x);
+    ClipStream_Decode(src + n1 * x->bytesPerFrame, (int) n - n1, x->ring, x);
+
+    x->writeFrame.store(write + n, std::memory_order_release);
+    return true;
+}
+
+/// A reader that is being stopped can overlap with the next one for a moment, but the passes are serialised by the
+/// mutex.
+static void ClipStream_ReaderLoop(unsigned generation) {
+    while (clipStreamGeneration.load(std::memory_order_acquire) == generation) {
+        bool busy = false;
+        {
+            std::lock_guard<std::mutex> lock(clipStreamMutex);
+            for (ClipStream* x : clipStreams) {
+                busy |= ClipStream_ServiceLoop(x);
+                busy |= ClipStream_Service(x);
+            }
+        }
+        if (!busy)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/* Processing audio */
+
+/// The end of the buffered range of the ring, which is only valid once the reader has caught up with the last seek.
+static inline int64_t ClipStream_Written(ClipStream* x) {
+    bool synced = x->seekDone.load(std::memory_order_acquire) == x->seekRequest.load(std::memory_order_relaxed);
+    return synced ? x->writeFrame.load(std::memory_order_acquire) : x->ringBase;
+}
+
+/// Moves the playback to the given frame. If the frame is still buffered, the ring keeps its data; frames before the
+/// read position may already be overwritten. Otherwise the ring is refilled from there, or from behind the head or the
+/// loop head that covers the frame. Returns the new end of the buffered range.
+static int64_t ClipStream_Seek(int64_t frame, ClipStream* x) {
+    int64_t written = ClipStream_Written(x);
+    if (frame >= x->readFrame.load(std::memory_order_relaxed) && frame < written) {
+        x->ringBase = frame;
+        x->readFrame.store(frame, std::memory_order_release);
+        return written;
+    }
+
+    int64_t target = frame > x->headFrames ? frame : x->headFrames;
+    int use = x->loopInUse.load(std::memory_order_relaxed);
+    int64_t loopEnd = x->loopStart[use] + x->loopFrames[use];
+    if (frame >= x->loopStart[use] && frame < loopEnd && loopEnd > target)
+        target = loopEnd;
+    x->ringBase = target;
+    x->readFrame.store(target, std::memory_order_relaxed);
+    x->seekFrame.store(target, std::memory_order_relaxed);
+    x->seekRequest.store(x->seekRequest.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    return target;
+}
+
+/// Returns frame f if it is in memory, silence otherwise. written is the end of the buffered range.
+static inline const float* ClipStream_Frame(int64_t f, int64_t written, bool& missing, ClipStream* x) {
+    if (f < x->headFrames)
+        return x->head + f * 2;
+    if (f >= x->numFrames)
+        return clipStreamSilence;
+    int use = x->loopInUse.load(std::memory_order_relaxed);
+    if (f >= x->loopStart[use] && f < x->loopStart[use] + x->loopFrames[use])
+        return x->loopHead[use] + (f - x->loopStart[use]) * 2;
+    if (f >= x->ringBase && f < written)
+        return x->ring + (f & (x->ringFrames - 1)) * 2;
+    missing = true;
+    return clipStreamSilence;
+}
+
+OSL_API void ClipStream_Process(float buffer[], float seqBuffer[], int length, int channels, float playbackSpeed,
+                                float lastPlaybackSpeed, float amplitude, float lastAmplitude, bool looping,
+                                ClipStream* x) {
+    int frames = length / channels;
+    int64_t start = (int64_t) x->start << 32;
+    int64_t end = (int64_t) x->end << 32;
+    bool missing = false;
+
+    int64_t written = ClipStream_Written(x);
+
+    /// take over a newly decoded loop head, unless the playhead still relies on the current one
+    int use = x->loopInUse.load(std::memory_order_relaxed);
+    int front = x->loopFront.load(std::memory_order_seq_cst);
+    int64_t f0 = x->playhead >> 32;
+    if (front != use && !(x->active && f0 >= x->loopStart[use] && f0 < x->loopStart[use] + x->loopFrames[use]))
+        x->loopInUse.store(front, std::memory_order_seq_cst);
+
+    for (int j = 0; j < frames; j++) {
+        int i = j * channels;
+        float t = (float) i / length;
+
+        if (seqBuffer) {
+            if (seqBuffer[i] > 0.f && x->lastSeq <= 0.f) {
+                x->playhead = start;
+                x->active = true;
+                written = ClipStream_Seek(x->start, x);
+            }
+            x->lastSeq = seqBuffer[i];
+        }
+
+        if (!x->active) {
+            buffer[i] = buffer[i + 1] = 0.f;
+            continue;
+        }
+
+        int64_t f = x->playhead >> 32;
+        float frac = (uint32_t) x->playhead * (1.f / 4294967296.f);
+        const float* a = ClipStream_Frame(f, written, missing, x);
+        const float* b = ClipStream_Frame(f + 1, written, missing, x);
+        float gain = lastAmplitude + t * (amplitude - lastAmplitude); // slope limiting
+        buffer[i] = (a[0] + frac * (b[0] - a[0])) * gain;
+        buffer[i + 1] = (a[1] + frac * (b[1] - a[1])) * gain;
+
+        float speed = lastPlaybackSpeed + t * (playbackSpeed - lastPlaybackSpeed); // slope limiting
+        x->playhead += (int64_t) (_clamp(speed, 0.f, 16.f) * 4294967296.0);
+        if (x->playhead >= end) {
+            if (looping && end > start) {
+                x->playhead = start + (x->playhead - end) % (end - start);
+                written = ClipStream_Seek(x->playhead >> 32, x);
+            } else {
+                x->active = false;
+            }
+        }
+    }
+
+    if (x->playhead >> 32 > x->ringBase)
+        x->readFrame.store(x->playhead >> 32, std::memory_order_release);
+    if (missing)
+        x->underruns.fetch_add(1, std::memory_order_relaxed);
+}
+
+/* Setting and getting parameters */
+
+OSL_API void ClipStream_Play(double position, ClipStream* x) {
+    if (position < 0)
+        position = 0;
+    x->playhead = (int64_t) (position * 4294967296.0);
+    x->active = true;
+    ClipStream_Seek(x->playhead >> 32, x);
+}
+
+OSL_API void ClipStream_Stop(ClipStream* x) {
+    x->active = false;
+}
+
+OSL_API double ClipStream_GetPosition(ClipStream* x) {
+    return x->playhead / 4294967296.0;
+}
+
+OSL_API bool ClipStream_IsActive(ClipStream* x) {
+    return x->active;
+}
+
+OSL_API int ClipStream_GetLength(ClipStream* x) {
+    return x->numFrames < INT32_MAX ? (int) x->numFrames : INT32_MAX;
+}
+
+OSL_API void ClipStream_SetBounds(int start, int end, ClipStream* x) {
+    int length = ClipStream_GetLength(x);
+    x->start = start < 0 ? 0 : (start > length - 1 ? length - 1 : start);
+    x->end = end <= x->start ? x->start + 1 : (end > length ? length : end);
+    x->loopRequest.store(x->start, std::memory_order_release);
+}
+
+OSL_API float ClipStream_GetSampleRate(ClipStream* x) {
+    return x->sampleRate;
+}
+
+OSL_API int ClipStream_GetUnderruns(ClipStream* x) {
+    return x->underruns.load(std::memory_order_relaxed);
+}
+
+/* Allocating and freeing */
+
+/// Parses the header, decodes the head and registers the stream with the reader thread.
+static ClipStream* ClipStream_Open(ClipStream* x, int64_t size, int headFrames, int ringFrames) {
+    if (!ClipStream_ParseHeader(size, x)) {
+        ClipStream_Free(x);
+        return NULL;
+    }
+
+    if (headFrames < 0)
+        headFrames = 0;
+    x->headFrames = headFrames < x->numFrames ? headFrames : (int) x->numFrames;
+    x->ringFrames = _nextPowOf2(ringFrames < CLIPSTREAM_BLOCK ? CLIPSTREAM_BLOCK : ringFrames);
+    x->scratch = x->memory ? NULL : (unsigned char*) _malloc(CLIPSTREAM_BLOCK * x->bytesPerFrame);
+    x->head = (float*) _malloc((x->headFrames > 0 ? x->headFrames : 1) * 2 * sizeof(float));
+    x->ring = (float*) _malloc(x->ringFrames * 2 * sizeof(float));
+    _fZero(x->ring, x->ringFrames * 2);
+    for (int i = 0; i < 2; i++)
+        x->loopHead[i] = (float*) _malloc((x->headFrames > 0 ? x->headFrames : 1) * 2 * sizeof(float));
+
+    for (int f = 0; f < x->headFrames; f += CLIPSTREAM_BLOCK) {
+        int n = x->headFrames - f < CLIPSTREAM_BLOCK ? x->headFrames - f : CLIPSTREAM_BLOCK;
+        const unsigned char* src = ClipStream_ReadRaw(f, n, x);
+        if (!src) {
+            ClipStream_Free(x);
+            return NULL;
+        }
+        ClipStream_Decode(src, n, x->head + f * 2, x);
+    }
+
+    x->ringBase = x->headFrames;
+    x->writeFrame.store(x->ringBase);
+    x->readFrame.store(x->ringBase);
+    x->seekFrame.store(x->ringBase);
+    x->start = 0;
+    x->end = ClipStream_GetLength(x);
+    x->loopRequest.store(0);
+
+    std::lock_guard<std::mutex> lock(clipStreamMutex);
+    clipStreams.push_back(x);
+    if (!clipStreamReader.joinable())
+        clipStreamReader = std::thread(ClipStream_ReaderLoop, clipStreamGeneration.load());
+    return x;
+}
+
+static ClipStream* ClipStream_Alloc() {
+    ClipStream* x = new ClipStream();
+    x->file = NULL;
+    x->memory = NULL;
+    x->scratch = NULL;
+    x->head = NULL;
+    x->ring = NULL;
+    x->headFrames = 0;
+    for (int i = 0; i < 2; i++) {
+        x->loopHead[i] = NULL;
+        x->loopStart[i] = -1;
+        x->loopFrames[i] = 0;
+    }
+    x->loopRequest.store(0);
+    x->loopFront.store(0);
+    x->loopInUse.store(0);
+    x->writeFrame.store(0);
+    x->readFrame.store(0);
+    x->seekFrame.store(0);
+    x->seekRequest.store(0);
+    x->seekDone.store(0);
+    x->underruns.store(0);
+    x->playhead = 0;
+    x->ringBase = 0;
+    x->active = false;
+    x->lastSeq = 0;
+    return x;
+}
+
+OSL_API ClipStream* ClipStream_New(const char* path, int headFrames, int ringFrames) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        printv("ClipStream: could not open %s\n", path);
+        return NULL;
+    }
+    ClipStream_FileSeek(file, 0);
+#if defined(_WIN32)
+    _fseeki64(file, 0, SEEK_END);
+    int64_t size = _ftelli64(file);
+#else
+    fseeko(file, 0, SEEK_END);
+    int64_t size = (int64_t) ftello(file);
+#endif
+
+    ClipStream* x = ClipStream_Alloc();
+    x->file = file;
+    return ClipStream_Open(x, size, headFrames, ringFrames);
+}
+
+OSL_API ClipStream* ClipStream_NewFromMemory(const void* wav, int64_t size, int headFrames, int ringFrames) {
+    if (!wav)
+        return NULL;
+    ClipStream* x = ClipStream_Alloc();
+    x->memory = (const unsigned char*) wav;
+    return ClipStream_Open(x, size, headFrames, ringFrames);
+}
+
+OSL_API void ClipStream_Free(ClipStream* x) {
+    /// the last stream stops the reader; it is taken over under the lock, so that a concurrent ClipStream_Open()
+    /// starts a new one instead of reusing it, and joined outside, because the reader needs the lock to finish a pass
+    std::thread reader;
+    {
+        std::lock_guard<std::mutex> lock(clipStreamMutex);
+        for (size_t i = 0; i < clipStreams.size(); i++) {
+            if (clipStreams[i] == x) {
+                clipStreams.erase(clipStreams.begin() + i);
+                if (clipStreams.empty() && clipStreamReader.joinable()) {
+                    clipStreamGeneration.fetch_add(1, std::memory_order_release);
+                    reader = std::move(clipStreamReader);
+                }
+                break;
+            }
+        }
+    }
+    if (reader.joinable())
+        reader.join();
+
+    if (x->file)
+        fclose(x->file);
+    _free(x->scratch);
+    _free(x->head);
+    _free(x->loopHead[0]);
+    _free(x->loopHead[1]);
+    _free(x->ring);
+    delete x;
+}
@@ -0,0 +1,152 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Disk-streaming clip playback for long material.
+///
+/// Instead of decoding the whole sample into memory, a stream keeps only a small prefetch ring per voice. A shared
+/// background thread fills the ring from a WAV file, or from a WAV file that is already in memory (e.g. memory-mapped),
+/// and the audio thread only reads what is already buffered. The ring is a single-producer/single-consumer queue of
+/// frames and is synchronised with atomics only, the audio thread never locks or waits.
+///
+/// The first headFrames frames are decoded when the stream is created and stay in memory. A trigger or a loop that
+/// jumps back into the head therefore plays immediately, while the reader refills the ring from the end of the head.
+/// For the same reason, the reader also keeps headFrames frames from the start bound in memory, the loop head, which
+/// it decodes again whenever ClipStream_SetBounds() moves the start. A jump to a frame that is still buffered keeps the
+/// ring as it is.
+///
+/// Underruns: frames that are not buffered yet are played as silence, but the playhead keeps moving, so the clip stays
+/// in time. Every block with missing frames is counted, see ClipStream_GetUnderruns().
+///
+/// Playback is forward only. Positions and bounds are in frames of the file; the file's sample rate is not converted,
+/// the caller scales the playback speed if necessary.
+///
+/// ClipStream_New(), ClipStream_NewFromMemory() and ClipStream_Free() block and must not be called from the audio
+/// thread. All other functions are not thread-safe, hence the caller must avoid simultaneous access from multiple
+/// threads.
+
+#ifndef ClipStream_h
+#define ClipStream_h
+
+#include "main.h"
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+
+#define CLIPSTREAM_PCM16 0
+#define CLIPSTREAM_PCM24 1
+#define CLIPSTREAM_PCM32 2
+#define CLIPSTREAM_FLOAT32 3
+
+struct ClipStream {
+    // source, only used by the reader thread after creation
+    FILE* file;
+    const unsigned char* memory; // if not NULL, the WAV file in memory
+    int64_t dataOffset;          // byte offset of the first frame
+    int format;
+    int fileChannels;
+    int bytesPerFrame;
+    int64_t numFrames;
+    float sampleRate;
+    unsigned char* scratch; // raw bytes of one read
+
+    // the first frames, stereo interleaved
+    float* head;
+    int headFrames;
+
+    // headFrames frames from the start bound, so that loops and retriggers play while the ring refills behind them.
+    // The reader thread decodes into the buffer that the audio thread does not use, then publishes it.
+    float* loopHead[2];
+    int64_t loopStart[2]; // -1 while empty
+    int loopFrames[2];
+    std::atomic<int64_t> loopRequest; // the start bound
+    std::atomic<int> loopFront;       // the buffer decoded last
+    std::atomic<int> loopInUse;       // the buffer the audio thread reads
+
+    // prefetch ring, stereo interleaved; written by the reader thread, read by the audio thread
+    float* ring;
+    int ringFrames; // power of 2
+    std::atomic<int64_t> writeFrame; // one past the last buffered frame
+    std::atomic<int64_t> readFrame;  // frames before this one may be overwritten
+    std::atomic<int64_t> seekFrame;  // the first frame the ring is refilled from
+    std::atomic<uint32_t> seekRequest;
+    std::atomic<uint32_t> seekDone;
+    std::atomic<int> underruns;
+
+    // playback, audio thread only
+    int64_t playhead; // 32.32 fixed point, as in Clip.cpp
+    int64_t ringBase; // first frame of the ring since the last seek
+    int start;
+    int end;
+    bool active;
+    float lastSeq;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Processing audio */
+
+/// Renders 1 block of interleaved audio data. A rising edge in seqBuffer (may be NULL) restarts playback at the start
+/// bound. Frames are silent while the stream is not active.
+OSL_API void ClipStream_Process(float buffer[], float seqBuffer[], int length, int channels, float playbackSpeed,
+                                float lastPlaybackSpeed, float amplitude, float lastAmplitude, bool looping,
+                                ClipStream* x);
+
+/* Setting and getting parameters */
+
+/// Starts playback at the given frame.
+OSL_API void ClipStream_Play(double position, ClipStream* x);
+/// Stops playback.
+OSL_API void ClipStream_Stop(ClipStream* x);
+/// Sets the section that is played and looped, in frames.
+OSL_API void ClipStream_SetBounds(int start, int end, ClipStream* x);
+OSL_API double ClipStream_GetPosition(ClipStream* x);
+OSL_API bool ClipStream_IsActive(ClipStream* x);
+/// Length of the file in frames.
+OSL_API int ClipStream_GetLength(ClipStream* x);
+OSL_API float ClipStream_GetSampleRate(ClipStream* x);
+/// Number of blocks that had frames missing since the stream was created.
+OSL_API int ClipStream_GetUnderruns(ClipStream* x);
+
+/* Allocating and freeing */
+
+/// Opens a 16, 24 or 32 bit PCM or 32 bit float WAV file with 1 or 2 channels. headFrames frames are decoded right
+/// away, ringFrames (rounded up to a power of 2) are kept in the prefetch ring. Returns NULL if the file cannot be
+/// read.
+OSL_API ClipStream* ClipStream_New(const char* path, int headFrames, int ringFrames);
+/// Same as ClipStream_New(), but reads a WAV file of the given size in bytes from memory. The memory is not copied and
+/// must stay valid until the stream is freed.
+OSL_API ClipStream* ClipStream_NewFromMemory(const void* wav, int64_t size, int headFrames, int ringFrames);
+/// Releases allocated resources and closes the file.
+OSL_API void ClipStream_Free(ClipStream* x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ClipStream_h */
@@ -26,6 +26,7 @@
 // limitations under the License.
 
 #include "Delay.h"
+#include "resample.h"
 #include "util.h"
 #include <string.h>
 #include <math.h>
@@ -33,8 +34,41 @@
 #include <algorithm>
 
 #define DELAY_MAXVECTORSIZE 4096
+#define DELAY_MIRROR WSINC_POLYPHASE_TAPS // the taps of the widest interpolator of DELAYMODE_FRACTIONAL
+#define DELAY_BBD_STAGES 16384            // of the emulated BBD, which set its clock and thereby its bandwidth
+#define DELAY_TIME_OCTAVES 13.0f          // range of the time modulation in both directions
+
+enum DelayParams {
+    P_TIME,
+    P_FEEDBACK,
+    P_WET,
+    P_DRY,
+    P_CLEAR,
+    P_INTERPOLATION,
+    P_MIN_SAMPLES,
+    P_MAX_SAMPLES,
+    P_TAPE,
+    P_N
+};
+
+/* The interpolation for the modes that do not support all of them: linear instead of the unsupported ones. */
+static int Delay_FrameInterpolation(DelayData* x, bool wsinc) {
+    if (x->interpolation == INTERPOLATION_NONE || (wsinc && x->interpolation == INTERPOLATION_WSINC))
+        return x->interpolation;
+    return INTERPOLATION_LINEAR;
+}
 
-enum DelayParams { P_TIME, P_FEEDBACK, P_WET, P_DRY, P_CLEAR, P_INTERPOLATION, P_MIN_SAMPLES, P_MAX_SAMPLES, P_N };
+/* The in-place (de)interleaving of util.c needs a temporary buffer, which is allocated on the heap on some platforms.
+ x->temp2 is free at the start and the end of a block, so we use it instead. */
+static void Delay_Deinterleave(float* buffer, int n, int channels, DelayData* x) {
+    _fDeinterleave(buffer, x->temp2, n, channels);
+    _fCopy(x->temp2, buffer, n);
+}
+
+static void Delay_Interleave(float* buffer, int n, int channels, DelayData* x) {
+    _fInterleave(buffer, x->temp2, n, channels);
+    _fCopy(x->temp2, buffer, n);
+}
 
 /* This version uses oversampling at write time and is extremely expensive with small delay times. */
 void Delay_ProcessPadded(float buffer[], int n, int channels, DelayData* x) {
@@ -54,7 +88,7 @@ void Delay_ProcessPadded(float buffer[], int n, int channels, DelayData* x) {
 
     int nPerChannel = n / channels;
     if (channels > 1)
-        _fDeinterleave(buffer, buffer, n, channels);
+        Delay_Deinterleave(buffer, n, channels, x);
 
     // Process delay
     int m;
@@ -85,7 +119,7 @@ void Delay_ProcessPadded(float buffer[], int n, int channels, DelayData* x) {
         }
 
         _fAdd(bufOffset, x->temp, x->temp, m);
-        RingBuffer_WritePadded(x->temp, m, stride, x->interpolation, tap);
+        RingBuffer_WritePadded(x->temp, m, stride, Delay_FrameInterpolation(x, false), tap);
 
         /// Scale the input samples and the previously read delay samples for output
         if (prevDry != x->dry) {
@@ -115,7 +149,7 @@ void Delay_ProcessPadded(float buffer[], int n, int channels, DelayData* x) {
         for (int i = 1; i < channels; i++) {
             _fCopy(buffer, buffer + i * nPerChannel, nPerChannel);
         }
-        _fInterleave(buffer, buffer, n, channels);
+        Delay_Interleave(buffer, n, channels, x);
     }
 
     x->prevTime = x->time;
@@ -124,44 +158,99 @@ void Delay_ProcessPadded(float buffer[], int n, int channels, DelayData* x) {
     x->prevDry = x->dry;
 }
 
-OSL_API void Delay_SetRange(int min, int max, DelayData* x) {
-    if (x->delayMode == DELAYMODE_PADDED && x->maxTime != max) {
-        RingBuffer* tap = (RingBuffer*) x->tap;
-        RingBuffer_Resize(max, tap);
-        Delay_Clear(x);
-        x->maxTime = max;
-    }
+static DelayLine* DelayLine_New(int n) {
+    DelayLine* x = (DelayLine*) _malloc(sizeof(DelayLine));
+    x->n = n;
+    x->ptr = 0;
+    x->buf = (float*) _malloc((n + DELAY_MIRROR) * sizeof(float));
+    _fZero(x->buf, n + DELAY_MIRROR);
+    return x;
 }
 
-OSL_API void Delay_SetMode(int mode, DelayData* x) {
-    if (mode == x->delayMode)
-        return;
+static void DelayLine_Free(DelayLine* x) {
+    _free(x->buf);
+    _free(x);
+}
 
-    switch (x->delayMode) {
-    case DELAYMODE_PADDED: {
-        if (mode == DELAYMODE_INTERPOLATED) {
-            RingBuffer* tap1 = (RingBuffer*) x->tap;
-            RingBuffer_Free(tap1);
-            x->tap = (void*) FrameRingBuffer_New(x->maxTime);
-        }
-        break;
+/* Allocates the buffer that a mode reads from and writes to. */
+static void* Delay_NewTap(int mode, int maxTime) {
+    switch (mode) {
+    case DELAYMODE_INTERPOLATED:
+        return (void*) FrameRingBuffer_New(maxTime);
+    case DELAYMODE_FRACTIONAL:
+        // the oldest tap of the widest interpolator at the maximum delay time must not have been overwritten yet
+        return (void*) DelayLine_New(maxTime + DELAY_MIRROR);
+    default:
+        return (void*) RingBuffer_New(maxTime);
     }
-    case DELAYMODE_INTERPOLATED: {
-        if (mode != DELAYMODE_INTERPOLATED) {
-            FrameRingBuffer* tap2 = (FrameRingBuffer*) x->tap;
-            FrameRingBuffer_Free(tap2);
-            x->tap = (void*) RingBuffer_New(x->maxTime);
-        }
+}
+
+static void Delay_FreeTap(int mode, void* tap) {
+    switch (mode) {
+    case DELAYMODE_INTERPOLATED:
+        FrameRingBuffer_Free((FrameRingBuffer*) tap);
+        break;
+    case DELAYMODE_FRACTIONAL:
+        DelayLine_Free((DelayLine*) tap);
         break;
-    }
     default:
+        RingBuffer_Free((RingBuffer*) tap);
         break;
     }
+}
 
-    x->delayMode = mode;
+static void Delay_FreePreparedTap(DelayTap* tap) {
+    if (tap == NULL)
+        return;
+    Delay_FreeTap(tap->mode, tap->buf);
+    _free(tap);
+}
+
+/* Prepares a buffer on the calling thread and hands it over to Delay_Process. A buffer that Delay_Process swapped out
+ in the meantime is freed here, as well as a prepared one that it has not picked up yet. */
+static void Delay_PrepareTap(int mode, int maxTime, DelayData* x) {
+    DelayTap* tap = (DelayTap*) _malloc(sizeof(DelayTap));
+    tap->mode = mode;
+    tap->maxTime = maxTime;
+    tap->buf = Delay_NewTap(mode, maxTime);
+
+    Delay_FreePreparedTap(x->retiredTap.exchange(NULL, std::memory_order_acquire));
+    Delay_FreePreparedTap(x->pendingTap.exchange(tap, std::memory_order_acq_rel));
+    x->nextMode = mode;
+    x->nextMaxTime = maxTime;
+}
+
+/* Swaps in a prepared buffer at the start of a block. The swapped out buffer is retired in the same DelayTap, to be
+ freed off the audio thread; as long as the previous one has not been freed yet, the swap waits for another block. */
+static void Delay_SwapTap(DelayData* x) {
+    if (x->pendingTap.load(std::memory_order_relaxed) == NULL || x->retiredTap.load(std::memory_order_acquire) != NULL)
+        return;
+
+    DelayTap* tap = x->pendingTap.exchange(NULL, std::memory_order_acq_rel);
+    if (tap == NULL)
+        return;
+    std::swap(x->delayMode, tap->mode);
+    std::swap(x->maxTime, tap->maxTime);
+    std::swap(x->tap, tap->buf);
+    x->readDelay = -1;
+    x->allpassState = 0;
+    x->tapeState = 0;
+    x->retiredTap.store(tap, std::memory_order_release);
+}
+
+OSL_API void Delay_SetMode(int mode, DelayData* x) {
+    if (mode == x->nextMode)
+        return;
+
+    Delay_PrepareTap(mode, x->nextMaxTime, x);
     printv("Delay is now in mode %d\n", mode);
 }
 
+OSL_API void Delay_SetRange(int min, int max, DelayData* x) {
+    if (max != x->nextMaxTime)
+        Delay_PrepareTap(x->nextMode, max, x);
+}
+
 /* This is the version we are using right now. */
 void Delay_ProcessInterpolated2(float buffer[], int n, int channels, float timeBuffer[], float feedbackBuffer[],
                                 float mixBuffer[], DelayData* x) {
@@ -177,11 +266,11 @@ void Delay_ProcessInterpolated2(float buffer[], int n, int channels, float timeB
 
     /// Deinterleave if necessary
     if (channels > 1) {
-        _fDeinterleave(buffer, buffer, n, channels);
+        Delay_Deinterleave(buffer, n, channels, x);
         if (timeBuffer)
-            _fDeinterleave(timeBuffer, timeBuffer, n, channels);
+            Delay_Deinterleave(timeBuffer, n, channels, x);
         if (feedbackBuffer)
-            _fDeinterleave(feedbackBuffer, feedbackBuffer, n, channels);
+            Delay_Deinterleave(feedbackBuffer, n, channels, x);
     }
 
     /// Generate control signal(s) and calculate average oversampling
@@ -211,7 +300,7 @@ void Delay_ProcessInterpolated2(float buffer[], int n, int channels, float timeB
     while (r) {
         m = time < r ? time : r;
 
-        FrameRingBuffer_Read2(x->temp, m, -x->maxTime, tb, false, x->interpolation, tap);
+        FrameRingBuffer_Read2(x->temp, m, -x->maxTime, tb, false, Delay_FrameInterpolation(x, true), tap);
 
         _fCopy(x->temp, x->temp2, m);
 
@@ -237,10 +326,6 @@ void Delay_ProcessInterpolated2(float buffer[], int n, int channels, float timeB
 
         bufOffset += m;
         tb += m;
-        if (timeBuffer)
-            timeBuffer += m;
-        if (feedbackBuffer)
-            feedbackBuffer += m;
         r -= m;
     }
 
@@ -250,13 +335,180 @@ void Delay_ProcessInterpolated2(float buffer[], int n, int channels, float timeB
             _fCopy(buffer, buffer + i * nPerChannel, nPerChannel);
         }
         /// We deinterleaved the data to process it, so we have to interleave it again
-        _fInterleave(buffer, buffer, n, channels);
+        Delay_Interleave(buffer, n, channels, x);
         if (timeBuffer)
-            _fInterleave(timeBuffer, timeBuffer, n, channels);
+            Delay_Interleave(timeBuffer, n, channels, x);
         if (feedbackBuffer)
-            _fInterleave(feedbackBuffer, feedbackBuffer, n, channels);
+            Delay_Interleave(feedbackBuffer, n, channels, x);
+    }
+
+    x->prevTime = x->time;
+    x->prevFeedback = x->feedback;
+    x->prevWet = x->wet;
+    x->prevDry = x->dry;
+}
+
+/* The smallest delay time in samples at which an interpolator of DELAYMODE_FRACTIONAL only reads written samples. */
+static int Delay_MinFractionalTime(int interpolation) {
+    switch (interpolation) {
+    case INTERPOLATION_LAGRANGE:
+    case INTERPOLATION_ALLPASS:
+        return 2;
+    case INTERPOLATION_WSINC:
+        return ZEROCROSSINGS_PER_AXIS + 1;
+    default:
+        return 1;
+    }
+}
+
+/* The index of the sample k samples before the write pointer. */
+static inline int DelayLine_Index(const DelayLine* line, int k) {
+    int i = line->ptr - k;
+    return i < 0 ? i + line->n : i;
+}
+
+static inline void DelayLine_Write(DelayLine* line, float value) {
+    line->buf[line->ptr] = value;
+    if (line->ptr < DELAY_MIRROR)
+        line->buf[line->n + line->ptr] = value;
+    if (++line->ptr == line->n)
+        line->ptr = 0;
+}
+
+/* Reads the line d samples before its write pointer. The read position lies between the samples d0 + 1 and d0 before
+ the write pointer, where d0 is the integer part of d, at the fraction f from the older one. d is a double, as a float
+ would resolve long delay times to a fraction of a sample only. */
+static inline float DelayLine_Read(const DelayLine* line, double d, int interpolation, float& allpass) {
+    int d0 = (int) d;
+    float f = 1.f - (float) (d - d0);
+
+    switch (interpolation) {
+    case INTERPOLATION_NONE:
+        return line->buf[DelayLine_Index(line, f < 0.5f ? d0 + 1 : d0)];
+
+    case INTERPOLATION_LAGRANGE: {
+        const float* s = line->buf + DelayLine_Index(line, d0 + 2); // nodes -1, 0, 1, 2 around the read position
+        float fp1 = f + 1.f, fm1 = f - 1.f, fm2 = f - 2.f;
+        return -f * fm1 * fm2 * (1.f / 6.f) * s[0] + fp1 * fm1 * fm2 * 0.5f * s[1] - fp1 * f * fm2 * 0.5f * s[2] +
+               fp1 * f * fm1 * (1.f / 6.f) * s[3];
+    }
+
+    case INTERPOLATION_ALLPASS: {
+        // first-order Thiran allpass for the fractional part, which is kept in 0.5 ... 1.5 where its phase delay is
+        // flattest
+        int whole = f > 0.5f ? d0 - 1 : d0;
+        float fraction = (float) (d - whole);
+        float a = (1.f - fraction) / (1.f + fraction);
+        const float* s = line->buf + DelayLine_Index(line, whole + 1);
+        allpass = a * s[1] + s[0] - a * allpass;
+        return allpass;
+    }
+
+    case INTERPOLATION_WSINC: {
+        const float* s = line->buf + DelayLine_Index(line, d0 + 1 + ZEROCROSSINGS_PER_AXIS);
+        float phase = f * WSINC_POLYPHASE_PHASES;
+        int row = (int) phase < WSINC_POLYPHASE_PHASES ? (int) phase : WSINC_POLYPHASE_PHASES - 1;
+        float w = phase - row;
+        const float* c0 = wsinc_polyphase_table() + row * WSINC_POLYPHASE_TAPS;
+        const float* c1 = c0 + WSINC_POLYPHASE_TAPS;
+        // summed in a fixed tree instead of a running sum, so the compiler can vectorise without reordering additions
+        float p[WSINC_POLYPHASE_TAPS];
+        for (int k = 0; k < WSINC_POLYPHASE_TAPS; k++)
+            p[k] = (c0[k] + w * (c1[k] - c0[k])) * s[k];
+        for (int k = 0; k < WSINC_POLYPHASE_TAPS / 2; k++)
+            p[k] += p[k + WSINC_POLYPHASE_TAPS / 2];
+        for (int k = 0; k < WSINC_POLYPHASE_TAPS / 4; k++)
+            p[k] += p[k + WSINC_POLYPHASE_TAPS / 4];
+        float y = 0.f;
+        for (int k = 0; k < WSINC_POLYPHASE_TAPS / 4; k++)
+            y += p[k];
+        return y;
+    }
+
+    default: {
+        const float* s = line->buf + DelayLine_Index(line, d0 + 1);
+        return s[0] + f * (s[1] - s[0]);
     }
+    }
+}
+
+/* This version writes at a fixed rate and reads with a fractional read head, so its cost per sample is the same for
+ every delay time and modulation. The read head follows the delay time sample by sample, or glides towards it with
+ the tape inertia. */
+void Delay_ProcessFractional(float buffer[], int n, int channels, float timeBuffer[], DelayData* x) {
+    DelayLine* line = (DelayLine*) x->tap;
+    int frames = n / channels;
+    if (frames <= 0)
+        return;
+
+    int interpolation = x->interpolation;
+    double minTime = Delay_MinFractionalTime(interpolation);
+    double maxTime = x->maxTime;
+    double time = x->time > 0 ? x->time : 1;
+    double prevTime = x->prevTime > 0 ? x->prevTime : 1;
+
+    double d = x->readDelay; // the glided knob time, the time modulation is applied after the glide
+    if (d < 0)               // first block, nothing to glide from
+        d = _clamp(prevTime, minTime, maxTime);
+
+    bool tape = x->tapeInertia > 0;
+    float glide = tape ? 1.f - expf(-1.f / x->tapeInertia) : 1.f;
+    // a BBD is clocked at stages / delay time and filtered below half of that; tracked per block only
+    float lowpass = 1.f;
+    float cutoff = DELAY_BBD_STAGES / (2.f * (float) d); // in cycles per sample
+    if (tape && cutoff < 0.5f)
+        lowpass = 1.f - expf(-2.f * (float) M_PI * cutoff);
+
+    float feedback = x->prevFeedback, feedbackStep = (x->feedback - x->prevFeedback) / frames;
+    float dry = x->prevDry, dryStep = (x->dry - x->prevDry) / frames;
+    float wet = x->prevWet, wetStep = (x->wet - x->prevWet) / frames;
+    float allpass = x->allpassState;
+    float tapeState = x->tapeState;
+
+    double timeStep = (time - prevTime) / frames;
+    double modMin = x->minSamples, modMax = x->maxSamples;
+
+    // the factors of the time modulation do not depend on each other, so they are computed up front
+    if (timeBuffer) {
+        for (int i = 0; i < frames; i++) {
+            float mod = timeBuffer[i * channels];
+            mod = mod < -1.f ? -1.f : mod > 1.f ? 1.f : mod;
+            x->cTime[i] = exp2f(DELAY_TIME_OCTAVES * mod);
+        }
+    }
+
+    for (int i = 0; i < frames; i++) {
+        double target = prevTime + timeStep * (i + 1);
+        target = target < minTime ? minTime : target > maxTime ? maxTime : target;
+        d += glide * (target - d);
+
+        double delay = d;
+        if (timeBuffer) {
+            delay *= x->cTime[i];
+            delay = delay < modMin ? modMin : delay > modMax ? modMax : delay;
+        }
+        delay = delay < minTime ? minTime : delay > maxTime ? maxTime : delay;
 
+        float echo = DelayLine_Read(line, delay, interpolation, allpass);
+        if (tape) {
+            tapeState += lowpass * (echo - tapeState);
+            echo = tapeState;
+        }
+
+        float in = buffer[i * channels];
+        feedback += feedbackStep;
+        DelayLine_Write(line, in + feedback * echo);
+
+        dry += dryStep;
+        wet += wetStep;
+        float out = dry * in + wet * echo;
+        for (int c = 0; c < channels; c++)
+            buffer[i * channels + c] = out;
+    }
+
+    x->readDelay = d;
+    x->allpassState = allpass;
+    x->tapeState = tapeState;
     x->prevTime = x->time;
     x->prevFeedback = x->feedback;
     x->prevWet = x->wet;
@@ -265,7 +517,11 @@ void Delay_ProcessInterpolated2(float buffer[], int n, int channels, float timeB
 
 OSL_API void Delay_Process(float buffer[], float timeBuffer[], float feedbackBuffer[], float mixBuffer[], int n,
                            int channels, DelayData* x) {
-    if (x->delayMode == DELAYMODE_INTERPOLATED)
+    Delay_SwapTap(x);
+
+    if (x->delayMode == DELAYMODE_FRACTIONAL)
+        Delay_ProcessFractional(buffer, n, channels, timeBuffer, x);
+    else if (x->delayMode == DELAYMODE_INTERPOLATED)
         Delay_ProcessInterpolated2(buffer, n, channels, timeBuffer, feedbackBuffer, mixBuffer, x);
     else if (x->delayMode == DELAYMODE_PADDED)
         Delay_ProcessPadded(buffer, n, channels, x);
@@ -274,7 +530,12 @@ OSL_API void Delay_Process(float buffer[], float timeBuffer[], float feedbackBuf
 OSL_API void Delay_Clear(DelayData* x) {
     if (x->delayMode == DELAYMODE_INTERPOLATED)
         FrameRingBuffer_Clear((FrameRingBuffer*) x->tap);
-    else
+    else if (x->delayMode == DELAYMODE_FRACTIONAL) {
+        DelayLine* line = (DelayLine*) x->tap;
+        _fZero(line->buf, line->n + DELAY_MIRROR);
+        x->allpassState = 0;
+        x->tapeState = 0;
+    } else
         _fZero(((RingBuffer*) x->tap)->buf, x->maxTime);
 }
 
@@ -310,14 +571,17 @@ OSL_API void Delay_SetParam(float value, int param, struct DelayData* x) {
     case P_MAX_SAMPLES:
         x->maxSamples = intval;
         break;
+    case P_TAPE:
+        x->tapeInertia = value > 0 ? value : 0;
+        break;
     default:
         break;
     }
 }
 
 OSL_API struct DelayData* Delay_New(int n) {
-    DelayData* x = (DelayData*) _malloc(sizeof(struct DelayData));
-    x->tap = FrameRingBuffer_New(n);
+    DelayData* x = new DelayData(); // not _malloc, as it holds atomics
+    x->tap = Delay_NewTap(DELAYMODE_INTERPOLATED, n);
     x->temp = (float*) _malloc(DELAY_MAXVECTORSIZE * sizeof(float));
     x->temp2 = (float*) _malloc(DELAY_MAXVECTORSIZE * sizeof(float));
     x->cTime = (float*) _malloc(DELAY_MAXVECTORSIZE * sizeof(float));
@@ -335,16 +599,25 @@ OSL_API struct DelayData* Delay_New(int n) {
     x->feedback = 0.3f;
     x->interpolation = INTERPOLATION_LINEAR;
     x->delayMode = DELAYMODE_INTERPOLATED;
+    x->minSamples = 1;
+    x->maxSamples = n;
+    x->tapeInertia = 0;
+    x->readDelay = -1;
+    x->allpassState = 0;
+    x->tapeState = 0;
+    x->nextMode = x->delayMode;
+    x->nextMaxTime = n;
+    x->pendingTap.store(NULL);
+    x->retiredTap.store(NULL);
     return x;
 }
 
 OSL_API void Delay_Free(struct DelayData* x) {
-    if (x->delayMode == DELAYMODE_INTERPOLATED)
-        FrameRingBuffer_Free((FrameRingBuffer*) x->tap);
-    else
-        RingBuffer_Free((RingBuffer*) x->tap);
+    Delay_FreeTap(x->delayMode, x->tap);
+    Delay_FreePreparedTap(x->pendingTap.load());
+    Delay_FreePreparedTap(x->retiredTap.load());
     _free(x->temp);
     _free(x->temp2);
     _free(x->cTime);
-    _free(x);
+    delete x;
 }
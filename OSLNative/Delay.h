@@ -32,10 +32,20 @@
 /// This results in the characteristic "pitch-shift" effect when changing the delay time while there is still signal in
 /// the delay buffer.
 ///
+/// DELAYMODE_FRACTIONAL instead writes at a fixed rate and reads with a fractional read head, so that its cost per
+/// sample does not depend on the delay time or its modulation. It interpolates with any of the INTERPOLATION_ constants
+/// from util.h but CUBIC. The pitch-shift of the other modes is optional there: with a tape inertia (P_TAPE, off by
+/// default), the read head glides to a new delay time like a tape machine or BBD changing its speed, and the echoes are
+/// darkened like by the anti-aliasing of a BBD, the more the longer the delay. Only the delay time glides, the time
+/// modulation is still followed per sample.
+///
 /// Note that the delay ignores multi-channel input: The first channel is used as input and copied to all output
 /// channels.
 ///
-/// All functions are not thread-safe, hence the caller must avoid simultaneous access from multiple threads.
+/// Delay_SetMode and Delay_SetRange allocate the new buffer on the calling thread, and Delay_Process swaps it in at the
+/// start of its next block, so they can be called while another thread processes audio; Delay_Process itself never
+/// allocates or frees memory. Apart from this, the functions are not thread-safe, hence the caller must avoid
+/// simultaneous access from multiple threads.
 
 #ifndef Delay_h
 #define Delay_h
@@ -44,10 +54,27 @@
 #include "RingBuffer.h"
 #include "CompressedRingBuffer.h"
 #include "CRingBuffer.hpp"
+#include <atomic>
 
 // #define DELAYMODE_SIMPLE 0 //deprecated
 #define DELAYMODE_PADDED 1
 #define DELAYMODE_INTERPOLATED 2
+#define DELAYMODE_FRACTIONAL 3
+
+/// The fixed-rate buffer of DELAYMODE_FRACTIONAL. The first DELAY_MIRROR samples are repeated behind its end, so that
+/// the taps of an interpolator are always contiguous in memory.
+struct DelayLine {
+    int ptr; // where the next sample is written
+    int n;   // without the mirrored samples
+    float* buf;
+};
+
+/// A buffer for a mode and maximum delay time, prepared by Delay_SetMode or Delay_SetRange.
+struct DelayTap {
+    int mode;
+    int maxTime;
+    void* buf;
+};
 
 struct DelayData {
     // public
@@ -66,10 +93,22 @@ struct DelayData {
     float prevFeedback;
     float prevDry;
     float prevWet;
-    void* tap; // either RingBuffer or FrameRingBuffer, depending on the delay's current mode
+    void* tap; // RingBuffer, FrameRingBuffer or DelayLine, depending on the delay's current mode
     float* temp;
     float* temp2;
     float* cTime; // control signal for delay time
+
+    // DELAYMODE_FRACTIONAL
+    float tapeInertia;  // time constant of the read head in samples, 0 disables the tape emulation
+    float readDelay;    // the delay time of the read head before modulation, negative until the first block
+    float allpassState; // the previous output of INTERPOLATION_ALLPASS
+    float tapeState;    // the state of the BBD lowpass
+
+    // mode and range of the most recently prepared tap, only used by the thread calling Delay_SetMode/Delay_SetRange
+    int nextMode;
+    int nextMaxTime;
+    std::atomic<DelayTap*> pendingTap; // prepared, swapped in by the next Delay_Process
+    std::atomic<DelayTap*> retiredTap; // swapped out by Delay_Process, freed by the next Delay_SetMode/Delay_SetRange
 };
 
 #ifdef __cplusplus
@@ -89,8 +128,9 @@ OSL_API void Delay_Clear(DelayData* x);
 /// Sets the parameter to the specified value.
 OSL_API void Delay_SetParam(float value, int param, struct DelayData* x);
 /// Sets the possible range of the delay. This is necessary for now bc excessive oversampling causes high CPU loads
-/// otherwise.
+/// otherwise. Takes effect with the next block, with a cleared buffer.
 OSL_API void Delay_SetRange(int min, int max, DelayData* x);
+/// Switches to one of the DELAYMODE_ constants. Takes effect with the next block, with a cleared buffer.
 OSL_API void Delay_SetMode(int mode, DelayData* x);
 
 /* Allocating and freeing */
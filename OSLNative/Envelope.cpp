@@ -0,0 +1,292 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Envelope.h"
+#include "Signal.h"
+#include "util.h"
+#include <math.h>
+#include <string.h>
+
+/// Starts the running segment from the current level, to reach its target after length frames.
+static void Envelope_Begin(int stage, int length, Envelope* x) {
+    float start = x->level;
+    float target = x->targets[stage];
+    float curve = x->curves[stage];
+    bool power = x->shapes[stage] == ENVELOPE_POWER;
+
+    x->stage = stage;
+    x->holding = false;
+    x->position = 0;
+    x->length = length;
+    x->power = power && fabsf(curve - 1.f) >= 1e-3f;
+    x->linear = power ? !x->power : fabsf(curve) < 1e-3f;
+    if (x->power) {
+        /// the ramp between the levels, taken to the power of 1 / curve
+        float from = powf(fmaxf(start, 0.f), 1.f / curve);
+        float to = powf(fmaxf(target, 0.f), 1.f / curve);
+        x->offset = from;
+        x->scale = (to - from) / length;
+        x->curve = curve;
+    } else if (x->linear) {
+        x->offset = start;
+        x->scale = (target - start) / length;
+    } else {
+        /// start + (target - start) * (1 - exp(curve * n / length)) / (1 - exp(curve))
+        float d = 1.f - expf(curve);
+        x->offset = start + (target - start) / d;
+        x->scale = -(target - start) / d;
+        x->curve = curve;
+        for (int t = 0; t < ENVELOPE_CHUNK; t++)
+            x->powers[t] = expf(curve * t / length);
+    }
+}
+
+/// Enters the given segment, skipping segments without frames.
+static void Envelope_Start(int stage, Envelope* x) {
+    x->elapsed = 0;
+    for (; stage < x->numSegments; stage++) {
+        if (x->frames[stage] > 0) {
+            Envelope_Begin(stage, x->frames[stage], x);
+            return;
+        }
+        x->level = x->targets[stage];
+        if (stage == x->sustain && x->gate) {
+            x->stage = stage;
+            x->holding = true;
+            return;
+        }
+    }
+    x->stage = ENVELOPE_IDLE;
+    x->holding = false;
+}
+
+/// Called when the running segment has reached its target.
+static void Envelope_Next(Envelope* x) {
+    x->level = x->targets[x->stage];
+    if (x->stage == x->sustain && x->gate) {
+        x->holding = true;
+        return;
+    }
+    Envelope_Start(x->stage + 1, x);
+}
+
+static void Envelope_GateOn(Envelope* x) {
+    x->gate = true;
+    Envelope_Start(0, x);
+}
+
+static void Envelope_GateOff(Envelope* x) {
+    x->gate = false;
+    if (x->sustain != ENVELOPE_NOSUSTAIN && x->stage != ENVELOPE_IDLE && x->stage <= x->sustain)
+        Envelope_Start(x->sustain + 1, x);
+}
+
+/// Renders n frames without gate edges.
+static void Envelope_Render(float* dest, int n, int channels, Envelope* x) {
+    float y[ENVELOPE_CHUNK];
+    while (n > 0) {
+        if (x->stage == ENVELOPE_IDLE || x->holding) {
+            for (int t = 0; t < n * channels; t++)
+                dest[t] = x->level;
+            return;
+        }
+
+        int m = x->length - x->position;
+        m = m < n ? m : n;
+        m = m < ENVELOPE_CHUNK ? m : ENVELOPE_CHUNK;
+        float first = (float) (x->position + 1);
+        if (x->linear) {
+            for (int t = 0; t < m; t++)
+                y[t] = x->offset + x->scale * (first + t);
+        } else if (x->power) {
+            /// the ramp can end slightly below 0 by rounding
+            for (int t = 0; t < m; t++)
+                y[t] = powf(fmaxf(x->offset + x->scale * (first + t), 0.f), x->curve);
+        } else {
+            /// the exponential is evaluated once per chunk, so the error of the powers cannot accumulate
+            float q = x->scale * expf(x->curve * first / x->length);
+            for (int t = 0; t < m; t++)
+                y[t] = x->offset + q * x->powers[t];
+        }
+
+        if (channels == 2) {
+            for (int t = 0; t < m; t++)
+                dest[2 * t] = dest[2 * t + 1] = y[t];
+        } else {
+            for (int t = 0; t < m; t++) {
+                for (int c = 0; c < channels; c++)
+                    dest[t * channels + c] = y[t];
+            }
+        }
+
+        x->level = y[m - 1];
+        x->position += m;
+        x->elapsed += m;
+        dest += m * channels;
+        n -= m;
+        if (x->position == x->length)
+            Envelope_Next(x);
+    }
+}
+
+/* Processing audio */
+
+OSL_API int Envelope_Process(float buffer[], int length, int channels, const float gate[], Envelope* x) {
+    int frames = length / channels;
+    int j = 0;
+    while (j < frames) {
+        /// render up to the next edge of the gate, which then takes effect at its exact frame
+        int edge = frames;
+        bool rising = false;
+        if (gate) {
+            for (int k = j; k < frames; k++) {
+                float g = gate[k * channels];
+                bool changed = (g > 0.f) != (x->lastGate > 0.f);
+                x->lastGate = g;
+                if (changed) {
+                    edge = k;
+                    rising = g > 0.f;
+                    break;
+                }
+            }
+        }
+
+        if (j == 0 && edge == frames && (x->stage == ENVELOPE_IDLE || x->holding))
+            return Signal_Fill(buffer, length, x->level);
+
+        Envelope_Render(buffer + j * channels, edge - j, channels, x);
+        if (edge < frames) {
+            if (rising)
+                Envelope_GateOn(x);
+            else
+                Envelope_GateOff(x);
+        }
+        j = edge;
+    }
+    return SIGNAL_AUDIO;
+}
+
+/* Setting and getting parameters */
+
+/// Applies changed segments to the running envelope.
+static void Envelope_Update(int index, Envelope* x) {
+    if (x->stage == ENVELOPE_IDLE || (index != x->stage && index >= 0))
+        return;
+    if (x->stage >= x->numSegments) {
+        x->stage = ENVELOPE_IDLE;
+        x->holding = false;
+        return;
+    }
+
+    /// a held sustain level that changes is approached over the length of its segment
+    int elapsed = x->holding ? 0 : x->elapsed;
+    int remaining = x->frames[x->stage] - elapsed;
+    Envelope_Begin(x->stage, remaining > 1 ? remaining : 1, x);
+    x->elapsed = elapsed;
+}
+
+/// Clamps the curve to the range of its kind.
+static float Envelope_Curve(float curve, int shape) {
+    if (shape == ENVELOPE_POWER)
+        return _clamp(curve, 1.f / ENVELOPE_MAXPOWER, ENVELOPE_MAXPOWER);
+    return _clamp(curve, -ENVELOPE_MAXCURVE, ENVELOPE_MAXCURVE);
+}
+
+OSL_API void Envelope_SetSegments(const int frames[], const float targets[], const float curves[], const int shapes[],
+                                  int numSegments, int sustain, Envelope* x) {
+    numSegments = numSegments < 0 ? 0 : (numSegments > ENVELOPE_MAXSEGMENTS ? ENVELOPE_MAXSEGMENTS : numSegments);
+    x->numSegments = numSegments;
+    x->sustain = sustain >= 0 && sustain < numSegments ? sustain : ENVELOPE_NOSUSTAIN;
+    for (int i = 0; i < numSegments; i++) {
+        x->frames[i] = frames[i];
+        x->targets[i] = targets[i];
+        x->shapes[i] = shapes ? shapes[i] : ENVELOPE_EXPONENTIAL;
+        x->curves[i] = curves ? Envelope_Curve(curves[i], x->shapes[i]) : (x->shapes[i] == ENVELOPE_POWER ? 1.f : 0.f);
+    }
+    Envelope_Update(-1, x);
+}
+
+OSL_API void Envelope_SetSegment(int index, int frames, float target, float curve, int shape, Envelope* x) {
+    if (index < 0 || index >= x->numSegments)
+        return;
+    x->frames[index] = frames;
+    x->targets[index] = target;
+    x->shapes[index] = shape;
+    x->curves[index] = Envelope_Curve(curve, shape);
+    Envelope_Update(index, x);
+}
+
+OSL_API void Envelope_SetGate(bool on, Envelope* x) {
+    if (on == x->gate)
+        return;
+    if (on)
+        Envelope_GateOn(x);
+    else
+        Envelope_GateOff(x);
+}
+
+OSL_API int Envelope_GetStage(Envelope* x) {
+    return x->stage;
+}
+
+OSL_API float Envelope_GetLevel(Envelope* x) {
+    return x->level;
+}
+
+OSL_API int Envelope_GetElapsed(Envelope* x) {
+    return x->elapsed;
+}
+
+OSL_API void Envelope_SetState(int stage, int elapsed, float level, Envelope* x) {
+    x->level = level;
+    x->holding = false;
+    if (stage < 0 || stage >= x->numSegments) {
+        x->stage = ENVELOPE_IDLE;
+        return;
+    }
+    x->stage = stage;
+    x->elapsed = elapsed > 0 ? elapsed : 0;
+    if (stage == x->sustain && x->gate && x->elapsed >= x->frames[stage]) {
+        x->holding = true;
+        return;
+    }
+    Envelope_Update(stage, x);
+}
+
+/* Allocating and freeing */
+
+OSL_API Envelope* Envelope_New() {
+    Envelope* x = (Envelope*) _malloc(sizeof(Envelope));
+    memset(x, 0, sizeof(Envelope));
+    x->sustain = ENVELOPE_NOSUSTAIN;
+    x->stage = ENVELOPE_IDLE;
+    return x;
+}
+
+OSL_API void Envelope_Free(Envelope* x) {
+    _free(x);
+}
@@ -0,0 +1,142 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// A segment-based envelope generator for ADSR, AD and breakpoint curves.
+///
+/// An envelope is a list of segments, each of which moves from the current level to its target within a number of
+/// frames. The shape of a segment is given by its kind and its curve:
+///   ENVELOPE_EXPONENTIAL: 0 is linear, positive values start slowly and end fast, negative values start fast and end
+///     slowly (an exponential approach). Rendered as level = offset + scale * ratio^n: the exponential is evaluated
+///     once per chunk and multiplied by a table of powers of the ratio.
+///   ENVELOPE_POWER: the level is a linear ramp raised to the power of the curve, 1 is linear. The ramp runs from
+///     start^(1 / curve) to target^(1 / curve), so a segment from 0 to 1 is t^curve and one from 1 to 0 is
+///     (1 - t)^curve. For levels from 0 up; negative levels are taken as 0.
+/// Every segment is rendered in closed form as a vector ramp instead of a per-sample state machine. A segment always
+/// starts at the current level, so retriggers and early releases don't jump.
+///
+/// One segment can be the sustain segment: while the gate is on, the envelope holds its target after reaching it. When
+/// the gate goes off, the envelope continues with the following segment from wherever it is. Without a sustain
+/// segment, the envelope is a one-shot that ignores the falling edge. Gate edges are read from the first channel of an
+/// audio-rate gate buffer and take effect at the exact frame.
+///
+/// The modules map to segments as follows:
+///   ADSR: linear attack to the peak level, decay to the sustain level, release to 0, sustain segment 1, each at least
+///     1 ms long. Retriggers continue from the current level; the former generator restarted from 0 and smoothed its
+///     output instead.
+///   AD: attack to 1, decay to 0, power curves with the linearity as exponent, no sustain segment
+///   Curve: one segment per breakpoint
+///
+/// While idle or sustaining, the output is a constant, which Envelope_Process() writes with Signal_Fill().
+///
+/// Envelope_New() and Envelope_Free() must not be called from the audio thread. All other functions are not
+/// thread-safe, hence the caller must avoid simultaneous access from multiple threads.
+
+#ifndef Envelope_h
+#define Envelope_h
+
+#include "main.h"
+
+#define ENVELOPE_MAXSEGMENTS 32
+#define ENVELOPE_CHUNK 64       // frames per closed-form evaluation
+#define ENVELOPE_MAXCURVE 30.f  // steepest exponential curve, in both directions
+#define ENVELOPE_MAXPOWER 100.f // steepest power curve, and 1 / ENVELOPE_MAXPOWER the flattest
+#define ENVELOPE_NOSUSTAIN -1   // sustain segment of one-shot envelopes
+#define ENVELOPE_IDLE -1        // stage after the last segment
+
+/// segment kinds
+#define ENVELOPE_EXPONENTIAL 0
+#define ENVELOPE_POWER 1
+
+struct Envelope {
+    int numSegments;
+    int sustain; // index of the sustain segment, or ENVELOPE_NOSUSTAIN
+    int frames[ENVELOPE_MAXSEGMENTS];
+    float targets[ENVELOPE_MAXSEGMENTS];
+    float curves[ENVELOPE_MAXSEGMENTS];
+    int shapes[ENVELOPE_MAXSEGMENTS];
+
+    int stage;      // running segment, or ENVELOPE_IDLE
+    bool holding;   // reached the target of the sustain segment while the gate is on
+    bool gate;
+    float lastGate; // last sample of the gate buffer, for edge detection
+    float level;    // last output
+
+    /// the running segment from its start: level(n) = offset + scale * ratio^(n + 1), or offset + scale * (n + 1)
+    int position; // frames since the start
+    int length;
+    int elapsed; // frames since the segment was entered, also across changes of the segment while it runs
+    bool linear;
+    bool power; // level(n) = (offset + scale * (n + 1))^curve
+    float offset;
+    float scale;
+    float curve;                  // ratio = exp(curve / length), or the exponent of a power segment
+    float powers[ENVELOPE_CHUNK]; // ratio^0 ... ratio^(ENVELOPE_CHUNK - 1)
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Processing audio */
+
+/// Renders 1 block of interleaved audio; every channel gets the same value. gate may be NULL, otherwise its first
+/// channel is scanned for edges. Returns the SIGNAL_ tag of the block.
+OSL_API int Envelope_Process(float buffer[], int length, int channels, const float gate[], Envelope* x);
+
+/* Setting and getting parameters */
+
+/// Replaces all segments. frames are lengths in frames, curves may be NULL for linear segments and shapes may be NULL
+/// for ENVELOPE_EXPONENTIAL segments. A running envelope continues with the segment at the same index, from its
+/// current level.
+OSL_API void Envelope_SetSegments(const int frames[], const float targets[], const float curves[], const int shapes[],
+                                  int numSegments, int sustain, Envelope* x);
+/// Changes one segment. If it is running, it continues from the current level and ends after the new length.
+OSL_API void Envelope_SetSegment(int index, int frames, float target, float curve, int shape, Envelope* x);
+/// Sets the gate from the main thread, e.g. for a button. Takes effect at the start of the next block.
+OSL_API void Envelope_SetGate(bool on, Envelope* x);
+/// Returns the running segment or ENVELOPE_IDLE.
+OSL_API int Envelope_GetStage(Envelope* x);
+/// Returns the last output value.
+OSL_API float Envelope_GetLevel(Envelope* x);
+/// Returns the frames since the running segment was entered.
+OSL_API int Envelope_GetElapsed(Envelope* x);
+/// Continues the given segment from the given level as if elapsed frames of it had passed, e.g. to follow another
+/// instance over the network. ENVELOPE_IDLE stops the envelope at that level.
+OSL_API void Envelope_SetState(int stage, int elapsed, float level, Envelope* x);
+
+/* Allocating and freeing */
+
+/// Allocates and returns a new idle envelope without segments.
+OSL_API Envelope* Envelope_New();
+/// Releases allocated resources.
+OSL_API void Envelope_Free(Envelope* x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* Envelope_h */
@@ -30,6 +30,7 @@
 #include <math.h>
 #include "Filter.h"
 #include <string.h>
+#include <stdint.h>
 
 extern "C" {
 
@@ -115,4 +116,190 @@ void processStereoFilter(float buffer[], int length, FilterData* mfL, FilterData
     // sprintf_s(buf, "mfL->b4 = %f", mfL->b4);
     // log(0, buf);
 }
+
+/// Selects a where mask is all ones and b where it is zero, through the bits: gcc does not if-convert float
+/// conditionals under the default -ftrapping-math, and a branch would keep the loops below from vectorising.
+static inline float Ladder_Select(uint32_t mask, float a, float b) {
+    uint32_t ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    uint32_t result = (ia & mask) | (ib & ~mask);
+    float f;
+    memcpy(&f, &result, sizeof(f));
+    return f;
+}
+
+/// Clamps to -1...1, comparing the magnitude bits as an integer.
+static inline float Ladder_Clamp(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    uint32_t over = -(uint32_t) ((int32_t) (bits & 0x7fffffffu) > 0x3f800000);
+    bits = (bits & ~over) | (((bits & 0x80000000u) | 0x3f800000u) & over);
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+/// 2^e, with a polynomial on the fractional part instead of powf, so that the coefficient loop vectorises. The error is
+/// below 3e-6, i.e. a fraction of a cent.
+static inline float Ladder_Exp2(float e) {
+    e = Ladder_Select(-(uint32_t) (e > 60.f), 60.f, e);
+    e = Ladder_Select(-(uint32_t) (e < -60.f), -60.f, e);
+    int i = (int) (e + 64.5f) - 64; // nearest integer, the fractional part is in -0.5...0.5
+    float f = e - (float) i;
+    float poly = 1.f + f * (0.6931472f + f * (0.2402265f + f * (0.05550411f + f * (0.009618129f + f * 0.001333356f))));
+    uint32_t bits = (uint32_t) (i + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return poly * scale;
+}
+
+/// The coefficients of processStereoFilter for a cutoff given in octaves / 10 above middle C, at 48 kHz.
+static inline void Ladder_Coefficients(float cut, float resonance, float* p, float* f, float* k) {
+    float freq = 261.6256f / 24000.f * Ladder_Exp2(cut * 10.f);
+    freq = Ladder_Select(-(uint32_t) (freq > 1.f), 1.f, freq);
+    float q = 1.0f - freq;
+    *p = freq + 0.8f * freq * q;
+    *f = *p + *p - 1.0f;
+    *k = resonance * (1.0f + 0.5f * q * (1.0f - q + 5.6f * q * q));
+}
+
+OSL_API void Ladder_Process(float buffer[], int length, const float fm[], float cutoff, float bandwidth,
+                            float resonance, int type, LadderData* x) {
+    bool dual = type == FILTER_BP || type == FILTER_NOTCH;
+    float offset1 = dual ? -bandwidth : 0.f;
+    float offset2 = dual ? bandwidth : 0.f;
+    if (dual)
+        resonance *= 0.7f; // less resonance for double filter mode
+
+    /// each lane outputs dry * input + wet * b4, i.e. b4 for low pass and input - b4 for high pass
+    bool lowpass1 = type == FILTER_LP || type == FILTER_NOTCH;
+    bool lowpass2 = type == FILTER_BP;
+    float dry1 = lowpass1 ? 0.f : 1.f, dry2 = lowpass2 ? 0.f : 1.f;
+    float dry[LADDER_LANES] = {dry1, dry1, dry2, dry2};
+    float wet[LADDER_LANES] = {1 - 2 * dry1, 1 - 2 * dry1, 1 - 2 * dry2, 1 - 2 * dry2};
+
+    /// the second filter takes the input in parallel (notch) or the first filter's output in series (band pass), the
+    /// latter one frame late so that both filters advance in the same instructions. Unused, it runs in parallel too:
+    /// left without input, its state would decay into denormals, which are slow on many CPUs.
+    float parallel = type == FILTER_BP ? 0.f : 1.f;
+    float series = type == FILTER_BP ? 1.f : 0.f;
+    float gain1 = type == FILTER_BP ? 0.f : 1.f;
+    float gain2 = dual ? 1.f : 0.f;
+
+    float b0[LADDER_LANES], b1[LADDER_LANES], b2[LADDER_LANES], b3[LADDER_LANES], b4[LADDER_LANES];
+    memcpy(b0, x->b0, sizeof(b0));
+    memcpy(b1, x->b1, sizeof(b1));
+    memcpy(b2, x->b2, sizeof(b2));
+    memcpy(b3, x->b3, sizeof(b3));
+    memcpy(b4, x->b4, sizeof(b4));
+    float chained[2] = {x->chained[0], x->chained[1]};
+
+    int frames = length / 2;
+    float start = x->lastCutoff;
+    float slope = frames > 0 ? (cutoff - start) / frames : 0.f; // slope limiting for dial
+    float cp[LADDER_CHUNK][LADDER_LANES], cf[LADDER_CHUNK][LADDER_LANES], ck[LADDER_CHUNK][LADDER_LANES];
+
+    for (int first = 0; first < frames; first += LADDER_CHUNK) {
+        int n = frames - first < LADDER_CHUNK ? frames - first : LADDER_CHUNK;
+
+        if (fm != NULL) {
+            /// exponential 1/Oct, taken from the left channel only
+            float p1[LADDER_CHUNK], f1[LADDER_CHUNK], k1[LADDER_CHUNK], p2[LADDER_CHUNK], f2[LADDER_CHUNK],
+                k2[LADDER_CHUNK];
+            const float* mod = fm + 2 * first;
+            for (int i = 0; i < n; i++) {
+                float cut = start + slope * (first + i) + Ladder_Clamp(mod[2 * i]);
+                Ladder_Coefficients(cut + offset1, resonance, &p1[i], &f1[i], &k1[i]);
+                Ladder_Coefficients(cut + offset2, resonance, &p2[i], &f2[i], &k2[i]);
+            }
+            for (int i = 0; i < n; i++) {
+                cp[i][0] = cp[i][1] = p1[i];
+                cf[i][0] = cf[i][1] = f1[i];
+                ck[i][0] = ck[i][1] = k1[i];
+                cp[i][2] = cp[i][3] = p2[i];
+                cf[i][2] = cf[i][3] = f2[i];
+                ck[i][2] = ck[i][3] = k2[i];
+            }
+        } else {
+            /// control rate: coefficients at both ends of the chunk, linearly interpolated
+            float p0[LADDER_LANES], f0[LADDER_LANES], k0[LADDER_LANES], p1[LADDER_LANES], f1[LADDER_LANES],
+                k1[LADDER_LANES];
+            float cut0 = start + slope * first, cut1 = start + slope * (first + n);
+            Ladder_Coefficients(cut0 + offset1, resonance, &p0[0], &f0[0], &k0[0]);
+            Ladder_Coefficients(cut0 + offset2, resonance, &p0[2], &f0[2], &k0[2]);
+            Ladder_Coefficients(cut1 + offset1, resonance, &p1[0], &f1[0], &k1[0]);
+            Ladder_Coefficients(cut1 + offset2, resonance, &p1[2], &f1[2], &k1[2]);
+            p0[1] = p0[0], f0[1] = f0[0], k0[1] = k0[0], p1[1] = p1[0], f1[1] = f1[0], k1[1] = k1[0];
+            p0[3] = p0[2], f0[3] = f0[2], k0[3] = k0[2], p1[3] = p1[2], f1[3] = f1[2], k1[3] = k1[2];
+            float step = 1.f / n;
+            for (int i = 0; i < n; i++) {
+                float t = i * step;
+                for (int l = 0; l < LADDER_LANES; l++) {
+                    cp[i][l] = p0[l] + t * (p1[l] - p0[l]);
+                    cf[i][l] = f0[l] + t * (f1[l] - f0[l]);
+                    ck[i][l] = k0[l] + t * (k1[l] - k0[l]);
+                }
+            }
+        }
+
+        for (int i = 0; i < n; i++) {
+            float* frame = buffer + 2 * (first + i);
+            float sample[LADDER_LANES] = {frame[0], frame[1], parallel * frame[0] + series * chained[0],
+                                          parallel * frame[1] + series * chained[1]};
+            float out[LADDER_LANES];
+            for (int l = 0; l < LADDER_LANES; l++) {
+                float p = cp[i][l], f = cf[i][l];
+                float input = Ladder_Clamp(sample[l]) - ck[i][l] * b4[l]; // feedback
+
+                /// as in ProcessSample, but the terms that do not depend on the previous stage are added last, so
+                /// that they are computed while the previous stage is still being computed. Like there, the stages
+                /// feed each other unclamped, and the states are only clamped after the update.
+                float t1 = b1[l];
+                float s1 = input * p + (b0[l] * p - t1 * f);
+                float t2 = b2[l];
+                float s2 = s1 * p + (t1 * p - t2 * f);
+                t1 = b3[l];
+                float s3 = s2 * p + (t2 * p - t1 * f);
+                float y = s3 * p + (t1 * p - b4[l] * f);
+                b4[l] = Ladder_Clamp(y - (y * y) * (y * 0.166667f)); // clipping
+                b3[l] = Ladder_Clamp(s3);
+                b2[l] = Ladder_Clamp(s2);
+                b1[l] = Ladder_Clamp(s1);
+                b0[l] = Ladder_Clamp(input);
+
+                out[l] = dry[l] * input + wet[l] * b4[l];
+            }
+            chained[0] = out[0];
+            chained[1] = out[1];
+            frame[0] = gain1 * out[0] + gain2 * out[2];
+            frame[1] = gain1 * out[1] + gain2 * out[3];
+        }
+    }
+
+    memcpy(x->b0, b0, sizeof(b0));
+    memcpy(x->b1, b1, sizeof(b1));
+    memcpy(x->b2, b2, sizeof(b2));
+    memcpy(x->b3, b3, sizeof(b3));
+    memcpy(x->b4, b4, sizeof(b4));
+    x->chained[0] = chained[0];
+    x->chained[1] = chained[1];
+    x->lastCutoff = cutoff;
+}
+
+OSL_API void Ladder_Clear(LadderData* x) {
+    for (int l = 0; l < LADDER_LANES; l++)
+        x->b0[l] = x->b1[l] = x->b2[l] = x->b3[l] = x->b4[l] = 0;
+    x->chained[0] = x->chained[1] = 0;
+}
+
+OSL_API LadderData* Ladder_New() {
+    LadderData* x = (LadderData*) _malloc(sizeof(LadderData));
+    Ladder_Clear(x);
+    x->lastCutoff = 0;
+    return x;
+}
+
+OSL_API void Ladder_Free(LadderData* x) {
+    _free(x);
+}
 }
@@ -34,10 +34,41 @@ struct FilterData {
     bool LP;
 };
 
+/// Filter types, mirroring filterSignalGenerator.filterType. Any other type is processed as a high pass.
+#define FILTER_LP 1
+#define FILTER_HP 2
+#define FILTER_BP 5    // high pass into low pass, at cutoff - bandwidth and cutoff + bandwidth
+#define FILTER_NOTCH 6 // low pass plus high pass, at cutoff - bandwidth and cutoff + bandwidth
+
+#define LADDER_LANES 4  // left and right of up to two filters
+#define LADDER_CHUNK 32 // frames whose coefficients are computed at once
+
+/// The state of a stereo ladder filter, or of two of them for band pass and notch. Lanes 0 and 1 hold the left and
+/// right channel of the first filter, lanes 2 and 3 those of the second, so one SIMD operation advances all of them.
+struct LadderData {
+    float b0[LADDER_LANES], b1[LADDER_LANES], b2[LADDER_LANES], b3[LADDER_LANES], b4[LADDER_LANES]; // beware denormals!
+    float chained[2];  // output of the first filter in the previous frame, the input of the second in band pass mode
+    float lastCutoff;  // cutoff at the end of the previous block, for slope limiting
+};
+
 extern "C" {
 typedef void (*LoggerFuncPtr)(int level, const char*); // Unity Delegate
 
 OSL_API void processStereoFilter(float buffer[], int length, FilterData* mfL, FilterData* mfR, float cutoffFrequency,
                                  float lastCutoffFrequency, bool freqGen, float filterBuffer[],
                                  float resonance /*, LoggerFuncPtr logger*/);
+
+/// Filters interleaved stereo audio in place with the ladder of processStereoFilter, with both channels, and both
+/// filters of the band pass and notch types, in SIMD lanes. The cutoff (0...1, 10 octaves from middle C) slides from
+/// the cutoff of the previous call to the given one over the block. fm holds interleaved frequency modulation in
+/// -1...1 from which the left channel is used, or is NULL. Without modulation, coefficients are computed every
+/// LADDER_CHUNK frames and interpolated in between, otherwise they are computed for every frame.
+OSL_API void Ladder_Process(float buffer[], int length, const float fm[], float cutoff, float bandwidth,
+                            float resonance, int type, LadderData* x);
+/// Silences the filter state.
+OSL_API void Ladder_Clear(LadderData* x);
+/// Returns a new filter instance.
+OSL_API LadderData* Ladder_New();
+/// Frees a filter instance.
+OSL_API void Ladder_Free(LadderData* x);
 }
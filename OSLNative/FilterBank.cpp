@@ -0,0 +1,179 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "FilterBank.h"
+#include "util.h"
+#include <math.h>
+#include <assert.h>
+
+enum FilterBankParams { P_FREQUENCY, P_RESONANCE, P_TYPE, P_N };
+
+/// Computes the per-frame steps that ramp cutoff and damping to their targets over the next frames.
+static void FilterBank_BeginBlock(int frames, FilterBank* x) {
+    for (int f = 0; f < x->numFilters; f++) {
+        x->gStep[f] = (x->targetG[f] - x->g[f]) / frames;
+        x->kStep[f] = (x->targetK[f] - x->k[f]) / frames;
+    }
+}
+
+/// Snaps to the targets, so that rounding in the steps does not accumulate across blocks.
+static void FilterBank_EndBlock(FilterBank* x) {
+    for (int f = 0; f < x->numFilters; f++) {
+        x->g[f] = x->targetG[f];
+        x->k[f] = x->targetK[f];
+    }
+}
+
+/// Advances all filters by 1 frame. The state is passed as restrict parameters, so that the compiler knows that the
+/// arrays do not overlap and can vectorise across filters.
+static void FilterBank_ProcessFrame(float* __restrict frame, int n, float* __restrict g, const float* __restrict gStep,
+                                    float* __restrict k, const float* __restrict kStep,
+                                    const float* __restrict lowGain, const float* __restrict bandGain,
+                                    const float* __restrict highGain, float* __restrict ic1eq,
+                                    float* __restrict ic2eq) {
+    for (int f = 0; f < n; f++) {
+        float v0 = frame[f];
+        float a1 = 1.f / (1.f + g[f] * (g[f] + k[f]));
+        float a2 = g[f] * a1;
+        float a3 = g[f] * a2;
+        float v3 = v0 - ic2eq[f];
+        float v1 = a1 * ic1eq[f] + a2 * v3;            // band
+        float v2 = ic2eq[f] + a2 * ic1eq[f] + a3 * v3; // low
+        ic1eq[f] = 2 * v1 - ic1eq[f];
+        ic2eq[f] = 2 * v2 - ic2eq[f];
+
+        /// selecting with gains per response instead of a comparison keeps the loop free of branches
+        float high = v0 - k[f] * v1 - v2;
+        frame[f] = lowGain[f] * v2 + bandGain[f] * v1 + highGain[f] * high;
+
+        g[f] += gStep[f];
+        k[f] += kStep[f];
+    }
+}
+
+/* Processing audio */
+
+OSL_API void FilterBank_Process(float buffer[], int n, FilterBank* x) {
+    if (n <= 0)
+        return;
+    int numFilters = x->numFilters;
+    FilterBank_BeginBlock(n, x);
+    for (int i = 0; i < n; i++) {
+        FilterBank_ProcessFrame(buffer + i * numFilters, numFilters, x->g, x->gStep, x->k, x->kStep, x->lowGain,
+                                x->bandGain, x->highGain, x->ic1eq, x->ic2eq);
+    }
+    FilterBank_EndBlock(x);
+}
+
+/* Setting parameters */
+
+OSL_API void FilterBank_SetParam(float value, int param, int index, FilterBank* x) {
+    assert(param < P_N);
+    if (index < 0 || index >= x->maxFilters)
+        return;
+
+    switch (param) {
+    case P_FREQUENCY: {
+        /// just below Nyquist, where tan() goes to infinity
+        float cutoff = _clamp(value, 1.f, 0.49f * x->sampleRate);
+        x->targetG[index] = tanf((float) M_PI * cutoff / x->sampleRate);
+        break;
+    }
+    case P_RESONANCE:
+        x->targetK[index] = 2.f - 1.98f * _clamp(value, 0.f, 1.f); // Q from 0.5 to 50
+        break;
+    case P_TYPE: {
+        int type = (int) _clamp(roundf(value), FILTERBANK_LP, FILTERBANK_NOTCH);
+        x->lowGain[index] = type == FILTERBANK_LP || type == FILTERBANK_NOTCH;
+        x->bandGain[index] = type == FILTERBANK_BP;
+        x->highGain[index] = type == FILTERBANK_HP || type == FILTERBANK_NOTCH;
+        break;
+    }
+    }
+}
+
+OSL_API void FilterBank_SetCount(int numFilters, FilterBank* x) {
+    if (numFilters < 0)
+        numFilters = 0;
+    x->numFilters = numFilters > x->maxFilters ? x->maxFilters : numFilters;
+}
+
+OSL_API void FilterBank_Clear(FilterBank* x) {
+    _fZero(x->ic1eq, x->maxFilters);
+    _fZero(x->ic2eq, x->maxFilters);
+}
+
+/* Allocating and freeing */
+
+OSL_API FilterBank* FilterBank_New(int maxFilters, float sampleRate) {
+    if (maxFilters < 1)
+        maxFilters = 1;
+
+    FilterBank* x = (FilterBank*) _malloc(sizeof(FilterBank));
+    x->numFilters = maxFilters;
+    x->maxFilters = maxFilters;
+    x->sampleRate = sampleRate;
+
+    x->g = (float*) _malloc(maxFilters * sizeof(float));
+    x->targetG = (float*) _malloc(maxFilters * sizeof(float));
+    x->gStep = (float*) _malloc(maxFilters * sizeof(float));
+    x->k = (float*) _malloc(maxFilters * sizeof(float));
+    x->targetK = (float*) _malloc(maxFilters * sizeof(float));
+    x->kStep = (float*) _malloc(maxFilters * sizeof(float));
+    x->lowGain = (float*) _malloc(maxFilters * sizeof(float));
+    x->bandGain = (float*) _malloc(maxFilters * sizeof(float));
+    x->highGain = (float*) _malloc(maxFilters * sizeof(float));
+    x->ic1eq = (float*) _malloc(maxFilters * sizeof(float));
+    x->ic2eq = (float*) _malloc(maxFilters * sizeof(float));
+
+    for (int f = 0; f < maxFilters; f++) {
+        FilterBank_SetParam(1000.f, P_FREQUENCY, f, x);
+        FilterBank_SetParam(0.f, P_RESONANCE, f, x);
+        FilterBank_SetParam(FILTERBANK_LP, P_TYPE, f, x);
+        x->g[f] = x->targetG[f];
+        x->k[f] = x->targetK[f];
+    }
+    _fZero(x->gStep, maxFilters);
+    _fZero(x->kStep, maxFilters);
+    FilterBank_Clear(x);
+    return x;
+}
+
+OSL_API void FilterBank_Free(FilterBank* x) {
+    _free(x->g);
+    _free(x->targetG);
+    _free(x->gStep);
+    _free(x->k);
+    _free(x->targetK);
+    _free(x->kStep);
+    _free(x->lowGain);
+    _free(x->bandGain);
+    _free(x->highGain);
+    _free(x->ic1eq);
+    _free(x->ic2eq);
+    _free(x);
+}
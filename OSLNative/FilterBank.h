@@ -0,0 +1,103 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// A bank of state-variable filters that are advanced together in one call.
+///
+/// Patches with a filter per voice, or many filtered percussion lanes, would otherwise cross the managed/native
+/// boundary and run the per-sample loop once per filter. The bank keeps the state of all its filters as
+/// structure-of-arrays and loops over the filters in the inner loop, so that the SIMD lanes run across filters: every
+/// lane is a different instance, with its own cutoff, resonance and type.
+///
+/// The filter is the trapezoidal (topology-preserving) state-variable filter by Andrew Simper, which stays stable
+/// under modulation. All responses are computed by each lane, which selects its own with gains per response, without
+/// branches. Cutoff and resonance changes are ramped linearly over the next block.
+///
+/// FilterBank_New() and FilterBank_Free() must not be called from the audio thread. All other functions are not
+/// thread-safe, hence the caller must avoid simultaneous access from multiple threads.
+
+#ifndef FilterBank_h
+#define FilterBank_h
+
+#include "main.h"
+
+#define FILTERBANK_LP 0
+#define FILTERBANK_HP 1
+#define FILTERBANK_BP 2
+#define FILTERBANK_NOTCH 3
+
+struct FilterBank {
+    int numFilters; // active filters, <= maxFilters
+    int maxFilters;
+    float sampleRate;
+
+    // one entry per filter
+    float* g; // tan(pi * cutoff / sampleRate)
+    float* targetG;
+    float* gStep;
+    float* k; // damping, 1 / Q
+    float* targetK;
+    float* kStep;
+    float* lowGain; // the response
+    float* bandGain;
+    float* highGain;
+    float* ic1eq; // the integrator states
+    float* ic2eq;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Processing audio */
+
+/// Filters n frames in place. The buffer is interleaved with one channel per active filter, i.e.
+/// buffer[frame * numFilters + filter]; a stereo voice takes two filters.
+OSL_API void FilterBank_Process(float buffer[], int n, FilterBank* x);
+
+/* Setting parameters */
+
+/// Sets a parameter of one filter to the specified value: the cutoff in Hz, the resonance in 0...1 or the type
+/// (FILTERBANK_LP, ...).
+OSL_API void FilterBank_SetParam(float value, int param, int index, FilterBank* x);
+/// Sets the number of active filters, clamped to the maximum given to FilterBank_New().
+OSL_API void FilterBank_SetCount(int numFilters, FilterBank* x);
+/// Silences the state of all filters.
+OSL_API void FilterBank_Clear(FilterBank* x);
+
+/* Allocating and freeing */
+
+/// Allocates and returns a new bank of up to maxFilters low pass filters at 1 kHz without resonance, all of them
+/// active.
+OSL_API FilterBank* FilterBank_New(int maxFilters, float sampleRate);
+/// Releases allocated resources.
+OSL_API void FilterBank_Free(FilterBank* x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FilterBank_h */
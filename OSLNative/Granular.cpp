@@ -0,0 +1,449 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Granular.h"
+#include "SampleCodec.h"
+#include "SamplePool.h"
+#include "util.h"
+#include "libs/pcg-cpp/include/pcg_random.hpp"
+#include <math.h>
+#include <stdint.h>
+#include <assert.h>
+
+enum GranularParams {
+    P_POSITION,       // center of the onsets in the sample, [0, 1]
+    P_SPRAY,          // random offset of the onset position, in seconds
+    P_DURATION,       // grain length, in seconds
+    P_DENSITY,        // mean onsets per second
+    P_DENSITY_JITTER, // [0, 1]
+    P_PITCH,          // playback speed, negative plays backwards
+    P_PITCH_JITTER,   // random pitch offset, in semitones
+    P_PAN,            // [-1, 1]
+    P_PAN_SPREAD,     // random pan offset, [0, 1]
+    P_AMPLITUDE,      // gain of new grains
+    P_WINDOW,         // GRANULAR_WINDOW_
+    P_N
+};
+
+#define GRANULAR_CHUNK 64         // frames per chunk
+#define GRANULAR_MAXDURATION 10.f // seconds, keeps the window position exact in float
+#define GRANULAR_WINDOW_STEP 8    // frames between two window table reads
+
+/// The window tables, built on first use. The guard entry repeats the last value, so the interpolation between two
+/// entries never reads past a table.
+struct GranularWindows {
+    float table[GRANULAR_WINDOWS][GRANULAR_WINDOW_SIZE + 1];
+
+    GranularWindows() {
+        for (int i = 0; i <= GRANULAR_WINDOW_SIZE; i++) {
+            float t = (float) i / GRANULAR_WINDOW_SIZE;
+            float edge = t < 0.5f ? t : 1.f - t; // distance to the closer end
+
+            table[GRANULAR_WINDOW_HANN][i] = 0.5f - 0.5f * cosf(2.f * (float) M_PI * t);
+            table[GRANULAR_WINDOW_TRIANGLE][i] = 2.f * edge;
+            table[GRANULAR_WINDOW_TUKEY][i] = edge < 0.25f ? 0.5f - 0.5f * cosf(4.f * (float) M_PI * edge) : 1.f;
+            table[GRANULAR_WINDOW_EXPDECAY][i] =
+                t < 0.05f ? t / 0.05f : expf(-6.9f * (t - 0.05f) / 0.95f) * (1.f - t) / 0.95f; // -60 dB at the end
+        }
+    }
+};
+
+static const GranularWindows& Granular_Windows() {
+    static const GranularWindows windows; // thread-safe initialisation
+    return windows;
+}
+
+struct GranularSettings {
+    float position;
+    float spray;
+    float duration;
+    float density;
+    float densityJitter;
+    float pitch;
+    float pitchJitter;
+    float pan;
+    float panSpread;
+    float amplitude;
+    int window;
+};
+
+struct Granular {
+    int numGrains; // sounding grains, packed at the front of the arrays
+    int maxGrains;
+    float sampleRate;
+
+    // one entry per grain
+    int64_t* position;  // 32.32 fixed-point read position at the current frame
+    float* increment;   // playback speed
+    int* age;           // frames since the onset
+    int* length;        // in frames
+    int* delay;         // frames of the current chunk before the onset, only non-zero in the first chunk
+    float* windowScale; // window table entries per frame
+    const float** window;
+    float* gainLeft; // amplitude and pan
+    float* gainRight;
+
+    GranularSettings settings;
+    double countdown; // frames until the next onset
+    int dropped;
+    pcg32 rng;
+};
+
+/// Uniform random number in [-1, 1).
+static inline float Granular_Bipolar(Granular* x) {
+    return (x->rng() >> 8) * (2.f / 16777216.f) - 1.f;
+}
+
+static inline float Granular_Sample(float value) {
+    return value;
+}
+
+static inline float Granular_Sample(int16_t value) {
+    return SampleCodec_Int16(value);
+}
+
+/// Starts a new grain delay frames into the current chunk. All random choices are made here, once per grain.
+static void Granular_Spawn(int delay, int clipFrames, Granular* x) {
+    if (x->numGrains == x->maxGrains) {
+        x->dropped++;
+        return;
+    }
+
+    const GranularSettings& s = x->settings;
+    double position = s.position * (clipFrames - 1) + Granular_Bipolar(x) * s.spray * x->sampleRate;
+    position = position < 0 ? 0 : (position > clipFrames - 1 ? clipFrames - 1 : position);
+    float pitch = s.pitch * exp2f(Granular_Bipolar(x) * s.pitchJitter / 12.f);
+    float pan = _clamp(s.pan + Granular_Bipolar(x) * s.panSpread, -1.f, 1.f);
+    float angle = (pan + 1.f) * (float) M_PI * 0.25f; // constant power
+    int length = (int) (s.duration * x->sampleRate);
+
+    int g = x->numGrains++;
+    x->position[g] = (int64_t) (position * 4294967296.0);
+    x->increment[g] = _clamp(pitch, -GRANULAR_MAXPITCH, GRANULAR_MAXPITCH);
+    x->age[g] = 0;
+    x->length[g] = length > 1 ? length : 1;
+    x->delay[g] = delay;
+    x->windowScale[g] = (float) GRANULAR_WINDOW_SIZE / x->length[g];
+    x->window[g] = Granular_Windows().table[s.window];
+    x->gainLeft[g] = s.amplitude * cosf(angle);
+    x->gainRight[g] = s.amplitude * sinf(angle);
+}
+
+/// Schedules the onsets of the next m frames.
+static void Granular_Schedule(int m, int clipFrames, Granular* x) {
+    const GranularSettings& s = x->settings;
+    if (s.density <= 0.f) {
+        x->countdown = 0;
+        return;
+    }
+
+    double interval = x->sampleRate / s.density;
+    while (x->countdown < m) {
+        Granular_Spawn((int) x->countdown, clipFrames, x);
+        double next = interval * (1.f + s.densityJitter * Granular_Bipolar(x));
+        x->countdown += next > 1.0 ? next : 1.0;
+    }
+    x->countdown -= m;
+}
+
+/// Reads a window table at position p with linear interpolation. Positions past the end read the last entry.
+static inline float Granular_Window(float p, const float* window) {
+    p = p < GRANULAR_WINDOW_SIZE ? p : GRANULAR_WINDOW_SIZE;
+    int k = (int) p < GRANULAR_WINDOW_SIZE ? (int) p : GRANULAR_WINDOW_SIZE - 1;
+    return window[k] + (p - k) * (window[k + 1] - window[k]);
+}
+
+/// Adds n frames of one grain to left and right.
+///
+/// The reads from the sample are gathers, so they get a loop of their own, and the index arithmetic before and the
+/// interpolation and mixing after it are separate loops that the compiler can vectorise. Untransposed grains read
+/// contiguous frames with a constant fraction and skip the gather. The read position is kept relative to the frame at
+/// the start of the chunk, where float is precise enough, and the clamp keeps the reads inside the sample if a grain
+/// runs over either end.
+///
+/// The window is read from the table every GRANULAR_WINDOW_STEP frames and interpolated linearly in between, which
+/// avoids a second gather per frame.
+template <typename T, int Channels>
+static void Granular_RenderGrain(float* __restrict left, float* __restrict right, int n, const T* __restrict clip,
+                                 int last, int64_t position, float increment, int age, float windowScale,
+                                 const float* __restrict window, float gainLeft, float gainRight) {
+    float w[GRANULAR_CHUNK + GRANULAR_WINDOW_STEP];
+    float from = Granular_Window(age * windowScale, window);
+    for (int j = 0; j < n; j += GRANULAR_WINDOW_STEP) {
+        float to = Granular_Window((age + j + GRANULAR_WINDOW_STEP) * windowScale, window);
+        float step = (to - from) * (1.f / GRANULAR_WINDOW_STEP);
+        for (int t = 0; t < GRANULAR_WINDOW_STEP; t++)
+            w[j + t] = from + t * step;
+        from = to;
+    }
+
+    int base = (int) (position >> 32);
+    float offset = (uint32_t) position * (1.f / 4294967296.f);
+
+    if (increment == 1.f && base >= 0 && base + n <= last) {
+        const T* src = clip + base * Channels;
+        for (int j = 0; j < n; j++) {
+            float a = Granular_Sample(src[j * Channels]);
+            float l = (a + offset * (Granular_Sample(src[(j + 1) * Channels]) - a)) * w[j];
+            float r = l;
+            if (Channels == 2) {
+                a = Granular_Sample(src[j * Channels + 1]);
+                r = (a + offset * (Granular_Sample(src[(j + 1) * Channels + 1]) - a)) * w[j];
+            }
+            left[j] += l * gainLeft;
+            right[j] += r * gainRight;
+        }
+        return;
+    }
+
+    int index[GRANULAR_CHUNK];
+    float frac[GRANULAR_CHUNK];
+    for (int j = 0; j < n; j++) {
+        float relative = offset + j * increment;
+        int i = (int) (relative + 1024.f) - 1024; // floor, |relative| < GRANULAR_CHUNK * GRANULAR_MAXPITCH
+        frac[j] = relative - i;
+        int k = base + i;
+        index[j] = (k < 0 ? 0 : (k > last ? last : k)) * Channels;
+    }
+
+    float a[Channels][GRANULAR_CHUNK];
+    float b[Channels][GRANULAR_CHUNK];
+    for (int j = 0; j < n; j++) {
+        for (int c = 0; c < Channels; c++) {
+            a[c][j] = Granular_Sample(clip[index[j] + c]);
+            b[c][j] = Granular_Sample(clip[index[j] + Channels + c]);
+        }
+    }
+
+    for (int j = 0; j < n; j++) {
+        float l = (a[0][j] + frac[j] * (b[0][j] - a[0][j])) * w[j];
+        float r = Channels == 2 ? (a[Channels - 1][j] + frac[j] * (b[Channels - 1][j] - a[Channels - 1][j])) * w[j] : l;
+        left[j] += l * gainLeft;
+        right[j] += r * gainRight;
+    }
+}
+
+template <typename T, int Channels>
+static void Granular_Render(float buffer[], int length, int channels, const T* clip, int clipFrames, Granular* x) {
+    int frames = length / channels;
+    float left[GRANULAR_CHUNK], right[GRANULAR_CHUNK];
+    _fZero(buffer, length);
+
+    for (int chunk = 0; chunk < frames; chunk += GRANULAR_CHUNK) {
+        int m = frames - chunk < GRANULAR_CHUNK ? frames - chunk : GRANULAR_CHUNK;
+        Granular_Schedule(m, clipFrames, x);
+        if (x->numGrains == 0)
+            continue;
+
+        _fZero(left, m);
+        _fZero(right, m);
+        for (int g = 0; g < x->numGrains; g++) {
+            int delay = x->delay[g];
+            int remaining = x->length[g] - x->age[g];
+            int n = m - delay < remaining ? m - delay : remaining;
+            Granular_RenderGrain<T, Channels>(left + delay, right + delay, n, clip, clipFrames - 2, x->position[g],
+                                              x->increment[g], x->age[g], x->windowScale[g], x->window[g],
+                                              x->gainLeft[g], x->gainRight[g]);
+            x->position[g] += (int64_t) ((double) x->increment[g] * n * 4294967296.0);
+            x->age[g] += n;
+            x->delay[g] = 0;
+        }
+
+        /// ended grains are replaced by the last sounding one, which keeps the pool packed
+        for (int g = x->numGrains - 1; g >= 0; g--) {
+            if (x->age[g] < x->length[g])
+                continue;
+            int last = --x->numGrains;
+            x->position[g] = x->position[last];
+            x->increment[g] = x->increment[last];
+            x->age[g] = x->age[last];
+            x->length[g] = x->length[last];
+            x->delay[g] = x->delay[last];
+            x->windowScale[g] = x->windowScale[last];
+            x->window[g] = x->window[last];
+            x->gainLeft[g] = x->gainLeft[last];
+            x->gainRight[g] = x->gainRight[last];
+        }
+
+        float* dest = buffer + chunk * channels;
+        if (channels == 1) {
+            for (int j = 0; j < m; j++)
+                dest[j] = 0.5f * (left[j] + right[j]);
+        } else {
+            for (int j = 0; j < m; j++) {
+                dest[j * channels] = left[j];
+                dest[j * channels + 1] = right[j];
+            }
+        }
+    }
+}
+
+/* Processing audio */
+
+OSL_API void Granular_Process(float buffer[], int length, int channels, float clip[], int clipFrames,
+                              int clipChannels, Granular* x) {
+    if (!clip || clipFrames < 2 || clipChannels < 1 || clipChannels > 2) {
+        _fZero(buffer, length);
+        return;
+    }
+    if (clipChannels == 2)
+        Granular_Render<float, 2>(buffer, length, channels, clip, clipFrames, x);
+    else
+        Granular_Render<float, 1>(buffer, length, channels, clip, clipFrames, x);
+}
+
+OSL_API void Granular_ProcessPooled(float buffer[], int length, int channels, int sample, Granular* x) {
+    int frames, clipChannels, clipFormat;
+    const void* clip = SamplePool_Lock(sample, &frames, &clipChannels, &clipFormat);
+    if (!clip || frames < 2 || clipFormat == SAMPLECODEC_ADPCM) {
+        _fZero(buffer, length);
+        if (clip)
+            SamplePool_Unlock(sample);
+        return;
+    }
+
+    if (clipFormat == SAMPLECODEC_INT16) {
+        if (clipChannels == 2)
+            Granular_Render<int16_t, 2>(buffer, length, channels, (const int16_t*) clip, frames, x);
+        else
+            Granular_Render<int16_t, 1>(buffer, length, channels, (const int16_t*) clip, frames, x);
+    } else {
+        if (clipChannels == 2)
+            Granular_Render<float, 2>(buffer, length, channels, (const float*) clip, frames, x);
+        else
+            Granular_Render<float, 1>(buffer, length, channels, (const float*) clip, frames, x);
+    }
+    SamplePool_Unlock(sample);
+}
+
+/* Setting and getting parameters */
+
+OSL_API void Granular_SetParam(float value, int param, Granular* x) {
+    assert(param < P_N);
+    GranularSettings& s = x->settings;
+
+    switch (param) {
+    case P_POSITION:
+        s.position = _clamp(value, 0.f, 1.f);
+        break;
+    case P_SPRAY:
+        s.spray = value > 0.f ? value : 0.f;
+        break;
+    case P_DURATION:
+        s.duration = _clamp(value, 0.f, GRANULAR_MAXDURATION);
+        break;
+    case P_DENSITY:
+        s.density = _clamp(value, 0.f, x->sampleRate);
+        break;
+    case P_DENSITY_JITTER:
+        s.densityJitter = _clamp(value, 0.f, 1.f);
+        break;
+    case P_PITCH:
+        s.pitch = value;
+        break;
+    case P_PITCH_JITTER:
+        s.pitchJitter = value > 0.f ? value : 0.f;
+        break;
+    case P_PAN:
+        s.pan = _clamp(value, -1.f, 1.f);
+        break;
+    case P_PAN_SPREAD:
+        s.panSpread = _clamp(value, 0.f, 1.f);
+        break;
+    case P_AMPLITUDE:
+        s.amplitude = value;
+        break;
+    case P_WINDOW:
+        s.window = (int) _clamp(roundf(value), GRANULAR_WINDOW_HANN, GRANULAR_WINDOWS - 1);
+        break;
+    }
+}
+
+OSL_API int Granular_GetActiveGrains(Granular* x) {
+    return x->numGrains;
+}
+
+OSL_API int Granular_GetDroppedGrains(Granular* x) {
+    return x->dropped;
+}
+
+OSL_API void Granular_Clear(Granular* x) {
+    x->numGrains = 0;
+}
+
+/* Allocating and freeing */
+
+OSL_API Granular* Granular_New(int maxGrains, float sampleRate, int seed) {
+    if (maxGrains < 1)
+        maxGrains = 1;
+
+    Granular* x = new Granular();
+    x->numGrains = 0;
+    x->maxGrains = maxGrains;
+    x->sampleRate = sampleRate;
+
+    x->position = (int64_t*) _malloc(maxGrains * sizeof(int64_t));
+    x->increment = (float*) _malloc(maxGrains * sizeof(float));
+    x->age = (int*) _malloc(maxGrains * sizeof(int));
+    x->length = (int*) _malloc(maxGrains * sizeof(int));
+    x->delay = (int*) _malloc(maxGrains * sizeof(int));
+    x->windowScale = (float*) _malloc(maxGrains * sizeof(float));
+    x->window = (const float**) _malloc(maxGrains * sizeof(const float*));
+    x->gainLeft = (float*) _malloc(maxGrains * sizeof(float));
+    x->gainRight = (float*) _malloc(maxGrains * sizeof(float));
+
+    x->settings.position = 0.f;
+    x->settings.spray = 0.f;
+    x->settings.duration = 0.1f;
+    x->settings.density = 10.f;
+    x->settings.densityJitter = 0.f;
+    x->settings.pitch = 1.f;
+    x->settings.pitchJitter = 0.f;
+    x->settings.pan = 0.f;
+    x->settings.panSpread = 0.f;
+    x->settings.amplitude = 1.f;
+    x->settings.window = GRANULAR_WINDOW_HANN;
+    x->countdown = 0;
+    x->dropped = 0;
+    x->rng.seed(seed);
+
+    Granular_Windows(); // builds the tables here instead of on the audio thread
+    return x;
+}
+
+OSL_API void Granular_Free(Granular* x) {
+    _free(x->position);
+    _free(x->increment);
+    _free(x->age);
+    _free(x->length);
+    _free(x->delay);
+    _free(x->windowScale);
+    _free(x->window);
+    _free(x->gainLeft);
+    _free(x->gainRight);
+    delete x;
+}
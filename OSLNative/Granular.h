@@ -0,0 +1,98 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// A granular engine: a cloud of short, windowed grains read from one sample.
+///
+/// Clouds built from many clip players need one managed object and one native call per voice. Here, all grains live in
+/// a fixed-capacity pool that is kept as structure-of-arrays (position, pitch, window and pan per grain), and the
+/// active grains are kept packed at the front of the pool, so that a block of audio is rendered with one pass over the
+/// live grains per chunk. A grain that ends is replaced by the last live grain, so there is no per-grain allocation.
+///
+/// New grains are scheduled at audio rate: density sets the mean number of onsets per second, the density jitter
+/// randomises the intervals between them (0 is periodic, 1 uniformly random between 0 and twice the mean). Position,
+/// pitch and pan are jittered per grain. Parameters are sampled when a grain starts, so changing them never clicks a
+/// sounding grain. When the pool is full, onsets are skipped.
+///
+/// The window shapes are precomputed tables that are read with linear interpolation, so no grain evaluates a window
+/// function per sample.
+///
+/// Granular_New() and Granular_Free() must not be called from the audio thread. All other functions are not
+/// thread-safe, hence the caller must avoid simultaneous access from multiple threads.
+
+#ifndef Granular_h
+#define Granular_h
+
+#include "main.h"
+
+#define GRANULAR_WINDOW_HANN 0
+#define GRANULAR_WINDOW_TRIANGLE 1
+#define GRANULAR_WINDOW_TUKEY 2    // flat top, cosine fades over the first and last quarter
+#define GRANULAR_WINDOW_EXPDECAY 3 // short linear attack, exponential decay
+#define GRANULAR_WINDOWS 4
+
+#define GRANULAR_WINDOW_SIZE 1024 // entries per window table, plus one guard entry
+#define GRANULAR_MAXPITCH 8.f     // playback speed limit of a grain, in both directions
+
+struct Granular;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Processing audio */
+
+/// Renders 1 block of interleaved stereo audio from a sample that is owned by the managed side. The buffer is
+/// overwritten. clip holds clipFrames interleaved frames of 1 or 2 channels; mono is played on both channels.
+OSL_API void Granular_Process(float buffer[], int length, int channels, float clip[], int clipFrames,
+                              int clipChannels, Granular* x);
+/// Same as Granular_Process(), but reads a float32 or int16 sample from the SamplePool. Renders silence if the handle
+/// is not valid or the sample is stored as ADPCM, which cannot be read at random positions.
+OSL_API void Granular_ProcessPooled(float buffer[], int length, int channels, int sample, Granular* x);
+
+/* Setting and getting parameters */
+
+/// Sets a parameter to the specified value, see GranularParams in Granular.cpp.
+OSL_API void Granular_SetParam(float value, int param, Granular* x);
+/// Returns the number of currently sounding grains.
+OSL_API int Granular_GetActiveGrains(Granular* x);
+/// Returns the number of onsets that were skipped because the pool was full.
+OSL_API int Granular_GetDroppedGrains(Granular* x);
+/// Stops all grains immediately.
+OSL_API void Granular_Clear(Granular* x);
+
+/* Allocating and freeing */
+
+/// Allocates and returns a new granular engine with a pool of up to maxGrains simultaneous grains.
+OSL_API Granular* Granular_New(int maxGrains, float sampleRate, int seed);
+/// Releases allocated resources.
+OSL_API void Granular_Free(Granular* x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* Granular_h */
@@ -0,0 +1,593 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Graph.h"
+#include "util.h"
+#include "Signal.h"
+#include "Delay.h"
+#include "Compressor.h"
+#include "Freeverb.h"
+#include <string.h>
+#include <assert.h>
+
+/* Built-in kernels */
+
+/// Built-in nodes process in place, so we start from a copy of inlet 0 (or silence).
+static void Graph_CopyInlet(float* out, float** inputs, int n) {
+    if (inputs[0])
+        _fCopy(inputs[0], out, n);
+    else
+        _fZero(out, n);
+}
+
+/// Silent inlets are skipped and constant inlets are summed up as scalars, so only the audio inlets cost a pass over
+/// the buffer.
+static void Graph_ProcessMix(GraphNode* node, float** inputs, const int* tags, const float* values, int n) {
+    float* out = node->buffer;
+    float constant = 0;
+    bool first = true;
+    for (int i = 0; i < GRAPH_MAXINPUTS; i++) {
+        if (tags[i] == SIGNAL_SILENT)
+            continue;
+        if (tags[i] == SIGNAL_CONSTANT) {
+            constant += values[i];
+            continue;
+        }
+        if (first)
+            _fCopy(inputs[i], out, n);
+        else
+            _fAdd(inputs[i], out, out, n);
+        first = false;
+    }
+    if (first) {
+        node->tag = Signal_Fill(out, n, constant);
+        node->value = constant;
+        return;
+    }
+    if (constant != 0)
+        _fAddSingle(out, constant, out, n);
+    node->tag = SIGNAL_AUDIO;
+}
+
+static void Graph_ProcessNode(GraphNode* node, float** inputs, const int* tags, const float* values, int n,
+                              int channels, float* scratch) {
+    node->tag = SIGNAL_AUDIO;
+    switch (node->type) {
+    case GRAPHNODE_EXTERNAL:
+        node->process(node->buffer, inputs, GRAPH_MAXINPUTS, n, channels, node->state);
+        node->tag = Signal_Classify(node->buffer, n, &node->value);
+        break;
+    case GRAPHNODE_MIX:
+        Graph_ProcessMix(node, inputs, tags, values, n);
+        break;
+    case GRAPHNODE_DELAY: {
+        Graph_CopyInlet(node->buffer, inputs, n);
+        /// Delay_Process() deinterleaves its control buffer in place, so it gets a copy.
+        float* timeBuffer = NULL;
+        if (inputs[1]) {
+            _fCopy(inputs[1], scratch, n);
+            timeBuffer = scratch;
+        }
+        Delay_Process(node->buffer, timeBuffer, NULL, NULL, n, channels, (DelayData*) node->state);
+        break;
+    }
+    case GRAPHNODE_FREEVERB:
+        Graph_CopyInlet(node->buffer, inputs, n);
+        Freeverb_Process(node->buffer, n, channels, (freeverb::ReverbModel*) node->state);
+        break;
+    case GRAPHNODE_COMPRESSOR:
+        Graph_CopyInlet(node->buffer, inputs, n);
+        /// Without a sidechain, the compressor listens to its own input.
+        Compressor_Process(node->buffer, inputs[1] ? inputs[1] : node->buffer, n, channels,
+                           (CompressorData*) node->state);
+        break;
+    default:
+        node->tag = Signal_Fill(node->buffer, n, 0);
+        break;
+    }
+}
+
+/* Sorting */
+
+/// Marks feedback inlets and cuts the sorted graph into chains. A node joins the chain of its predecessor if that is
+/// its only forward inlet and the predecessor feeds nothing else. External and internal nodes never share a chain, so
+/// that external nodes don't drag internal work onto the calling thread. Cross-chain edges therefore always end at the
+/// head of a chain, which keeps the chains in topological order.
+static void Graph_BuildTasks(Graph* x) {
+    int* fwdIn = x->indegree; // both are free again once the sort is done
+    int* fwdOut = x->queue;
+
+    for (int i = 0; i < x->orderLength; i++) {
+        int v = x->order[i];
+        x->pos[v] = i;
+        fwdIn[v] = 0;
+        fwdOut[v] = 0;
+        x->lastUse[v] = x->nodes[v].isFeedbackSource; // remembered until step 1 is done
+        x->nodes[v].isFeedbackSource = false;
+    }
+
+    /// 1. An inlet is a feedback inlet if its source is not rendered before the node itself
+    for (int i = 0; i < x->orderLength; i++) {
+        int v = x->order[i];
+        GraphNode* node = &x->nodes[v];
+        for (int k = 0; k < GRAPH_MAXINPUTS; k++) {
+            int src = node->inputs[k];
+            node->feedback[k] = false;
+            if (src < 0)
+                continue;
+            if (x->pos[src] >= x->pos[v]) {
+                node->feedback[k] = true;
+                x->nodes[src].isFeedbackSource = true;
+            } else {
+                fwdIn[v]++;
+                fwdOut[src]++;
+            }
+        }
+    }
+
+    /// A node that just became a feedback source must not replay the block it rendered back when it last was one
+    for (int i = 0; i < x->orderLength; i++) {
+        GraphNode* node = &x->nodes[x->order[i]];
+        if (node->isFeedbackSource && !x->lastUse[x->order[i]])
+            _fZero(node->previous, x->maxLength);
+    }
+
+    /// 2. Chains
+    x->numTasks = 0;
+    for (int i = 0; i < x->orderLength; i++) {
+        int v = x->order[i];
+        GraphNode* node = &x->nodes[v];
+        node->next = -1;
+
+        int pred = -1;
+        if (fwdIn[v] == 1) {
+            for (int k = 0; k < GRAPH_MAXINPUTS; k++) {
+                if (node->inputs[k] >= 0 && !node->feedback[k])
+                    pred = node->inputs[k];
+            }
+            if (fwdOut[pred] != 1 || (x->nodes[pred].type == GRAPHNODE_EXTERNAL) != (node->type == GRAPHNODE_EXTERNAL))
+                pred = -1;
+        }
+
+        int t;
+        if (pred >= 0) {
+            t = x->nodeTask[pred];
+            x->nodes[pred].next = v;
+        } else {
+            t = x->numTasks++;
+            x->taskHead[t] = v;
+            x->taskMainOnly[t] = false;
+        }
+        x->nodeTask[v] = t;
+        if (node->type == GRAPHNODE_EXTERNAL)
+            x->taskMainOnly[t] = true;
+    }
+
+    /// 3. Dependencies between chains, successor lists in compressed form
+    for (int t = 0; t <= x->numTasks; t++) {
+        x->taskSuccStart[t] = 0;
+        if (t < x->numTasks)
+            x->taskDeps[t] = 0;
+    }
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < x->orderLength; i++) {
+            int v = x->order[i];
+            GraphNode* node = &x->nodes[v];
+            for (int k = 0; k < GRAPH_MAXINPUTS; k++) {
+                int src = node->inputs[k];
+                if (src < 0 || node->feedback[k] || x->nodeTask[src] == x->nodeTask[v])
+                    continue;
+                if (pass == 0) {
+                    x->taskDeps[x->nodeTask[v]]++;
+                    x->taskSuccStart[x->nodeTask[src] + 1]++;
+                } else {
+                    x->taskSucc[fwdOut[x->nodeTask[src]]++] = x->nodeTask[v];
+                }
+            }
+        }
+        if (pass == 0) {
+            for (int t = 0; t < x->numTasks; t++) {
+                x->taskSuccStart[t + 1] += x->taskSuccStart[t];
+                fwdOut[t] = x->taskSuccStart[t]; // fill pointers for the second pass
+            }
+        }
+    }
+
+    x->job.numTasks = x->numTasks;
+    x->job.dependencies = x->taskDeps;
+    x->job.succStart = x->taskSuccStart;
+    x->job.succ = x->taskSucc;
+    x->job.mainOnly = x->taskMainOnly;
+}
+
+static bool Graph_IsPinned(int v, Graph* x) {
+    return v == x->output || x->nodes[v].isFeedbackSource;
+}
+
+/// Hands out arena slots to the node buffers. A slot is only released after the node that reads it last has got its
+/// own slot, so no node ever renders into one of its inputs.
+static void Graph_AssignBuffers(Graph* x) {
+    BufferArena_Reset(x->arena);
+    x->parallel = x->scheduler && x->numTasks > 1;
+
+    if (x->parallel) {
+        /// Chains run concurrently, so slots are only shared within a chain: a node takes the slot of the node two
+        /// steps up the chain, whose only reader (the node in between) has finished by then.
+        for (int t = 0; t < x->numTasks; t++) {
+            int prev = -1, prevprev = -1;
+            for (int v = x->taskHead[t]; v >= 0; v = x->nodes[v].next) {
+                GraphNode* node = &x->nodes[v];
+                if (prevprev >= 0 && !Graph_IsPinned(prevprev, x))
+                    node->slot = x->nodes[prevprev].slot;
+                else
+                    node->slot = BufferArena_Acquire(x->arena);
+                node->buffer = BufferArena_Get(node->slot, x->arena);
+                prevprev = prev;
+                prev = v;
+            }
+        }
+        return;
+    }
+
+    /// Sequential rendering: every buffer lives from its node to its last reader. Nobody reads a dead output, so its
+    /// slot is free again right after the node itself.
+    for (int i = 0; i < x->orderLength; i++)
+        x->lastUse[x->order[i]] = i;
+    for (int i = 0; i < x->orderLength; i++) {
+        GraphNode* node = &x->nodes[x->order[i]];
+        for (int k = 0; k < GRAPH_MAXINPUTS; k++) {
+            if (node->inputs[k] >= 0 && !node->feedback[k])
+                x->lastUse[node->inputs[k]] = i;
+        }
+    }
+    for (int i = 0; i < x->orderLength; i++) {
+        int v = x->order[i];
+        GraphNode* node = &x->nodes[v];
+        node->slot = BufferArena_Acquire(x->arena);
+        node->buffer = BufferArena_Get(node->slot, x->arena);
+        for (int k = 0; k < GRAPH_MAXINPUTS; k++) {
+            int src = node->inputs[k];
+            if (src < 0 || node->feedback[k] || x->lastUse[src] != i || Graph_IsPinned(src, x))
+                continue;
+            BufferArena_Release(x->nodes[src].slot, x->arena);
+            x->lastUse[src] = -1; // in case src is connected to several inlets
+        }
+        if (x->lastUse[v] == i && !Graph_IsPinned(v, x))
+            BufferArena_Release(node->slot, x->arena);
+    }
+}
+
+/// Kahn's algorithm over the active nodes. If no node without unresolved inlets is left, we are inside a cycle; we
+/// then schedule the node with the fewest unresolved inlets, which makes those inlets read the previous block.
+static void Graph_Sort(Graph* x) {
+    int maxNodes = x->maxNodes;
+    int numActive = 0;
+
+    /// 1. Count in-degrees and successors
+    memset(x->indegree, 0, maxNodes * sizeof(int));
+    memset(x->succStart, 0, (maxNodes + 1) * sizeof(int));
+    for (int i = 0; i < maxNodes; i++) {
+        GraphNode* node = &x->nodes[i];
+        if (!node->active)
+            continue;
+        numActive++;
+        for (int k = 0; k < GRAPH_MAXINPUTS; k++) {
+            int src = node->inputs[k];
+            if (src < 0)
+                continue;
+            x->indegree[i]++;
+            x->succStart[src + 1]++;
+        }
+    }
+
+    /// 2. Store successor lists in compressed form: successors of node i are succ[succStart[i]..succStart[i+1])
+    for (int i = 0; i < maxNodes; i++)
+        x->succStart[i + 1] += x->succStart[i];
+    for (int i = 0; i < maxNodes; i++)
+        x->queue[i] = x->succStart[i]; // used as fill pointers for now
+    for (int i = 0; i < maxNodes; i++) {
+        GraphNode* node = &x->nodes[i];
+        if (!node->active)
+            continue;
+        for (int k = 0; k < GRAPH_MAXINPUTS; k++) {
+            int src = node->inputs[k];
+            if (src >= 0)
+                x->succ[x->queue[src]++] = i;
+        }
+    }
+
+    /// 3. Emit nodes in dependency order; order[] doubles as the queue
+    int head = 0, tail = 0;
+    for (int i = 0; i < maxNodes; i++) {
+        if (x->nodes[i].active && x->indegree[i] == 0)
+            x->order[tail++] = i;
+    }
+    while (tail < numActive) {
+        if (head == tail) {
+            /// Cycle: break it at the node with the fewest unresolved inlets
+            int best = -1;
+            for (int i = 0; i < maxNodes; i++) {
+                if (x->nodes[i].active && x->indegree[i] > 0 && (best < 0 || x->indegree[i] < x->indegree[best]))
+                    best = i;
+            }
+            x->indegree[best] = 0;
+            x->order[tail++] = best;
+        }
+        int node = x->order[head++];
+        for (int s = x->succStart[node]; s < x->succStart[node + 1]; s++) {
+            int next = x->succ[s];
+            if (x->indegree[next] > 0 && --x->indegree[next] == 0)
+                x->order[tail++] = next;
+        }
+    }
+
+    x->orderLength = numActive;
+    Graph_BuildTasks(x);
+    Graph_AssignBuffers(x);
+    x->dirty = false;
+}
+
+/* Processing */
+
+static void Graph_RenderNode(int v, int thread, Graph* x) {
+    GraphNode* node = &x->nodes[v];
+    float* inputs[GRAPH_MAXINPUTS];
+    int tags[GRAPH_MAXINPUTS];
+    float values[GRAPH_MAXINPUTS];
+    for (int k = 0; k < GRAPH_MAXINPUTS; k++) {
+        int src = node->inputs[k];
+        values[k] = 0;
+        if (src < 0) {
+            inputs[k] = NULL;
+            tags[k] = SIGNAL_SILENT;
+        } else if (node->feedback[k]) {
+            inputs[k] = x->nodes[src].previous;
+            tags[k] = SIGNAL_AUDIO;
+        } else {
+            inputs[k] = x->nodes[src].buffer;
+            tags[k] = x->nodes[src].tag;
+            values[k] = x->nodes[src].value;
+        }
+    }
+    Graph_ProcessNode(node, inputs, tags, values, x->blockLength, x->blockChannels, x->scratch[thread]);
+}
+
+static void Graph_RunTask(int task, int thread, void* context) {
+    Graph* x = (Graph*) context;
+    for (int v = x->taskHead[task]; v >= 0; v = x->nodes[v].next)
+        Graph_RenderNode(v, thread, x);
+}
+
+OSL_API void Graph_Process(float buffer[], int n, int channels, Graph* x) {
+    assert(n <= x->maxLength);
+    if (n > x->maxLength)
+        n = x->maxLength;
+
+    if (x->dirty)
+        Graph_Sort(x);
+
+    x->blockLength = n;
+    x->blockChannels = channels;
+
+    if (x->parallel) {
+        Scheduler_Run(&x->job, x->scheduler);
+    } else {
+        for (int i = 0; i < x->orderLength; i++)
+            Graph_RenderNode(x->order[i], 0, x);
+    }
+
+    /// Node buffers don't survive the block, so feedback inlets read a copy
+    for (int i = 0; i < x->orderLength; i++) {
+        GraphNode* node = &x->nodes[x->order[i]];
+        if (node->isFeedbackSource)
+            _fCopy(node->buffer, node->previous, n);
+    }
+
+    if (x->output >= 0 && x->nodes[x->output].active)
+        _fCopy(x->nodes[x->output].buffer, buffer, n);
+    else
+        _fZero(buffer, n);
+}
+
+/* Building the patch */
+
+static int Graph_Insert(int type, GraphProcessFunc process, void* state, Graph* x) {
+    for (int i = 0; i < x->maxNodes; i++) {
+        GraphNode* node = &x->nodes[i];
+        if (node->active)
+            continue;
+        node->type = type;
+        node->process = process;
+        node->state = state;
+        for (int k = 0; k < GRAPH_MAXINPUTS; k++)
+            node->inputs[k] = -1;
+        _fZero(node->previous, x->maxLength);
+        node->active = 1;
+        x->dirty = true;
+        return i;
+    }
+    printv("Graph is full, cannot add more than %d nodes\n", x->maxNodes);
+    return -1;
+}
+
+OSL_API int Graph_AddNode(int type, void* state, Graph* x) {
+    if (type == GRAPHNODE_EXTERNAL || (type != GRAPHNODE_MIX && state == NULL))
+        return -1;
+    return Graph_Insert(type, NULL, state, x);
+}
+
+OSL_API int Graph_AddExternalNode(GraphProcessFunc process, void* state, Graph* x) {
+    if (process == NULL)
+        return -1;
+    return Graph_Insert(GRAPHNODE_EXTERNAL, process, state, x);
+}
+
+OSL_API void Graph_RemoveNode(int node, Graph* x) {
+    if (node < 0 || node >= x->maxNodes)
+        return;
+    x->nodes[node].active = 0;
+    x->nodes[node].state = NULL;
+    for (int i = 0; i < x->maxNodes; i++) {
+        for (int k = 0; k < GRAPH_MAXINPUTS; k++) {
+            if (x->nodes[i].inputs[k] == node)
+                x->nodes[i].inputs[k] = -1;
+        }
+    }
+    if (x->output == node)
+        x->output = -1;
+    x->dirty = true;
+}
+
+OSL_API void Graph_Connect(int src, int dst, int inlet, Graph* x) {
+    if (src < 0 || src >= x->maxNodes || dst < 0 || dst >= x->maxNodes || inlet < 0 || inlet >= GRAPH_MAXINPUTS)
+        return;
+    if (!x->nodes[src].active || !x->nodes[dst].active)
+        return;
+    x->nodes[dst].inputs[inlet] = src;
+    x->dirty = true;
+}
+
+OSL_API void Graph_Disconnect(int dst, int inlet, Graph* x) {
+    if (dst < 0 || dst >= x->maxNodes || inlet < 0 || inlet >= GRAPH_MAXINPUTS)
+        return;
+    x->nodes[dst].inputs[inlet] = -1;
+    x->dirty = true;
+}
+
+OSL_API void Graph_SetOutput(int node, Graph* x) {
+    x->output = (node >= 0 && node < x->maxNodes) ? node : -1;
+    x->dirty = true; // the output buffer must not be reused within the block
+}
+
+OSL_API void Graph_Clear(Graph* x) {
+    for (int i = 0; i < x->maxNodes; i++) {
+        x->nodes[i].active = 0;
+        x->nodes[i].state = NULL;
+    }
+    x->output = -1;
+    x->orderLength = 0;
+    x->dirty = true;
+}
+
+/* Multi-core processing */
+
+OSL_API void Graph_SetThreads(int numThreads, Graph* x) {
+    if (numThreads < 1)
+        numThreads = 1;
+    if (numThreads == x->numThreads)
+        return;
+
+    if (x->scheduler) {
+        Scheduler_Free(x->scheduler);
+        x->scheduler = NULL;
+    }
+    for (int i = 1; i < x->numThreads; i++)
+        _free(x->scratch[i]);
+    _free(x->scratch);
+
+    x->scratch = (float**) _malloc(numThreads * sizeof(float*));
+    x->scratch[0] = x->scratch0;
+    for (int i = 1; i < numThreads; i++)
+        x->scratch[i] = (float*) _malloc(x->maxLength * sizeof(float));
+    x->numThreads = numThreads;
+
+    if (numThreads > 1)
+        x->scheduler = Scheduler_New(numThreads, x->maxNodes);
+    x->parallel = false;
+    x->dirty = true;
+}
+
+/* Allocating and freeing */
+
+OSL_API Graph* Graph_New(int maxNodes, int maxLength) {
+    Graph* x = (Graph*) _malloc(sizeof(Graph));
+    x->maxNodes = maxNodes;
+    x->maxLength = maxLength;
+    x->nodes = (GraphNode*) _malloc(maxNodes * sizeof(GraphNode));
+    for (int i = 0; i < maxNodes; i++) {
+        x->nodes[i].active = 0;
+        x->nodes[i].state = NULL;
+        x->nodes[i].buffer = NULL;
+        x->nodes[i].slot = -1;
+        x->nodes[i].previous = (float*) _malloc(maxLength * sizeof(float));
+        _fZero(x->nodes[i].previous, maxLength);
+    }
+    x->order = (int*) _malloc(maxNodes * sizeof(int));
+    x->indegree = (int*) _malloc(maxNodes * sizeof(int));
+    x->queue = (int*) _malloc(maxNodes * sizeof(int));
+    x->succStart = (int*) _malloc((maxNodes + 1) * sizeof(int));
+    x->succ = (int*) _malloc(maxNodes * GRAPH_MAXINPUTS * sizeof(int));
+    x->pos = (int*) _malloc(maxNodes * sizeof(int));
+    x->arena = BufferArena_New(maxNodes, maxLength);
+    x->lastUse = (int*) _malloc(maxNodes * sizeof(int));
+    x->taskHead = (int*) _malloc(maxNodes * sizeof(int));
+    x->taskDeps = (int*) _malloc(maxNodes * sizeof(int));
+    x->taskSuccStart = (int*) _malloc((maxNodes + 1) * sizeof(int));
+    x->taskSucc = (int*) _malloc(maxNodes * GRAPH_MAXINPUTS * sizeof(int));
+    x->taskMainOnly = (bool*) _malloc(maxNodes * sizeof(bool));
+    x->nodeTask = (int*) _malloc(maxNodes * sizeof(int));
+    x->numTasks = 0;
+    x->scheduler = NULL;
+    x->job.func = Graph_RunTask;
+    x->job.context = x;
+    x->job.numTasks = 0;
+    x->numThreads = 1;
+    x->parallel = false;
+    x->scratch0 = (float*) _malloc(maxLength * sizeof(float));
+    x->scratch = (float**) _malloc(sizeof(float*));
+    x->scratch[0] = x->scratch0;
+    x->blockLength = 0;
+    x->blockChannels = 2;
+    x->output = -1;
+    x->orderLength = 0;
+    x->dirty = true;
+    return x;
+}
+
+OSL_API void Graph_Free(Graph* x) {
+    Graph_SetThreads(1, x);
+    for (int i = 0; i < x->maxNodes; i++)
+        _free(x->nodes[i].previous);
+    _free(x->nodes);
+    _free(x->order);
+    _free(x->indegree);
+    _free(x->queue);
+    _free(x->succStart);
+    _free(x->succ);
+    _free(x->pos);
+    BufferArena_Free(x->arena);
+    _free(x->lastUse);
+    _free(x->taskHead);
+    _free(x->taskDeps);
+    _free(x->taskSuccStart);
+    _free(x->taskSucc);
+    _free(x->taskMainOnly);
+    _free(x->nodeTask);
+    _free(x->scratch0);
+    _free(x->scratch);
+    _free(x);
+}
@@ -0,0 +1,178 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// A node/edge audio graph that renders a whole patch with one call.
+///
+/// Each node owns one interleaved output buffer and has up to GRAPH_MAXINPUTS inlets. An inlet is either unconnected or
+/// connected to the output buffer of another node. Whenever the patch changes, the graph is sorted
+/// topologically before the next block is rendered; after that, Graph_Process() simply walks the sorted node list.
+///
+/// Feedback loops are allowed. If the sort runs into a cycle, the node with the fewest unresolved inlets is scheduled
+/// first, and its unresolved inlets read the output of the previous block (one block of delay, just like the
+/// recursion check in signalGenerator.cs).
+///
+/// Nodes are either built-in kernels that wrap an existing native instance (e.g. a DelayData* from Delay_New), or
+/// external nodes that call a GraphProcessFunc. Node state is never owned by the graph: the caller creates and frees
+/// it as before and only hands a pointer to the graph.
+///
+/// Graph_Process() does not allocate. All node buffers and scratch memory are allocated in Graph_New() and
+/// Graph_SetThreads().
+///
+/// Node buffers are taken from a BufferArena whenever the graph is sorted. Like a register allocator, the sort looks at
+/// the last node that reads each buffer and hands the slot to a later node once that reader is done, so a long patch
+/// only touches a few cache-resident buffers instead of one per node. The output node and the sources of feedback
+/// inlets keep their own slot for the whole block.
+///
+/// Every node output carries a tag from Signal.h. Mix nodes use the tags of their inlets to skip silent inputs and to
+/// add constant inputs as scalars; the output of an external node is classified after it has been rendered.
+///
+/// With Graph_SetThreads(), independent branches of the patch are rendered in parallel. The sorted graph is cut into
+/// chains (runs of nodes where each one only feeds the next), and the chains are executed as tasks by a Scheduler.
+/// Feedback inlets read a copy of their source that is taken before the block starts, so no task ever reads a buffer
+/// that is being written. External nodes always run on the thread that calls Graph_Process(), because they usually
+/// call back into managed code.
+///
+/// All functions are not thread-safe, hence the caller must avoid simultaneous access from multiple threads.
+
+#ifndef Graph_h
+#define Graph_h
+
+#include "main.h"
+#include "Scheduler.h"
+#include "BufferArena.h"
+
+#define GRAPH_MAXINPUTS 8
+
+#define GRAPHNODE_EXTERNAL 0   // calls a GraphProcessFunc
+#define GRAPHNODE_MIX 1        // sums all connected inlets
+#define GRAPHNODE_DELAY 2      // state: DelayData*, inlet 0: audio, inlet 1: time modulation (optional)
+#define GRAPHNODE_FREEVERB 3   // state: freeverb::ReverbModel*, inlet 0: audio
+#define GRAPHNODE_COMPRESSOR 4 // state: CompressorData*, inlet 0: audio, inlet 1: sidechain (optional)
+
+/// Processing callback of an external node. Renders n interleaved samples into out. inputs[i] is NULL if inlet i is
+/// not connected. The input buffers belong to other nodes and must not be written to. out is shared with other nodes,
+/// so it does not contain the previous block.
+typedef void (*GraphProcessFunc)(float* out, float** inputs, int numInputs, int n, int channels, void* state);
+
+struct GraphNode {
+    int type;
+    int active;
+    GraphProcessFunc process;
+    void* state;
+    int inputs[GRAPH_MAXINPUTS];   // source node index per inlet, -1 if not connected
+    bool feedback[GRAPH_MAXINPUTS]; // inlet reads the previous block of its source
+    float* buffer;                  // output of the current block, only valid until its last reader has run
+    int slot;                       // arena slot of buffer
+    int tag;                        // SIGNAL_AUDIO, SIGNAL_CONSTANT or SIGNAL_SILENT, see Signal.h
+    float value;                    // value of every sample if tag is not SIGNAL_AUDIO
+    float* previous;                // copy of buffer from the previous block, read by feedback inlets
+    bool isFeedbackSource;
+    int next; // next node in the same chain, -1 at the end
+};
+
+struct Graph {
+    // public
+    int output; // index of the node that is copied to the host buffer, -1 for silence
+
+    // internal
+    GraphNode* nodes;
+    int maxNodes;
+    int maxLength; // maximum number of interleaved samples per block
+    int* order;    // node indices in processing order
+    int orderLength;
+    bool dirty; // set by every topology change, cleared by the sort
+    int* indegree;
+    int* succStart; // successor lists in compressed form, used by the sort
+    int* succ;
+    int* queue;
+    int* pos; // position of each node in order
+    BufferArena* arena;
+    int* lastUse; // position of the last node that reads each buffer
+
+    // parallel processing, see Graph_SetThreads()
+    int numThreads;
+    bool parallel; // the current sort is rendered by the scheduler
+    Scheduler* scheduler;
+    SchedulerJob job;
+    int numTasks;
+    int* taskHead; // first node of each chain
+    int* taskDeps;
+    int* taskSuccStart;
+    int* taskSucc;
+    bool* taskMainOnly;
+    int* nodeTask;
+    int blockLength;
+    int blockChannels;
+    float** scratch; // one per thread
+    float* scratch0; // scratch of the calling thread
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Processing audio */
+
+/// Renders 1 block of n interleaved samples and writes the output node into buffer. Re-sorts the graph first if the
+/// topology changed since the last call.
+OSL_API void Graph_Process(float buffer[], int n, int channels, Graph* x);
+
+/* Building the patch */
+
+/// Adds a built-in node of the given type that operates on state. Returns the node index, or -1 if the graph is full.
+OSL_API int Graph_AddNode(int type, void* state, Graph* x);
+/// Adds an external node that calls process with state. Returns the node index, or -1 if the graph is full.
+OSL_API int Graph_AddExternalNode(GraphProcessFunc process, void* state, Graph* x);
+/// Removes a node and disconnects everything that was connected to its output.
+OSL_API void Graph_RemoveNode(int node, Graph* x);
+/// Connects the output of node src to inlet of node dst. Replaces an existing connection on that inlet.
+OSL_API void Graph_Connect(int src, int dst, int inlet, Graph* x);
+/// Disconnects inlet of node dst.
+OSL_API void Graph_Disconnect(int dst, int inlet, Graph* x);
+/// Selects the node that is written to the host buffer by Graph_Process().
+OSL_API void Graph_SetOutput(int node, Graph* x);
+/// Removes all nodes.
+OSL_API void Graph_Clear(Graph* x);
+
+/* Multi-core processing */
+
+/// Renders independent branches on numThreads threads (including the calling thread). 1 disables parallel processing.
+/// Starts and stops worker threads, so never call this from the audio thread.
+OSL_API void Graph_SetThreads(int numThreads, Graph* x);
+
+/* Allocating and freeing */
+
+/// Allocates a graph for up to maxNodes nodes and blocks of up to maxLength interleaved samples.
+OSL_API Graph* Graph_New(int maxNodes, int maxLength);
+/// Releases all resources of the graph. Node states are not freed.
+OSL_API void Graph_Free(Graph* x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* Graph_h */
@@ -0,0 +1,145 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Noise.h"
+#include "util.h"
+#include <string.h>
+
+#define NOISE_MULTIPLIER 6364136223846793005ULL // the 64 bit LCG multiplier of pcg32
+
+/// pcg32 output function (XSH RR) of the state before the update.
+static inline uint32_t Noise_Output(uint64_t state) {
+    uint32_t xorshifted = (uint32_t) (((state >> 18u) ^ state) >> 27u);
+    uint32_t rot = (uint32_t) (state >> 59u);
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+/// 32 random bits to a float in [-1, 1): a float in [2, 4) with the upper 23 bits as mantissa, minus 3.
+static inline float Noise_ToFloat(uint32_t bits) {
+    uint32_t i = 0x40000000u | (bits >> 9);
+    float f;
+    memcpy(&f, &i, sizeof(f));
+    return f - 3.f;
+}
+
+/// Advances an LCG state by delta steps in O(log delta), see Brown, "Random Number Generation with Arbitrary Stride".
+static uint64_t Noise_Advance(uint64_t state, uint64_t delta, uint64_t increment) {
+    uint64_t multiplier = NOISE_MULTIPLIER;
+    uint64_t accMultiplier = 1, accIncrement = 0;
+    while (delta > 0) {
+        if (delta & 1) {
+            accMultiplier *= multiplier;
+            accIncrement = accIncrement * multiplier + increment;
+        }
+        increment = (multiplier + 1) * increment;
+        multiplier *= multiplier;
+        delta >>= 1;
+    }
+    return accMultiplier * state + accIncrement;
+}
+
+/// Renders groups of NOISE_LANES samples, one per lane. The position must be a multiple of NOISE_LANES. The states
+/// are kept in a local array, so that the lanes of one group are independent statements the compiler can put into
+/// SIMD lanes.
+static void Noise_Render(float* __restrict dest, int groups, uint64_t* __restrict state,
+                         const uint64_t* __restrict increment) {
+    uint64_t s[NOISE_LANES];
+    for (int l = 0; l < NOISE_LANES; l++)
+        s[l] = state[l];
+    for (int g = 0; g < groups; g++) {
+        for (int l = 0; l < NOISE_LANES; l++) {
+            uint64_t old = s[l];
+            s[l] = old * NOISE_MULTIPLIER + increment[l];
+            dest[g * NOISE_LANES + l] = Noise_ToFloat(Noise_Output(old));
+        }
+    }
+    for (int l = 0; l < NOISE_LANES; l++)
+        state[l] = s[l];
+}
+
+/* Processing audio */
+
+OSL_API float Noise_Next(Noise* x) {
+    int l = (int) (x->position % NOISE_LANES);
+    uint64_t old = x->state[l];
+    x->state[l] = old * NOISE_MULTIPLIER + x->increment[l];
+    x->position++;
+    return Noise_ToFloat(Noise_Output(old));
+}
+
+OSL_API void Noise_Process(float dest[], int n, Noise* x) {
+    int i = 0;
+    for (; i < n && x->position % NOISE_LANES != 0; i++)
+        dest[i] = Noise_Next(x);
+
+    int groups = (n - i) / NOISE_LANES;
+    Noise_Render(dest + i, groups, x->state, x->increment);
+    x->position += (uint64_t) groups * NOISE_LANES;
+    i += groups * NOISE_LANES;
+
+    for (; i < n; i++)
+        dest[i] = Noise_Next(x);
+}
+
+/* Setting and getting parameters */
+
+OSL_API void Noise_Seed(uint64_t seed, Noise* x) {
+    /// the seeding of pcg32(seed, lane)
+    for (int l = 0; l < NOISE_LANES; l++) {
+        uint64_t increment = ((uint64_t) l << 1u) | 1u;
+        uint64_t state = (increment + seed) * NOISE_MULTIPLIER + increment; // a step from 0, adding seed, a step
+        x->increment[l] = increment;
+        x->origin[l] = x->state[l] = state;
+    }
+    x->seed = seed;
+    x->position = 0;
+}
+
+OSL_API void Noise_Seek(uint64_t position, Noise* x) {
+    /// lane l has produced the samples l, l + NOISE_LANES, ... below position
+    for (int l = 0; l < NOISE_LANES; l++) {
+        uint64_t steps = (position + NOISE_LANES - 1 - l) / NOISE_LANES;
+        x->state[l] = Noise_Advance(x->origin[l], steps, x->increment[l]);
+    }
+    x->position = position;
+}
+
+OSL_API uint64_t Noise_GetPosition(Noise* x) {
+    return x->position;
+}
+
+/* Allocating and freeing */
+
+OSL_API Noise* Noise_New(uint64_t seed) {
+    Noise* x = (Noise*) _malloc(sizeof(Noise));
+    Noise_Seed(seed, x);
+    return x;
+}
+
+OSL_API void Noise_Free(Noise* x) {
+    _free(x);
+}
@@ -0,0 +1,83 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// White noise from several interleaved PCG streams.
+///
+/// A single pcg32 is a serial chain: every sample depends on the state update of the previous one. Here, NOISE_LANES
+/// independent pcg32 streams (same seed, different stream selectors) produce consecutive samples in turn, so sample i
+/// comes from lane i % NOISE_LANES. The lanes have no dependencies between each other, so the compiler can keep them
+/// in SIMD lanes or at least in flight at the same time. The 32 output bits become a float in [-1, 1) by placing the
+/// upper 23 bits in the mantissa of a float in [2, 4) and subtracting 3, instead of a division.
+///
+/// The sequence is fully determined by the seed and the sample index: Noise_Seek() jumps to any index with the LCG
+/// jump-ahead, in O(log n), so network clients can resynchronise and stay bit-exact.
+///
+/// Noise_New() and Noise_Free() must not be called from the audio thread. All other functions are not thread-safe,
+/// hence the caller must avoid simultaneous access from multiple threads.
+
+#ifndef Noise_h
+#define Noise_h
+
+#include "main.h"
+#include <stdint.h>
+
+#define NOISE_LANES 8
+
+struct Noise {
+    uint64_t state[NOISE_LANES];
+    uint64_t increment[NOISE_LANES]; // stream selector, odd
+    uint64_t origin[NOISE_LANES];    // state after seeding, for seeking
+    uint64_t seed;
+    uint64_t position; // index of the next sample
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Writes the next n samples in [-1, 1) to dest.
+OSL_API void Noise_Process(float dest[], int n, Noise* x);
+/// Returns the next sample in [-1, 1).
+OSL_API float Noise_Next(Noise* x);
+
+/// Restarts all streams from the given seed, at sample index 0.
+OSL_API void Noise_Seed(uint64_t seed, Noise* x);
+/// Jumps to the given sample index, forwards or backwards, in O(log position).
+OSL_API void Noise_Seek(uint64_t position, Noise* x);
+/// Returns the index of the next sample.
+OSL_API uint64_t Noise_GetPosition(Noise* x);
+
+/// Allocates and returns a new noise generator at sample index 0 of the given seed.
+OSL_API Noise* Noise_New(uint64_t seed);
+/// Releases allocated resources.
+OSL_API void Noise_Free(Noise* x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* Noise_h */
@@ -0,0 +1,410 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Oscillator.h"
+#include "Signal.h"
+#include "Wavetable.h"
+#include "util.h"
+#include <math.h>
+#include <stdint.h>
+#include <utility>
+
+#define OSCILLATOR_MAXDT 0.5f // the residuals of neighbouring edges would overlap above this
+
+/// Residual of a downward step of 2 at phase 0, spread over one sample on each side.
+static inline float polyBlep(float t, float dt) {
+    if (t < dt) {
+        float x = t / dt;
+        return x + x - x * x - 1.f;
+    } else if (t > 1.f - dt) {
+        float x = (t - 1.f) / dt;
+        return x * x + x + x + 1.f;
+    }
+    return 0.f;
+}
+
+/// Residual of a slope change of 2 per unit phase at phase 0 (integrated polyBlep), in units of dt.
+static inline float polyBlamp(float t, float dt) {
+    if (t < dt) {
+        float x = t / dt - 1.f;
+        return -1.f / 3.f * x * x * x;
+    } else if (t > 1.f - dt) {
+        float x = (t - 1.f) / dt + 1.f;
+        return 1.f / 3.f * x * x * x;
+    }
+    return 0.f;
+}
+
+static inline float wrap(float t) {
+    return t - floorf(t);
+}
+
+/// Naive waveform, only used to measure the jump at a sync reset.
+static float naiveWave(int waveMode, float t, float width) {
+    switch (waveMode) {
+    case 0:
+        return Wavetable_Sine(t);
+    case 1:
+        return t >= width ? 1.f : -1.f;
+    case 2:
+        return t * 2 - 1;
+    default:
+        return t <= 0.5f ? t * 4 - 1 : 3 - t * 4;
+    }
+}
+
+/* Naive oscillator */
+
+/// Everything that is constant during a block. The ramps replace lerp(prev, cur, i / length) and already contain all
+/// control inputs that turned out to be constant, so those don't need a kernel of their own.
+struct OscillatorArgs {
+    float* buffer;
+    int length;
+    int channels;
+    uint32_t phase; // 0..2^32 is one period
+    float freqStart, freqEnd;
+    float freqOffset; // constant lin fm, which has to be added after an audio-rate exp fm
+    float ampStart, ampEnd;
+    uint32_t width; // pulse width if there is no pwm input
+    float* freqExpBuffer;
+    float* freqLinBuffer;
+    float* ampBuffer;
+    float* syncBuffer;
+    float* pwmBuffer;
+    float prevSyncValue;
+    float phaseScale; // Hz to phase increment
+};
+
+#define OSCILLATOR_FREQEXP 1
+#define OSCILLATOR_FREQLIN 2
+#define OSCILLATOR_AMP 4
+#define OSCILLATOR_SYNC 8
+#define OSCILLATOR_PWM 16
+#define OSCILLATOR_SILENT -1 // only advances the phase
+
+static inline float phaseToFloat(uint32_t phase) {
+    return phase * (1.f / 4294967296.f);
+}
+
+/// Pulse width from a pwm value in -1..1. Saturates, as a full width of 2^32 would wrap to 0.
+static inline uint32_t pwmToWidth(float pwm) {
+    uint64_t width = (uint64_t) (_clamp((pwm + 1) / 2.f, 0.f, 1.f) * 4294967296.f);
+    return width > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t) width;
+}
+
+/// One kernel per wave shape and combination of audio-rate inputs. Everything that is switched off is removed at
+/// compile time, so the unmodulated kernels are branch-free loops.
+template <int Wave, int Flags> static void Oscillator_Kernel(OscillatorArgs& a) {
+    constexpr bool FreqExp = Flags & OSCILLATOR_FREQEXP;
+    constexpr bool FreqLin = Flags & OSCILLATOR_FREQLIN;
+    constexpr bool Amp = Flags & OSCILLATOR_AMP;
+    constexpr bool Sync = Flags & OSCILLATOR_SYNC;
+    constexpr bool Pwm = Flags & OSCILLATOR_PWM;
+
+    float* buffer = a.buffer;
+    uint32_t phase = a.phase;
+    float freqSlope = (a.freqEnd - a.freqStart) / a.length;
+    float ampSlope = (a.ampEnd - a.ampStart) / a.length;
+
+    for (int i = 0; i < a.length; i += a.channels) {
+        if constexpr (Sync) {
+            if (a.syncBuffer[i] > 0.f && a.prevSyncValue <= 0.f)
+                phase = 0;
+            a.prevSyncValue = a.syncBuffer[i];
+        }
+
+        float v;
+        if constexpr (Wave == OSCILLATOR_SILENT) {
+            v = 0.f;
+        } else if constexpr (Wave == 0) { // sine
+            v = Wavetable_Sine(phaseToFloat(phase));
+        } else if constexpr (Wave == 1) { // square
+            uint32_t width = a.width;
+            if constexpr (Pwm)
+                width = pwmToWidth(a.pwmBuffer[i]);
+            v = phase >= width ? 1.f : -1.f;
+        } else if constexpr (Wave == 2) { // saw
+            v = phaseToFloat(phase) * 2 - 1;
+        } else { // tri
+            v = 1 - 4 * fabsf(phaseToFloat(phase) - 0.5f);
+        }
+
+        float frequency = a.freqStart + i * freqSlope; // slope limiting
+        float amplitude = a.ampStart + i * ampSlope;
+        if constexpr (FreqExp) { // convert 0.1V/Oct to 1V/Oct; this has to be clamped, think 2^320
+            frequency *= powf(2, _clamp(a.freqExpBuffer[i], -1.f, 1.f) * 10.f);
+            frequency += a.freqOffset;
+        }
+        if constexpr (FreqLin)
+            frequency += a.freqLinBuffer[i] * 8000.f; // add lin fm, thru zero, 1V / 100Hz
+        if constexpr (Amp)
+            amplitude *= a.ampBuffer[i]; // allows for negative inputs, will invert phase then
+
+        /// clamp to +/- 24kHz; the unsigned overflow wraps the phase in both directions
+        frequency = fminf(fmaxf(frequency, -24000.f), 24000.f);
+        phase += (uint32_t) (int64_t) (frequency * a.phaseScale);
+
+        if constexpr (Wave != OSCILLATOR_SILENT)
+            buffer[i] = buffer[i + 1] = v * amplitude;
+    }
+
+    a.phase = phase;
+}
+
+typedef void (*OscillatorKernelFunc)(OscillatorArgs& a);
+
+template <int Wave, size_t... Flags>
+static OscillatorKernelFunc Oscillator_GetKernel(int flags, std::index_sequence<Flags...>) {
+    static const OscillatorKernelFunc kernels[] = {Oscillator_Kernel<Wave, (int) Flags>...};
+    return kernels[flags];
+}
+
+OSL_API void OscillatorSignalGenerator(float buffer[], int length, int channels, double& _phase, float analogWave,
+                                       float frequency, float prevFrequency, float amplitude, float prevAmplitude,
+                                       float& prevSyncValue, float frequencyExpBuffer[], float frequencyLinBuffer[],
+                                       float amplitudeBuffer[], float syncBuffer[], float pwmBuffer[], bool bFreqExpGen,
+                                       bool bFreqLinGen, bool bAmpGen, bool bSyncGen, bool bPwmGen,
+                                       double _sampleDuration, double& dspTime) {
+    OscillatorArgs a;
+    a.buffer = buffer;
+    a.length = length;
+    a.channels = channels;
+    a.phase = (uint32_t) (int64_t) (_phase * 4294967296.0);
+    a.freqStart = prevFrequency;
+    a.freqEnd = frequency;
+    a.freqOffset = 0;
+    a.ampStart = prevAmplitude;
+    a.ampEnd = amplitude;
+    a.width = 1u << 31;
+    a.freqExpBuffer = frequencyExpBuffer;
+    a.freqLinBuffer = frequencyLinBuffer;
+    a.ampBuffer = amplitudeBuffer;
+    a.syncBuffer = syncBuffer;
+    a.pwmBuffer = pwmBuffer;
+    a.prevSyncValue = prevSyncValue;
+    a.phaseScale = (float) (4294967296.0 * _sampleDuration);
+
+    /// Constant control inputs are folded into the ramps, so they select the same kernel as unplugged ones
+    int flags = 0;
+    float value;
+    if (bFreqExpGen) {
+        if (Signal_Classify(frequencyExpBuffer, length, &value) == SIGNAL_AUDIO) {
+            flags |= OSCILLATOR_FREQEXP;
+        } else {
+            float factor = powf(2, _clamp(value, -1.f, 1.f) * 10.f);
+            a.freqStart *= factor;
+            a.freqEnd *= factor;
+        }
+    }
+    if (bFreqLinGen) {
+        if (Signal_Classify(frequencyLinBuffer, length, &value) == SIGNAL_AUDIO) {
+            flags |= OSCILLATOR_FREQLIN;
+        } else if (flags & OSCILLATOR_FREQEXP) {
+            a.freqOffset = value * 8000.f;
+        } else {
+            a.freqStart += value * 8000.f;
+            a.freqEnd += value * 8000.f;
+        }
+    }
+    if (bAmpGen) {
+        if (Signal_Classify(amplitudeBuffer, length, &value) == SIGNAL_AUDIO) {
+            flags |= OSCILLATOR_AMP;
+        } else {
+            a.ampStart *= value;
+            a.ampEnd *= value;
+        }
+    }
+    if (bSyncGen) {
+        if (Signal_Classify(syncBuffer, length, &value) == SIGNAL_AUDIO) {
+            flags |= OSCILLATOR_SYNC;
+        } else { // a constant can only have a rising edge at the very first sample
+            if (value > 0.f && a.prevSyncValue <= 0.f)
+                a.phase = 0;
+            a.prevSyncValue = value;
+        }
+    }
+    if (bPwmGen) {
+        if (Signal_Classify(pwmBuffer, length, &value) == SIGNAL_AUDIO)
+            flags |= OSCILLATOR_PWM;
+        else
+            a.width = pwmToWidth(value);
+    }
+
+    int waveMode = (int) roundf(analogWave * 3);
+    bool silent = !(flags & OSCILLATOR_AMP) && a.ampStart == 0 && a.ampEnd == 0;
+    if (silent)
+        _fZero(buffer, length);
+
+    auto all = std::make_index_sequence<32>();
+    OscillatorKernelFunc kernel;
+    if (silent)
+        kernel = Oscillator_GetKernel<OSCILLATOR_SILENT>(flags, all);
+    else if (waveMode == 0)
+        kernel = Oscillator_GetKernel<0>(flags, all);
+    else if (waveMode == 1)
+        kernel = Oscillator_GetKernel<1>(flags, all);
+    else if (waveMode == 2)
+        kernel = Oscillator_GetKernel<2>(flags, all);
+    else
+        kernel = Oscillator_GetKernel<3>(flags, all);
+    kernel(a);
+
+    _phase = a.phase / 4294967296.0;
+    prevSyncValue = a.prevSyncValue;
+    dspTime += (length / channels) * _sampleDuration;
+}
+
+/* Band-limited oscillator */
+
+OSL_API void OscillatorSignalGeneratorBandLimited(float buffer[], int length, int channels, double& _phase,
+                                                  float analogWave, float frequency, float prevFrequency,
+                                                  float amplitude, float prevAmplitude, float& prevSyncValue,
+                                                  float frequencyExpBuffer[], float frequencyLinBuffer[],
+                                                  float amplitudeBuffer[], float syncBuffer[], float pwmBuffer[],
+                                                  bool bFreqExpGen, bool bFreqLinGen, bool bAmpGen, bool bSyncGen,
+                                                  bool bPwmGen, double _sampleDuration, double& dspTime) {
+    int waveMode = (int) roundf(analogWave * 3);
+    int frames = length / channels;
+
+    float freqExpValue;
+    bool freqExpConst = bFreqExpGen && Signal_Classify(frequencyExpBuffer, length, &freqExpValue) != SIGNAL_AUDIO;
+    float freqExpFactor = freqExpConst ? powf(2, _clamp(freqExpValue, -1.f, 1.f) * 10.f) : 1.f;
+
+    float phases[OSCILLATOR_CHUNK];
+    float increments[OSCILLATOR_CHUNK];
+    float amps[OSCILLATOR_CHUNK];
+    float widths[OSCILLATOR_CHUNK];
+    float out[OSCILLATOR_CHUNK];
+    int syncFrames[OSCILLATOR_CHUNK];
+    float syncOffsets[OSCILLATOR_CHUNK];
+    float syncJumps[OSCILLATOR_CHUNK];
+
+    for (int chunk = 0; chunk < frames; chunk += OSCILLATOR_CHUNK) {
+        int m = frames - chunk < OSCILLATOR_CHUNK ? frames - chunk : OSCILLATOR_CHUNK;
+        int numSyncs = 0;
+
+        /// 1. Phase, increment and amplitude per frame. This is the only part with a dependency between samples.
+        for (int j = 0; j < m; j++) {
+            int i = (chunk + j) * channels;
+
+            float endFrequency = frequency;
+            if (prevFrequency != frequency)
+                endFrequency = lerp(prevFrequency, frequency, (float) i / length); // slope limiting
+            float endAmplitude = amplitude;
+            if (prevAmplitude != amplitude)
+                endAmplitude = lerp(prevAmplitude, amplitude, (float) i / length); // slope limiting
+
+            if (freqExpConst)
+                endFrequency *= freqExpFactor;
+            else if (bFreqExpGen)
+                endFrequency *= powf(2, _clamp(frequencyExpBuffer[i], -1.f, 1.f) * 10.f);
+            if (bFreqLinGen)
+                endFrequency += frequencyLinBuffer[i] * 8000.f;
+            if (bAmpGen)
+                endAmplitude *= amplitudeBuffer[i];
+
+            float dt = (float) (_clamp(endFrequency, -24000.f, 24000.f) * _sampleDuration);
+            float width = bPwmGen ? _clamp((pwmBuffer[i] + 1) / 2.f, 0.f, 1.f) : 0.5f;
+
+            /// Hard sync: the edge lies between the previous and the current sync sample. The phase restarts there,
+            /// so at the current sample it has already advanced by the remaining fraction of a sample.
+            if (bSyncGen) {
+                float s = syncBuffer[i];
+                if (s > 0.f && prevSyncValue <= 0.f) {
+                    float a = s - prevSyncValue > 0.f ? -prevSyncValue / (s - prevSyncValue) : 0.f;
+                    float before = naiveWave(waveMode, wrap((float) _phase - (1.f - a) * dt), width);
+                    _phase = wrap((1.f - a) * dt);
+                    syncFrames[numSyncs] = j;
+                    syncOffsets[numSyncs] = a;
+                    syncJumps[numSyncs] = (naiveWave(waveMode, 0.f, width) - before) * endAmplitude;
+                    numSyncs++;
+                }
+                prevSyncValue = s;
+            }
+
+            phases[j] = (float) _phase;
+            increments[j] = dt;
+            amps[j] = endAmplitude;
+            widths[j] = width;
+
+            _phase += dt;
+            _phase -= floor(_phase); // wraps both directions for through-zero fm
+            dspTime += _sampleDuration;
+        }
+
+        /// 2. Waveform with residuals, no dependencies between samples
+        switch (waveMode) {
+        case 0: // sine
+            for (int j = 0; j < m; j++)
+                out[j] = Wavetable_Sine(phases[j]);
+            break;
+        case 1: // square, falling edge at 0, rising edge at the pulse width
+            for (int j = 0; j < m; j++) {
+                float t = phases[j];
+                float dt = _min(fabsf(increments[j]), OSCILLATOR_MAXDT);
+                out[j] = (t >= widths[j] ? 1.f : -1.f) - polyBlep(t, dt) + polyBlep(wrap(t - widths[j]), dt);
+            }
+            break;
+        case 2: // saw
+            for (int j = 0; j < m; j++) {
+                float t = phases[j];
+                float dt = _min(fabsf(increments[j]), OSCILLATOR_MAXDT);
+                out[j] = t * 2 - 1 - polyBlep(t, dt);
+            }
+            break;
+        default: // triangle, corners at 0 and 0.5 with slope changes of +-8
+            for (int j = 0; j < m; j++) {
+                float t = phases[j];
+                float dt = _min(fabsf(increments[j]), OSCILLATOR_MAXDT);
+                float corners = polyBlamp(t, dt) - polyBlamp(wrap(t + 0.5f), dt);
+                out[j] = (t <= 0.5f ? t * 4 - 1 : 3 - t * 4) + 4 * dt * corners;
+            }
+            break;
+        }
+
+        /// 3. Amplitude and interleaving
+        for (int j = 0; j < m; j++) {
+            int i = (chunk + j) * channels;
+            float v = out[j] * amps[j];
+            for (int c = 0; c < channels; c++)
+                buffer[i + c] = v;
+        }
+
+        /// 4. Sync residuals. The sample before the edge may belong to the previous chunk, but not to the previous
+        /// block, which has already been sent off.
+        for (int k = 0; k < numSyncs; k++) {
+            int frame = chunk + syncFrames[k];
+            float a = syncOffsets[k];
+            float jump = syncJumps[k];
+            for (int c = 0; c < channels; c++) {
+                buffer[frame * channels + c] -= jump * a * a * 0.5f;
+                if (frame > 0)
+                    buffer[(frame - 1) * channels + c] += jump * (1.f - a) * (1.f - a) * 0.5f;
+            }
+        }
+    }
+}
@@ -0,0 +1,72 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// The oscillator kernels. OscillatorSignalGenerator() (declared in main.h) is the naive oscillator: it picks a kernel
+/// that is specialised at compile time for the wave shape and the combination of connected audio-rate inputs, so the
+/// unmodulated case runs a loop without any per-sample branches. Inputs that are tagged constant are folded into the
+/// frequency and amplitude ramps instead of being read per sample. The phase is a 32 bit fixed-point accumulator that
+/// wraps by overflow; it is converted from and to the managed double phase once per block.
+///
+/// OscillatorSignalGeneratorBandLimited() is the band-limited variant.
+///
+/// The naive square, saw and triangle waves have infinitely sharp edges and corners, and everything above Nyquist
+/// folds back into the audible range. Here, the naive waveforms are corrected around each discontinuity with
+/// polynomial residuals: PolyBLEP for steps (saw wrap, both square edges including the moving PWM edge) and PolyBLAMP
+/// for slope changes (the triangle corners). Hard sync resets are corrected with a BLEP that is placed at the
+/// sub-sample position of the sync edge.
+///
+/// The block is processed in chunks: the phase is advanced sample by sample first (it depends on sync and FM), and the
+/// waveform and residuals are then computed in separate loops without dependencies between samples, which the compiler
+/// can vectorise.
+///
+/// The parameters are the same as for OscillatorSignalGenerator(), so both can be used interchangeably.
+
+#ifndef Oscillator_h
+#define Oscillator_h
+
+#include "main.h"
+
+#define OSCILLATOR_CHUNK 64 // frames per chunk
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Renders 1 block of the band-limited oscillator. See OscillatorSignalGenerator() for the parameters.
+OSL_API void OscillatorSignalGeneratorBandLimited(float buffer[], int length, int channels, double& _phase,
+                                                  float analogWave, float frequency, float prevFrequency,
+                                                  float amplitude, float prevAmplitude, float& prevSyncValue,
+                                                  float frequencyExpBuffer[], float frequencyLinBuffer[],
+                                                  float amplitudeBuffer[], float syncBuffer[], float pwmBuffer[],
+                                                  bool bFreqExpGen, bool bFreqLinGen, bool bAmpGen, bool bSyncGen,
+                                                  bool bPwmGen, double _sampleDuration, double& dspTime);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* Oscillator_h */
@@ -0,0 +1,239 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "OscillatorBank.h"
+#include "util.h"
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+enum OscillatorBankParams { P_FREQUENCY, P_AMPLITUDE, P_WAVEFORM, P_PHASE, P_N };
+
+#define OSCILLATORBANK_CHUNK 64 // frames per chunk when mixing
+
+/// Sine of phase * 2 * pi. The table lookup of Wavetable_Sine() is a gather, which does not vectorise, so this is an
+/// odd polynomial on [-pi/2, pi/2] instead; the error is below 1e-6.
+static inline float OscillatorBank_Sine(uint32_t phase) {
+    float t = (int32_t) phase * (1.f / 4294967296.f); // [-0.5, 0.5)
+    float a = fabsf(t);
+    float b = 0.5f - a;
+    t = copysignf(a < b ? a : b, t); // sin(pi - x) = sin(x)
+    float p = t * 6.28318531f;
+    float p2 = p * p;
+    return p * (1.f + p2 * (-1.f / 6 + p2 * (1.f / 120 + p2 * (-1.f / 5040 + p2 * (1.f / 362880 - p2 / 39916800)))));
+}
+
+/// Computes the per-frame steps that ramp increment and amplitude to their targets over the next frames.
+static void OscillatorBank_BeginBlock(int frames, OscillatorBank* x) {
+    for (int o = 0; o < x->numOscillators; o++) {
+        x->incrementStep[o] = (int32_t) (((int64_t) x->targetIncrement[o] - x->increment[o]) / frames);
+        x->amplitudeStep[o] = (x->targetAmplitude[o] - x->amplitude[o]) / frames;
+    }
+}
+
+/// Snaps to the targets, so that rounding in the steps does not accumulate across blocks.
+static void OscillatorBank_EndBlock(OscillatorBank* x) {
+    for (int o = 0; o < x->numOscillators; o++) {
+        x->increment[o] = x->targetIncrement[o];
+        x->amplitude[o] = x->targetAmplitude[o];
+    }
+}
+
+/// Renders 1 frame of all oscillators. The state is passed as restrict parameters, so that the compiler knows that the
+/// arrays do not overlap and can vectorise across oscillators.
+static void OscillatorBank_RenderFrame(float* __restrict out, int n, uint32_t* __restrict phase,
+                                       int32_t* __restrict increment, const int32_t* __restrict incrementStep,
+                                       float* __restrict amplitude, const float* __restrict amplitudeStep,
+                                       const float* __restrict sineGain, const float* __restrict squareGain,
+                                       const float* __restrict sawGain, const float* __restrict triangleGain) {
+    for (int o = 0; o < n; o++) {
+        uint32_t p = phase[o];
+        float saw = (int32_t) (p ^ 0x80000000u) * (1.f / 2147483648.f); // 2 * phase - 1
+        float square = copysignf(1.f, saw);
+        float triangle = 1 - 2 * fabsf(saw);
+        float sine = OscillatorBank_Sine(p);
+
+        /// selecting with one-hot gains instead of a comparison keeps the loop free of branches
+        float v = sine * sineGain[o] + square * squareGain[o] + saw * sawGain[o] + triangle * triangleGain[o];
+        out[o] = v * amplitude[o];
+
+        phase[o] = p + (uint32_t) increment[o];
+        increment[o] += incrementStep[o];
+        amplitude[o] += amplitudeStep[o];
+    }
+}
+
+static void OscillatorBank_Render(float* dest, int frames, OscillatorBank* x) {
+    int n = x->numOscillators;
+    for (int i = 0; i < frames; i++) {
+        OscillatorBank_RenderFrame(dest + i * n, n, x->phase, x->increment, x->incrementStep, x->amplitude,
+                                   x->amplitudeStep, x->sineGain, x->squareGain, x->sawGain, x->triangleGain);
+    }
+}
+
+/* Processing audio */
+
+OSL_API void OscillatorBank_Process(float dest[], int n, OscillatorBank* x) {
+    if (n <= 0)
+        return;
+    OscillatorBank_BeginBlock(n, x);
+    OscillatorBank_Render(dest, n, x);
+    OscillatorBank_EndBlock(x);
+}
+
+OSL_API void OscillatorBank_Mix(float buffer[], int n, int channels, OscillatorBank* x) {
+    int frames = n / channels;
+    int numOscillators = x->numOscillators;
+    if (frames <= 0)
+        return;
+    if (numOscillators == 0) {
+        _fZero(buffer, n);
+        return;
+    }
+
+    float sum[OSCILLATORBANK_CHUNK];
+    OscillatorBank_BeginBlock(frames, x);
+    for (int chunk = 0; chunk < frames; chunk += OSCILLATORBANK_CHUNK) {
+        int m = frames - chunk < OSCILLATORBANK_CHUNK ? frames - chunk : OSCILLATORBANK_CHUNK;
+        OscillatorBank_Render(x->temp, m, x);
+
+        for (int j = 0; j < m; j++)
+            sum[j] = x->temp[j * numOscillators];
+        for (int o = 1; o < numOscillators; o++) {
+            for (int j = 0; j < m; j++)
+                sum[j] += x->temp[j * numOscillators + o];
+        }
+
+        for (int j = 0; j < m; j++) {
+            for (int c = 0; c < channels; c++)
+                buffer[(chunk + j) * channels + c] = sum[j];
+        }
+    }
+    OscillatorBank_EndBlock(x);
+}
+
+/* Setting and getting parameters */
+
+OSL_API void OscillatorBank_SetParam(float value, int param, int index, OscillatorBank* x) {
+    assert(param < P_N);
+    if (index < 0 || index >= x->maxOscillators)
+        return;
+
+    switch (param) {
+    case P_FREQUENCY: {
+        /// clamp to just below Nyquist, so that the increment fits into a signed 32 bit integer
+        double increment = value / x->sampleRate * 4294967296.0;
+        if (increment > 2147483647.0)
+            increment = 2147483647.0;
+        else if (increment < -2147483647.0)
+            increment = -2147483647.0;
+        x->targetIncrement[index] = (int32_t) increment;
+        break;
+    }
+    case P_AMPLITUDE:
+        x->targetAmplitude[index] = value;
+        break;
+    case P_WAVEFORM: {
+        int waveform = (int) _clamp(roundf(value), OSCILLATORBANK_SINE, OSCILLATORBANK_TRIANGLE);
+        x->sineGain[index] = waveform == OSCILLATORBANK_SINE;
+        x->squareGain[index] = waveform == OSCILLATORBANK_SQUARE;
+        x->sawGain[index] = waveform == OSCILLATORBANK_SAW;
+        x->triangleGain[index] = waveform == OSCILLATORBANK_TRIANGLE;
+        break;
+    }
+    case P_PHASE:
+        x->phase[index] = (uint32_t) (int64_t) ((value - floorf(value)) * 4294967296.0);
+        break;
+    }
+}
+
+OSL_API void OscillatorBank_SetCount(int numOscillators, OscillatorBank* x) {
+    if (numOscillators < 0)
+        numOscillators = 0;
+    x->numOscillators = numOscillators > x->maxOscillators ? x->maxOscillators : numOscillators;
+}
+
+OSL_API double OscillatorBank_GetPhase(int index, OscillatorBank* x) {
+    if (index < 0 || index >= x->maxOscillators)
+        return 0;
+    return x->phase[index] / 4294967296.0;
+}
+
+/* Allocating and freeing */
+
+OSL_API OscillatorBank* OscillatorBank_New(int maxOscillators, float sampleRate) {
+    if (maxOscillators < 1)
+        maxOscillators = 1;
+
+    OscillatorBank* x = (OscillatorBank*) _malloc(sizeof(OscillatorBank));
+    x->numOscillators = maxOscillators;
+    x->maxOscillators = maxOscillators;
+    x->sampleRate = sampleRate;
+
+    x->phase = (uint32_t*) _malloc(maxOscillators * sizeof(uint32_t));
+    x->increment = (int32_t*) _malloc(maxOscillators * sizeof(int32_t));
+    x->targetIncrement = (int32_t*) _malloc(maxOscillators * sizeof(int32_t));
+    x->incrementStep = (int32_t*) _malloc(maxOscillators * sizeof(int32_t));
+    x->amplitude = (float*) _malloc(maxOscillators * sizeof(float));
+    x->targetAmplitude = (float*) _malloc(maxOscillators * sizeof(float));
+    x->amplitudeStep = (float*) _malloc(maxOscillators * sizeof(float));
+    x->sineGain = (float*) _malloc(maxOscillators * sizeof(float));
+    x->squareGain = (float*) _malloc(maxOscillators * sizeof(float));
+    x->sawGain = (float*) _malloc(maxOscillators * sizeof(float));
+    x->triangleGain = (float*) _malloc(maxOscillators * sizeof(float));
+    x->temp = (float*) _malloc(OSCILLATORBANK_CHUNK * maxOscillators * sizeof(float));
+
+    memset(x->phase, 0, maxOscillators * sizeof(uint32_t));
+    memset(x->increment, 0, maxOscillators * sizeof(int32_t));
+    memset(x->targetIncrement, 0, maxOscillators * sizeof(int32_t));
+    memset(x->incrementStep, 0, maxOscillators * sizeof(int32_t));
+    _fZero(x->amplitude, maxOscillators);
+    _fZero(x->targetAmplitude, maxOscillators);
+    _fZero(x->amplitudeStep, maxOscillators);
+    _fZero(x->squareGain, maxOscillators);
+    _fZero(x->sawGain, maxOscillators);
+    _fZero(x->triangleGain, maxOscillators);
+    for (int o = 0; o < maxOscillators; o++)
+        x->sineGain[o] = 1;
+    return x;
+}
+
+OSL_API void OscillatorBank_Free(OscillatorBank* x) {
+    _free(x->phase);
+    _free(x->increment);
+    _free(x->targetIncrement);
+    _free(x->incrementStep);
+    _free(x->amplitude);
+    _free(x->targetAmplitude);
+    _free(x->amplitudeStep);
+    _free(x->sineGain);
+    _free(x->squareGain);
+    _free(x->sawGain);
+    _free(x->triangleGain);
+    _free(x->temp);
+    _free(x);
+}
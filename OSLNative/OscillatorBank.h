@@ -0,0 +1,106 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// A bank of naive oscillators that are rendered together in one call.
+///
+/// Patches with many oscillators (drones, chords, LFO farms) would otherwise cross the managed/native boundary and run
+/// the per-sample loop once per oscillator. The bank keeps the state of all its oscillators as structure-of-arrays
+/// (phase, increment, amplitude, waveform) and loops over the oscillators in the inner loop, so that the SIMD lanes run
+/// across oscillators. Each lane computes all four wave shapes without branches and selects its own with a one-hot
+/// gain per shape.
+///
+/// The phase is a 32 bit fixed-point accumulator as in OscillatorSignalGenerator(). Frequency and amplitude changes are
+/// ramped linearly over the next block.
+///
+/// OscillatorBank_New() and OscillatorBank_Free() must not be called from the audio thread. All other functions are not
+/// thread-safe, hence the caller must avoid simultaneous access from multiple threads.
+
+#ifndef OscillatorBank_h
+#define OscillatorBank_h
+
+#include "main.h"
+#include <stdint.h>
+
+#define OSCILLATORBANK_SINE 0
+#define OSCILLATORBANK_SQUARE 1
+#define OSCILLATORBANK_SAW 2
+#define OSCILLATORBANK_TRIANGLE 3
+
+struct OscillatorBank {
+    int numOscillators; // active oscillators, <= maxOscillators
+    int maxOscillators;
+    float sampleRate;
+
+    // one entry per oscillator
+    uint32_t* phase;
+    int32_t* increment; // signed, negative frequencies run backwards
+    int32_t* targetIncrement;
+    int32_t* incrementStep;
+    float* amplitude;
+    float* targetAmplitude;
+    float* amplitudeStep;
+    float* sineGain; // the waveform, one-hot
+    float* squareGain;
+    float* sawGain;
+    float* triangleGain;
+
+    float* temp; // [OSCILLATORBANK_CHUNK][maxOscillators], for mixing
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Processing audio */
+
+/// Renders n frames of all active oscillators. The output is interleaved with one channel per oscillator, i.e.
+/// dest[frame * numOscillators + oscillator].
+OSL_API void OscillatorBank_Process(float dest[], int n, OscillatorBank* x);
+/// Renders the sum of all active oscillators into 1 block of interleaved audio data; every channel gets the same sum.
+OSL_API void OscillatorBank_Mix(float buffer[], int n, int channels, OscillatorBank* x);
+
+/* Setting and getting parameters */
+
+/// Sets a parameter of one oscillator to the specified value.
+OSL_API void OscillatorBank_SetParam(float value, int param, int index, OscillatorBank* x);
+/// Sets the number of active oscillators, clamped to the maximum given to OscillatorBank_New().
+OSL_API void OscillatorBank_SetCount(int numOscillators, OscillatorBank* x);
+/// Returns the phase of one oscillator in [0, 1).
+OSL_API double OscillatorBank_GetPhase(int index, OscillatorBank* x);
+
+/* Allocating and freeing */
+
+/// Allocates and returns a new bank of up to maxOscillators oscillators, all of them active and silent.
+OSL_API OscillatorBank* OscillatorBank_New(int maxOscillators, float sampleRate);
+/// Releases allocated resources.
+OSL_API void OscillatorBank_Free(OscillatorBank* x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OscillatorBank_h */
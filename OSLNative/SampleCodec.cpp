@@ -0,0 +1,174 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "SampleCodec.h"
+#include <string.h>
+#include <math.h>
+
+#define ADPCM_HEADER 4 // bytes per channel and block: int16 predictor, uint8 step index, 1 byte padding
+#define ADPCM_CHANNELBYTES (ADPCM_HEADER + SAMPLECODEC_ADPCM_BLOCK / 2)
+
+static const int16_t adpcmSteps[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,    25,    28,
+    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,   337,   371,   408,   449,   494,
+    544,   598,   658,   724,   796,   876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,
+    9493,  10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+static const int8_t adpcmIndexAdjust[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+static inline int16_t toInt16(float f) {
+    float s = f * 32768.f;
+    s = s > 32767.f ? 32767.f : (s < -32768.f ? -32768.f : s);
+    return (int16_t) lrintf(s);
+}
+
+/// One step of the IMA ADPCM decoder, shared by the encoder so that both track the same predictor.
+static inline void adpcmStep(int code, int& predictor, int& index) {
+    int step = adpcmSteps[index];
+    int diff = step >> 3;
+    if (code & 4)
+        diff += step;
+    if (code & 2)
+        diff += step >> 1;
+    if (code & 1)
+        diff += step >> 2;
+    predictor += code & 8 ? -diff : diff;
+    predictor = predictor > 32767 ? 32767 : (predictor < -32768 ? -32768 : predictor);
+    index += adpcmIndexAdjust[code];
+    index = index < 0 ? 0 : (index > 88 ? 88 : index);
+}
+
+static inline int adpcmEncodeSample(int sample, int& predictor, int& index) {
+    int step = adpcmSteps[index];
+    int diff = sample - predictor;
+    int code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    if (diff >= step) {
+        code |= 4;
+        diff -= step;
+    }
+    if (diff >= step >> 1) {
+        code |= 2;
+        diff -= step >> 1;
+    }
+    if (diff >= step >> 2)
+        code |= 1;
+    adpcmStep(code, predictor, index);
+    return code;
+}
+
+static int adpcmBlocks(int frames) {
+    return (frames + SAMPLECODEC_ADPCM_BLOCK - 1) >> SAMPLECODEC_ADPCM_SHIFT;
+}
+
+size_t SampleCodec_Size(int format, int frames, int channels) {
+    switch (format) {
+    case SAMPLECODEC_INT16:
+        return (size_t) frames * channels * sizeof(int16_t);
+    case SAMPLECODEC_ADPCM:
+        return (size_t) adpcmBlocks(frames) * channels * ADPCM_CHANNELBYTES;
+    default:
+        return (size_t) frames * channels * sizeof(float);
+    }
+}
+
+void SampleCodec_Encode(int format, const float* src, int frames, int channels, void* dest) {
+    if (format == SAMPLECODEC_INT16) {
+        int16_t* d = (int16_t*) dest;
+        for (size_t i = 0; i < (size_t) frames * channels; i++)
+            d[i] = toInt16(src[i]);
+        return;
+    }
+    if (format != SAMPLECODEC_ADPCM) {
+        memcpy(dest, src, (size_t) frames * channels * sizeof(float));
+        return;
+    }
+
+    unsigned char* out = (unsigned char*) dest;
+    for (int c = 0; c < channels; c++) {
+        int index = 0; // carried over from block to block, so each block starts well adapted
+        for (int b = 0; b < adpcmBlocks(frames); b++) {
+            unsigned char* block = out + ((size_t) b * channels + c) * ADPCM_CHANNELBYTES;
+            int first = b * SAMPLECODEC_ADPCM_BLOCK;
+            int predictor = toInt16(src[(size_t) first * channels + c]);
+            block[0] = (unsigned char) (predictor & 0xFF);
+            block[1] = (unsigned char) ((predictor >> 8) & 0xFF);
+            block[2] = (unsigned char) index;
+            block[3] = 0;
+
+            unsigned char* nibbles = block + ADPCM_HEADER;
+            memset(nibbles, 0, SAMPLECODEC_ADPCM_BLOCK / 2);
+            for (int j = 0; j < SAMPLECODEC_ADPCM_BLOCK; j++) {
+                int f = first + j;
+                int sample = f < frames ? toInt16(src[(size_t) f * channels + c]) : predictor; // pad the last block
+                int code = adpcmEncodeSample(sample, predictor, index);
+                nibbles[j >> 1] |= (unsigned char) (code << ((j & 1) * 4));
+            }
+        }
+    }
+}
+
+void SampleCodec_DecodeAdpcmBlock(const void* data, int block, int channels, float* dest) {
+    const unsigned char* in = (const unsigned char*) data + (size_t) block * channels * ADPCM_CHANNELBYTES;
+    for (int c = 0; c < channels; c++, in += ADPCM_CHANNELBYTES) {
+        int predictor = (int16_t) (in[0] | in[1] << 8);
+        int index = in[2] > 88 ? 88 : in[2];
+        const unsigned char* nibbles = in + ADPCM_HEADER;
+        for (int j = 0; j < SAMPLECODEC_ADPCM_BLOCK; j++) {
+            adpcmStep((nibbles[j >> 1] >> ((j & 1) * 4)) & 15, predictor, index);
+            dest[j * channels + c] = SampleCodec_Int16((int16_t) predictor);
+        }
+    }
+}
+
+void SampleCodec_Decode(int format, const void* data, int start, int n, int channels, float* dest) {
+    if (format == SAMPLECODEC_INT16) {
+        const int16_t* s = (const int16_t*) data + (size_t) start * channels;
+        for (size_t i = 0; i < (size_t) n * channels; i++)
+            dest[i] = SampleCodec_Int16(s[i]);
+        return;
+    }
+    if (format != SAMPLECODEC_ADPCM) {
+        memcpy(dest, (const float*) data + (size_t) start * channels, (size_t) n * channels * sizeof(float));
+        return;
+    }
+
+    float block[SAMPLECODEC_ADPCM_BLOCK * SAMPLECODEC_ADPCM_MAXCHANNELS];
+    for (int f = start; f < start + n;) {
+        int b = f >> SAMPLECODEC_ADPCM_SHIFT;
+        int offset = f & (SAMPLECODEC_ADPCM_BLOCK - 1);
+        int m = SAMPLECODEC_ADPCM_BLOCK - offset < start + n - f ? SAMPLECODEC_ADPCM_BLOCK - offset : start + n - f;
+        SampleCodec_DecodeAdpcmBlock(data, b, channels, block);
+        memcpy(dest + (size_t) (f - start) * channels, block + offset * channels, m * channels * sizeof(float));
+        f += m;
+    }
+}
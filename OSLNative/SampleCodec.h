@@ -0,0 +1,67 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Storage formats for samples in memory.
+///
+/// SAMPLECODEC_INT16 halves the memory of 32 bit float data and is decoded with one multiplication.
+///
+/// SAMPLECODEC_ADPCM is IMA ADPCM (4 bits per sample, about 1/7 of float) in blocks of SAMPLECODEC_ADPCM_BLOCK frames.
+/// Each block starts with the predictor and step index of every channel, so any block can be decoded without its
+/// predecessors. This gives random access at block granularity: a reader decodes whole blocks into a small cache and
+/// interpolates from there.
+///
+/// Both compressed formats clip at +/-1. Encoding allocates nothing but must not run on the audio thread for long
+/// samples; decoding is real-time safe.
+
+#ifndef SampleCodec_h
+#define SampleCodec_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SAMPLECODEC_FLOAT32 0
+#define SAMPLECODEC_INT16 1
+#define SAMPLECODEC_ADPCM 2
+
+#define SAMPLECODEC_ADPCM_SHIFT 7
+#define SAMPLECODEC_ADPCM_BLOCK (1 << SAMPLECODEC_ADPCM_SHIFT) // frames per block
+#define SAMPLECODEC_ADPCM_MAXCHANNELS 2
+
+/// Bytes needed to store frames frames in the given format.
+size_t SampleCodec_Size(int format, int frames, int channels);
+/// Encodes interleaved float data. dest must hold SampleCodec_Size() bytes.
+void SampleCodec_Encode(int format, const float* src, int frames, int channels, void* dest);
+/// Decodes n interleaved frames starting at frame start.
+void SampleCodec_Decode(int format, const void* data, int start, int n, int channels, float* dest);
+/// Decodes one ADPCM block to SAMPLECODEC_ADPCM_BLOCK interleaved frames.
+void SampleCodec_DecodeAdpcmBlock(const void* data, int block, int channels, float* dest);
+
+static inline float SampleCodec_Int16(int16_t s) {
+    return s * (1.f / 32768.f);
+}
+
+#endif /* SampleCodec_h */
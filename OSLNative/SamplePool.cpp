@@ -0,0 +1,230 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "SamplePool.h"
+#include "util.h"
+#include <string.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+#define SAMPLEPOOL_SLOTBITS 10 // log2(SAMPLEPOOL_MAX)
+#define SAMPLEPOOL_GENERATIONS (1 << (31 - SAMPLEPOOL_SLOTBITS)) // keeps handles positive
+
+/// A handle is generation << SAMPLEPOOL_SLOTBITS | slot, and the tag of a live entry is generation << 1 | 1.
+struct SamplePoolEntry {
+    std::atomic<uint32_t> tag;
+    std::atomic<int> refs;
+    std::atomic<int> readers; // active locks
+    std::atomic<bool> released;
+    void* data; // aligned to SAMPLEPOOL_ALIGNMENT
+    void* block;
+    int frames;
+    int channels;
+    int format;
+    char* key;
+};
+
+static std::mutex samplePoolMutex; // guards adding and freeing entries
+static SamplePoolEntry samplePool[SAMPLEPOOL_MAX];
+
+static inline SamplePoolEntry* SamplePool_Entry(int handle) {
+    return handle > 0 ? &samplePool[handle & (SAMPLEPOOL_MAX - 1)] : NULL;
+}
+
+static inline uint32_t SamplePool_LiveTag(int handle) {
+    return (uint32_t) (handle >> SAMPLEPOOL_SLOTBITS) << 1 | 1;
+}
+
+static inline int SamplePool_Handle(int slot, uint32_t tag) {
+    return (int) (tag >> 1) << SAMPLEPOOL_SLOTBITS | slot;
+}
+
+/// Finds a live entry by key and adds a reference, samplePoolMutex must be held.
+static int SamplePool_FindLocked(const char* key) {
+    for (int slot = 0; slot < SAMPLEPOOL_MAX; slot++) {
+        SamplePoolEntry* e = &samplePool[slot];
+        uint32_t tag = e->tag.load(std::memory_order_acquire);
+        if ((tag & 1) && e->key && strcmp(e->key, key) == 0) {
+            e->refs.fetch_add(1, std::memory_order_relaxed);
+            return SamplePool_Handle(slot, tag);
+        }
+    }
+    return SAMPLEPOOL_INVALID;
+}
+
+/// samplePoolMutex must be held.
+static void SamplePool_CollectLocked() {
+    for (int slot = 0; slot < SAMPLEPOOL_MAX; slot++) {
+        SamplePoolEntry* e = &samplePool[slot];
+        /// the tag was cleared before released was set, so a reader that locks from now on fails
+        if (!e->released.load(std::memory_order_acquire) || e->readers.load(std::memory_order_seq_cst) != 0)
+            continue;
+        _free(e->block);
+        _free(e->key);
+        e->block = NULL;
+        e->data = NULL;
+        e->key = NULL;
+        e->released.store(false, std::memory_order_relaxed);
+    }
+}
+
+/* Adding and releasing samples */
+
+OSL_API int SamplePool_Add(const char* key, const float* data, int frames, int channels, int format) {
+    if (!data || frames <= 0 || channels <= 0)
+        return SAMPLEPOOL_INVALID;
+
+    std::lock_guard<std::mutex> lock(samplePoolMutex);
+    SamplePool_CollectLocked();
+    if (key) {
+        int handle = SamplePool_FindLocked(key);
+        if (handle != SAMPLEPOOL_INVALID)
+            return handle;
+    }
+
+    for (int slot = 0; slot < SAMPLEPOOL_MAX; slot++) {
+        SamplePoolEntry* e = &samplePool[slot];
+        uint32_t tag = e->tag.load(std::memory_order_relaxed);
+        if ((tag & 1) || e->block)
+            continue;
+
+        if (format == SAMPLECODEC_ADPCM && channels > SAMPLECODEC_ADPCM_MAXCHANNELS)
+            format = SAMPLECODEC_INT16;
+        else if (format != SAMPLECODEC_INT16 && format != SAMPLECODEC_ADPCM)
+            format = SAMPLECODEC_FLOAT32;
+
+        /// malloc only guarantees 8 or 16 bytes, so we over-allocate and align by hand
+        e->block = _malloc(SampleCodec_Size(format, frames, channels) + SAMPLEPOOL_ALIGNMENT);
+        uintptr_t p = ((uintptr_t) e->block + SAMPLEPOOL_ALIGNMENT - 1) & ~(uintptr_t) (SAMPLEPOOL_ALIGNMENT - 1);
+        e->data = (void*) p;
+        SampleCodec_Encode(format, data, frames, channels, e->data);
+        e->frames = frames;
+        e->channels = channels;
+        e->format = format;
+        e->key = NULL;
+        if (key) {
+            size_t length = strlen(key) + 1;
+            e->key = (char*) _malloc(length);
+            memcpy(e->key, key, length);
+        }
+        e->refs.store(1, std::memory_order_relaxed);
+
+        uint32_t generation = (tag >> 1) + 1;
+        if (generation >= SAMPLEPOOL_GENERATIONS)
+            generation = 1;
+        e->tag.store(generation << 1 | 1, std::memory_order_release);
+        return SamplePool_Handle(slot, e->tag.load(std::memory_order_relaxed));
+    }
+
+    printv("SamplePool: no free entry left\n");
+    return SAMPLEPOOL_INVALID;
+}
+
+OSL_API int SamplePool_Find(const char* key) {
+    if (!key)
+        return SAMPLEPOOL_INVALID;
+    std::lock_guard<std::mutex> lock(samplePoolMutex);
+    return SamplePool_FindLocked(key);
+}
+
+OSL_API void SamplePool_Retain(int handle) {
+    SamplePoolEntry* e = SamplePool_Entry(handle);
+    if (e && e->tag.load(std::memory_order_acquire) == SamplePool_LiveTag(handle))
+        e->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+OSL_API void SamplePool_Release(int handle) {
+    SamplePoolEntry* e = SamplePool_Entry(handle);
+    if (!e || e->tag.load(std::memory_order_acquire) != SamplePool_LiveTag(handle))
+        return;
+    if (e->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        e->tag.store(SamplePool_LiveTag(handle) & ~1u, std::memory_order_seq_cst);
+        e->released.store(true, std::memory_order_release);
+    }
+}
+
+OSL_API void SamplePool_Collect() {
+    std::lock_guard<std::mutex> lock(samplePoolMutex);
+    SamplePool_CollectLocked();
+}
+
+/* Accessing samples */
+
+OSL_API const void* SamplePool_Lock(int handle, int* frames, int* channels, int* format) {
+    SamplePoolEntry* e = SamplePool_Entry(handle);
+    if (!e)
+        return NULL;
+    /// Announce the reader first, then check the tag. Release() clears the tag first and Collect() checks the readers
+    /// afterwards, so either the lock fails or the memory is not freed.
+    e->readers.fetch_add(1, std::memory_order_seq_cst);
+    if (e->tag.load(std::memory_order_seq_cst) != SamplePool_LiveTag(handle)) {
+        e->readers.fetch_sub(1, std::memory_order_relaxed);
+        return NULL;
+    }
+    if (frames)
+        *frames = e->frames;
+    if (channels)
+        *channels = e->channels;
+    if (format)
+        *format = e->format;
+    return e->data;
+}
+
+OSL_API void SamplePool_Unlock(int handle) {
+    SamplePoolEntry* e = SamplePool_Entry(handle);
+    if (e)
+        e->readers.fetch_sub(1, std::memory_order_release);
+}
+
+OSL_API int SamplePool_GetFrames(int handle) {
+    int frames = 0;
+    if (SamplePool_Lock(handle, &frames, NULL, NULL))
+        SamplePool_Unlock(handle);
+    return frames;
+}
+
+OSL_API int SamplePool_GetChannels(int handle) {
+    int channels = 0;
+    if (SamplePool_Lock(handle, NULL, &channels, NULL))
+        SamplePool_Unlock(handle);
+    return channels;
+}
+
+OSL_API int SamplePool_Read(int handle, int start, int n, float* dest) {
+    int frames, channels, format;
+    const void* data = SamplePool_Lock(handle, &frames, &channels, &format);
+    if (!data)
+        return 0;
+    if (start < 0)
+        start = 0;
+    n = start + n > frames ? frames - start : n;
+    if (n > 0)
+        SampleCodec_Decode(format, data, start, n, channels, dest);
+    SamplePool_Unlock(handle);
+    return n > 0 ? n : 0;
+}
@@ -0,0 +1,90 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// A process-wide pool of decoded samples that are shared between players.
+///
+/// Every sample is stored once, 64-byte aligned, and is referred to by an integer handle. Samples can be stored as
+/// float or compressed, see SampleCodec.h. Samples that are added with
+/// the same key (e.g. the file path) share one entry, so ten players on one drum break hold one copy. Handles contain a
+/// generation count, so a handle whose sample has been released is detected instead of reading freed memory.
+///
+/// Entries are reference-counted. When the last reference is released the entry stops resolving, but its memory is
+/// only freed once no audio thread holds it anymore: players lock a handle for the duration of a block, and
+/// SamplePool_Collect() frees released entries that are not locked. Locking, unlocking and releasing never allocate,
+/// free or wait, so they may be called from the audio thread.
+///
+/// SamplePool_Add(), SamplePool_Find() and SamplePool_Collect() take a lock and must not be called from the audio
+/// thread.
+
+#ifndef SamplePool_h
+#define SamplePool_h
+
+#include "main.h"
+#include "SampleCodec.h"
+
+#define SAMPLEPOOL_MAX 1024 // entries
+#define SAMPLEPOOL_ALIGNMENT 64 // bytes
+#define SAMPLEPOOL_INVALID 0 // never a valid handle
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Adding and releasing samples */
+
+/// Returns a handle to the given interleaved sample data with one reference. If an entry with the same key exists, its
+/// handle is returned and data and format are ignored; otherwise the data is stored in the given SAMPLECODEC_ format.
+/// key may be NULL to always add a new entry. Returns SAMPLEPOOL_INVALID if the pool is full.
+OSL_API int SamplePool_Add(const char* key, const float* data, int frames, int channels, int format);
+/// Returns a handle with one more reference to the entry with the given key, or SAMPLEPOOL_INVALID.
+OSL_API int SamplePool_Find(const char* key);
+/// Adds a reference. The caller must already hold one.
+OSL_API void SamplePool_Retain(int handle);
+/// Removes a reference. After the last one the handle stops resolving; the memory is freed by SamplePool_Collect().
+OSL_API void SamplePool_Release(int handle);
+/// Frees the memory of released entries that are not locked anymore. Also runs on every SamplePool_Add().
+OSL_API void SamplePool_Collect();
+
+/* Accessing samples */
+
+/// Returns the stored data of the sample and keeps it in memory until SamplePool_Unlock(), or returns NULL if the
+/// handle is not valid (anymore). Any of the out parameters may be NULL.
+OSL_API const void* SamplePool_Lock(int handle, int* frames, int* channels, int* format);
+/// Ends a successful SamplePool_Lock().
+OSL_API void SamplePool_Unlock(int handle);
+/// Number of frames of the sample, or 0 if the handle is not valid.
+OSL_API int SamplePool_GetFrames(int handle);
+/// Number of channels of the sample, or 0 if the handle is not valid.
+OSL_API int SamplePool_GetChannels(int handle);
+/// Decodes n interleaved frames starting at frame start to dest. Returns the number of frames decoded.
+OSL_API int SamplePool_Read(int handle, int start, int n, float* dest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SamplePool_h */
@@ -0,0 +1,277 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Scheduler.h"
+#include "util.h"
+#include <chrono>
+#if defined(ANDROID) || defined(__ANDROID__) || defined(__linux__)
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#define SCHEDULER_EMPTY -1
+#define SCHEDULER_SPINS 2000 // busy-wait iterations before an idle worker starts yielding
+#define SCHEDULER_YIELDS 200 // yields before an idle worker goes to sleep
+
+static inline void _cpuRelax() {
+#if defined(_MSC_VER)
+    YieldProcessor();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#elif defined(__x86_64__) || defined(__i386__)
+    asm volatile("pause");
+#endif
+}
+
+/// Pins the calling thread to one core. Big cores usually have the highest indices on ARM big.LITTLE systems, so
+/// workers are placed from the top down.
+static void Scheduler_Pin(int worker) {
+    int cores = (int) std::thread::hardware_concurrency();
+    if (cores <= 1)
+        return;
+    int core = (cores - worker) % cores;
+#if defined(ANDROID) || defined(__ANDROID__) || defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        printv("Scheduler: could not pin worker %d to core %d\n", worker, core);
+#elif defined(_WIN32)
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << core);
+#else
+    (void) core; // macOS does not support thread affinity
+#endif
+}
+
+/* Work-stealing deque. Only the owner calls push and pop; any thread may call steal. */
+
+static void WorkDeque_Push(int task, WorkDeque* d) {
+    int64_t b = d->bottom.load(std::memory_order_relaxed);
+    d->slots[b & d->mask].store(task, std::memory_order_relaxed);
+    d->bottom.store(b + 1, std::memory_order_release);
+}
+
+static int WorkDeque_Pop(WorkDeque* d) {
+    int64_t b = d->bottom.load(std::memory_order_relaxed) - 1;
+    d->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = d->top.load(std::memory_order_relaxed);
+    if (t > b) {
+        /// deque was empty
+        d->bottom.store(b + 1, std::memory_order_relaxed);
+        return SCHEDULER_EMPTY;
+    }
+    int task = d->slots[b & d->mask].load(std::memory_order_relaxed);
+    if (t == b) {
+        /// last element: race against thieves
+        if (!d->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            task = SCHEDULER_EMPTY;
+        d->bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+static int WorkDeque_Steal(WorkDeque* d) {
+    int64_t t = d->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = d->bottom.load(std::memory_order_acquire);
+    if (t >= b)
+        return SCHEDULER_EMPTY;
+    int task = d->slots[t & d->mask].load(std::memory_order_relaxed);
+    if (!d->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return SCHEDULER_EMPTY; // lost the race, the caller simply tries again
+    return task;
+}
+
+/* Queue for tasks that must run on the calling thread. Any thread may push, only thread 0 pops. */
+
+static void Scheduler_PushMain(int task, Scheduler* x) {
+    int i = x->mainTail.fetch_add(1, std::memory_order_relaxed);
+    x->mainSlots[i] = task;
+    x->mainReady[i].store(1, std::memory_order_release);
+}
+
+static int Scheduler_PopMain(Scheduler* x) {
+    if (x->mainHead >= x->maxTasks || x->mainReady[x->mainHead].load(std::memory_order_acquire) == 0)
+        return SCHEDULER_EMPTY;
+    x->mainReady[x->mainHead].store(0, std::memory_order_relaxed);
+    return x->mainSlots[x->mainHead++];
+}
+
+/* Executing */
+
+static void Scheduler_MakeReady(int task, int thread, SchedulerJob* job, Scheduler* x) {
+    if (job->mainOnly && job->mainOnly[task])
+        Scheduler_PushMain(task, x);
+    else
+        WorkDeque_Push(task, &x->deques[thread]);
+}
+
+static void Scheduler_Execute(int task, int thread, Scheduler* x) {
+    SchedulerJob* job = x->job.load(std::memory_order_acquire);
+    job->func(task, thread, job->context);
+
+    for (int s = job->succStart[task]; s < job->succStart[task + 1]; s++) {
+        int next = job->succ[s];
+        if (x->pending[next].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            Scheduler_MakeReady(next, thread, job, x);
+    }
+    x->remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+static int Scheduler_Next(int thread, Scheduler* x) {
+    int task = SCHEDULER_EMPTY;
+    if (thread == 0)
+        task = Scheduler_PopMain(x);
+    if (task == SCHEDULER_EMPTY)
+        task = WorkDeque_Pop(&x->deques[thread]);
+    for (int i = 1; task == SCHEDULER_EMPTY && i < x->numThreads; i++)
+        task = WorkDeque_Steal(&x->deques[(thread + i) % x->numThreads]);
+    return task;
+}
+
+static void Scheduler_Work(int thread, Scheduler* x) {
+    while (x->remaining.load(std::memory_order_acquire) > 0) {
+        int task = Scheduler_Next(thread, x);
+        if (task != SCHEDULER_EMPTY)
+            Scheduler_Execute(task, thread, x);
+        else
+            _cpuRelax();
+    }
+}
+
+static void Scheduler_WorkerLoop(int thread, Scheduler* x) {
+    Scheduler_Pin(thread);
+    uint32_t seen = x->epoch.load(std::memory_order_acquire);
+    int idle = 0;
+    while (!x->quit.load(std::memory_order_acquire)) {
+        uint32_t epoch = x->epoch.load(std::memory_order_acquire);
+        if (epoch != seen) {
+            seen = epoch;
+            idle = 0;
+            Scheduler_Work(thread, x);
+        } else if (idle < SCHEDULER_SPINS) {
+            idle++;
+            _cpuRelax();
+        } else if (idle < SCHEDULER_SPINS + SCHEDULER_YIELDS) {
+            idle++;
+            std::this_thread::yield();
+        } else {
+            /// The audio thread notifies without taking the mutex, so a wake-up can get lost; the timeout bounds the
+            /// damage to one late worker, the block itself is finished by thread 0 anyway.
+            x->sleepers.fetch_add(1, std::memory_order_acq_rel);
+            {
+                std::unique_lock<std::mutex> lock(x->sleepMutex);
+                x->wake.wait_for(lock, std::chrono::milliseconds(1), [&] {
+                    return x->quit.load(std::memory_order_acquire) ||
+                           x->epoch.load(std::memory_order_acquire) != seen;
+                });
+            }
+            x->sleepers.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+}
+
+void Scheduler_Run(SchedulerJob* job, Scheduler* x) {
+    if (job->numTasks <= 0)
+        return;
+
+    for (int t = 0; t < job->numTasks; t++)
+        x->pending[t].store(job->dependencies[t], std::memory_order_relaxed);
+    x->mainTail.store(0, std::memory_order_relaxed);
+    x->mainHead = 0;
+    x->job.store(job, std::memory_order_release);
+    x->remaining.store(job->numTasks, std::memory_order_release);
+
+    for (int t = 0; t < job->numTasks; t++) {
+        if (job->dependencies[t] == 0)
+            Scheduler_MakeReady(t, 0, job, x);
+    }
+
+    x->epoch.fetch_add(1, std::memory_order_acq_rel);
+    if (x->sleepers.load(std::memory_order_acquire) > 0)
+        x->wake.notify_all();
+
+    Scheduler_Work(0, x);
+}
+
+/* Allocating and freeing */
+
+Scheduler* Scheduler_New(int numThreads, int maxTasks) {
+    if (numThreads < 1)
+        numThreads = 1;
+    if (maxTasks < 1)
+        maxTasks = 1;
+
+    Scheduler* x = new Scheduler();
+    x->numThreads = numThreads;
+    x->maxTasks = maxTasks;
+    x->pending = new std::atomic<int>[maxTasks];
+    x->mainSlots = new int[maxTasks];
+    x->mainReady = new std::atomic<uint32_t>[maxTasks];
+    for (int i = 0; i < maxTasks; i++)
+        x->mainReady[i].store(0);
+    x->mainTail.store(0);
+    x->mainHead = 0;
+    x->remaining.store(0);
+    x->job.store(NULL);
+    x->epoch.store(0);
+    x->quit.store(false);
+    x->sleepers.store(0);
+
+    /// Every task is pushed at most once per block, so a deque never holds more than maxTasks tasks.
+    int capacity = _nextPowOf2(maxTasks);
+    x->deques = new WorkDeque[numThreads];
+    for (int i = 0; i < numThreads; i++) {
+        x->deques[i].top.store(0);
+        x->deques[i].bottom.store(0);
+        x->deques[i].slots = new std::atomic<int>[capacity];
+        x->deques[i].mask = capacity - 1;
+    }
+
+    x->workers = new std::thread[numThreads - 1];
+    for (int i = 1; i < numThreads; i++)
+        x->workers[i - 1] = std::thread(Scheduler_WorkerLoop, i, x);
+
+    return x;
+}
+
+void Scheduler_Free(Scheduler* x) {
+    x->quit.store(true, std::memory_order_release);
+    x->wake.notify_all();
+    for (int i = 0; i < x->numThreads - 1; i++)
+        x->workers[i].join();
+    delete[] x->workers;
+    for (int i = 0; i < x->numThreads; i++)
+        delete[] x->deques[i].slots;
+    delete[] x->deques;
+    delete[] x->pending;
+    delete[] x->mainSlots;
+    delete[] x->mainReady;
+    delete x;
+}
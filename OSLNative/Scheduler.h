@@ -0,0 +1,103 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// A fixed pool of worker threads that executes a DAG of tasks within one audio block.
+///
+/// Every thread owns a work-stealing deque (Chase & Lev, "Dynamic Circular Work-Stealing Deque", 2005). A thread pushes
+/// the tasks it makes ready onto its own deque and pops them in LIFO order, so a branch of the patch tends to stay on
+/// one core; idle threads steal from the other end. Tasks that have to run on the calling thread (e.g. because they
+/// call back into managed code) are handed back through a separate lock-free queue.
+///
+/// Scheduler_Run() neither allocates nor locks. The calling thread takes part in the work as thread 0, so a block is
+/// always completed even if the workers are late to wake up. Idle workers spin for a short while after each block and
+/// then go to sleep until the next one.
+///
+/// Scheduler_New() and Scheduler_Free() must not be called from the audio thread.
+
+#ifndef Scheduler_h
+#define Scheduler_h
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+
+/// Executes task with the given thread index (0 is the calling thread).
+typedef void (*SchedulerTaskFunc)(int task, int thread, void* context);
+
+/// One block worth of work. Task indices must be in topological order, i.e. every task only depends on tasks with a
+/// smaller index. All arrays are owned by the caller.
+struct SchedulerJob {
+    int numTasks;
+    const int* dependencies; // number of predecessors per task
+    const int* succStart;    // successors of task t: succ[succStart[t]..succStart[t+1])
+    const int* succ;
+    const bool* mainOnly; // tasks that must run on the calling thread, may be NULL
+    SchedulerTaskFunc func;
+    void* context;
+};
+
+struct WorkDeque {
+    std::atomic<int64_t> top;
+    std::atomic<int64_t> bottom;
+    std::atomic<int>* slots;
+    int64_t mask;
+};
+
+struct Scheduler {
+    int numThreads;
+    int maxTasks;
+    std::thread* workers; // numThreads - 1 workers, the calling thread is thread 0
+    WorkDeque* deques;    // one per thread
+    std::atomic<int>* pending;
+    std::atomic<int> remaining;
+    std::atomic<SchedulerJob*> job;
+    std::atomic<uint32_t> epoch;
+    std::atomic<bool> quit;
+
+    // tasks that must run on the calling thread
+    int* mainSlots;
+    std::atomic<uint32_t>* mainReady;
+    std::atomic<int> mainTail;
+    int mainHead;
+
+    // sleeping workers
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<int> sleepers;
+};
+
+/// Starts numThreads - 1 worker threads that are pinned to distinct cores where the platform allows it. maxTasks is the
+/// largest number of tasks a job may contain.
+Scheduler* Scheduler_New(int numThreads, int maxTasks);
+/// Executes all tasks of job and returns when the last one has finished.
+void Scheduler_Run(SchedulerJob* job, Scheduler* x);
+/// Stops and joins all workers and frees all resources.
+void Scheduler_Free(Scheduler* x);
+
+#endif /* Scheduler_h */
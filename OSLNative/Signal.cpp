@@ -0,0 +1,84 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Signal.h"
+#include "util.h"
+
+OSL_API int Signal_TagOf(float value) {
+    return value == 0 ? SIGNAL_SILENT : SIGNAL_CONSTANT;
+}
+
+OSL_API int Signal_Classify(const float* buf, int n, float* value) {
+    if (n <= 0)
+        return SIGNAL_AUDIO;
+    float v = buf[0];
+    for (int i = 1; i < n; i++) {
+        if (buf[i] != v)
+            return SIGNAL_AUDIO;
+    }
+    if (value)
+        *value = v;
+    return Signal_TagOf(v);
+}
+
+OSL_API int Signal_Fill(float* buf, int n, float value) {
+    if (value == 0) {
+        _fZero(buf, n);
+    } else {
+        for (int i = 0; i < n; i++)
+            buf[i] = value;
+    }
+    return Signal_TagOf(value);
+}
+
+OSL_API int Signal_ControlLength(int frames, int controlRate) {
+    return (frames + controlRate - 1) / controlRate;
+}
+
+OSL_API void Signal_ToControlRate(const float* buffer, int length, int channels, int controlRate, float* control) {
+    int frames = length / channels;
+    for (int start = 0, k = 0; start < frames; start += controlRate, k++) {
+        int end = start + controlRate < frames ? start + controlRate : frames;
+        control[k] = buffer[(end - 1) * channels];
+    }
+}
+
+OSL_API void Signal_FromControlRate(const float* control, int controlRate, float& prevControl, float* buffer,
+                                    int length, int channels) {
+    int frames = length / channels;
+    for (int start = 0, k = 0; start < frames; start += controlRate, k++) {
+        int end = start + controlRate < frames ? start + controlRate : frames;
+        float step = (control[k] - prevControl) / (end - start);
+        float v = prevControl;
+        for (int i = start; i < end; i++) {
+            v += step;
+            for (int c = 0; c < channels; c++)
+                buffer[i * channels + c] = v;
+        }
+        prevControl = control[k];
+    }
+}
@@ -0,0 +1,82 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Tags that describe the contents of a whole block buffer.
+///
+/// A large share of the signals in a patch are static most of the time: DC sources, gates in CV mode, settled pitch CV
+/// and unplugged inputs. A kernel that knows that an input is constant can compute a transcendental function once per
+/// block instead of once per sample, and a kernel whose inputs are silent can often skip its work entirely.
+///
+/// Producers that fill a buffer with a single value get the tag for free from Signal_Fill(). Kernels that are called
+/// with plain arrays use Signal_Classify(), which returns after the first differing sample and therefore costs next to
+/// nothing for actual audio.
+///
+/// CV that changes slowly can also be passed at control rate: one value per controlRate frames, non-interleaved. Value
+/// k is the target at the end of the k-th segment, and consumers ramp linearly towards it from the end of the previous
+/// segment, so they have to remember the last value of the previous block. The last segment is shorter if the number
+/// of frames is not a multiple of controlRate.
+
+#ifndef Signal_h
+#define Signal_h
+
+#include "main.h"
+
+#define SIGNAL_AUDIO 0    // no assumptions about the contents
+#define SIGNAL_CONSTANT 1 // all samples have the same value
+#define SIGNAL_SILENT 2   // all samples are 0
+
+#define SIGNAL_CONTROLRATE 16 // default number of frames per control value
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Returns the tag of the first n samples of buf. For SIGNAL_CONSTANT and SIGNAL_SILENT, the value is written to
+/// value (may be NULL).
+OSL_API int Signal_Classify(const float* buf, int n, float* value);
+/// Fills n samples of buf with value and returns the matching tag.
+OSL_API int Signal_Fill(float* buf, int n, float value);
+/// Tag of a buffer that holds value in every sample.
+OSL_API int Signal_TagOf(float value);
+
+/* Control rate */
+
+/// Number of control values that cover the given number of frames.
+OSL_API int Signal_ControlLength(int frames, int controlRate);
+/// Reduces an interleaved audio-rate CV buffer of length samples to control rate by taking the first channel at the end
+/// of every segment. control must hold Signal_ControlLength(length / channels, controlRate) values.
+OSL_API void Signal_ToControlRate(const float* buffer, int length, int channels, int controlRate, float* control);
+/// Expands control-rate values to an interleaved audio-rate buffer by ramping from prevControl, which is updated to the
+/// last value. For consumers that don't have a control-rate variant.
+OSL_API void Signal_FromControlRate(const float* control, int controlRate, float& prevControl, float* buffer,
+                                    int length, int channels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* Signal_h */
@@ -0,0 +1,267 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Wavetable.h"
+#include "util.h"
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+#include <complex>
+
+enum WavetableOscillatorParams { P_FREQUENCY, P_AMPLITUDE, P_MORPH, P_RESET, P_N };
+
+#define WAVETABLE_CHUNK 64 // frames per chunk
+
+/* Building tables */
+
+/// In-place radix-2 FFT, inverse if sign > 0 (unnormalized).
+static void Wavetable_FFT(std::complex<double>* a, int n, int sign) {
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(a[i], a[j]);
+    }
+    for (int len = 2; len <= n; len <<= 1) {
+        std::complex<double> w = std::polar(1.0, sign * 2 * M_PI / len);
+        for (int i = 0; i < n; i += len) {
+            std::complex<double> wk = 1;
+            for (int k = 0; k < len / 2; k++) {
+                std::complex<double> u = a[i + k], v = a[i + k + len / 2] * wk;
+                a[i + k] = u + v;
+                a[i + k + len / 2] = u - v;
+                wk *= w;
+            }
+        }
+    }
+}
+
+static float* Wavetable_Frame(int level, int frame, Wavetable* x) {
+    return x->data + ((size_t) level * x->numFrames + frame) * WAVETABLE_STRIDE;
+}
+
+OSL_API Wavetable* Wavetable_New(const float* frames, int numFrames, int frameSize) {
+    assert(numFrames > 0 && frameSize > 0 && (frameSize & (frameSize - 1)) == 0);
+    Wavetable* x = (Wavetable*) _malloc(sizeof(Wavetable));
+    x->numFrames = numFrames;
+    x->data = (float*) _malloc((size_t) WAVETABLE_LEVELS * numFrames * WAVETABLE_STRIDE * sizeof(float));
+
+    std::complex<double>* spectrum = new std::complex<double>[WAVETABLE_SIZE];
+    std::complex<double>* level = new std::complex<double>[WAVETABLE_SIZE];
+    int bins = _min(frameSize, WAVETABLE_SIZE) / 2; // harmonics that are representable in both sizes
+
+    for (int f = 0; f < numFrames; f++) {
+        /// The spectrum of the source frame, moved into a WAVETABLE_SIZE spectrum (this resamples the frame)
+        std::complex<double>* src = new std::complex<double>[frameSize];
+        for (int i = 0; i < frameSize; i++)
+            src[i] = frames[(size_t) f * frameSize + i];
+        Wavetable_FFT(src, frameSize, -1);
+        for (int k = 0; k < WAVETABLE_SIZE; k++)
+            spectrum[k] = 0;
+        for (int k = 1; k < bins; k++) { // drops DC and the Nyquist bin
+            spectrum[k] = src[k] / (double) frameSize;
+            spectrum[WAVETABLE_SIZE - k] = src[frameSize - k] / (double) frameSize;
+        }
+        delete[] src;
+
+        /// Each level keeps half the harmonics of the one before
+        for (int l = 0; l < WAVETABLE_LEVELS; l++) {
+            int maxHarmonic = (WAVETABLE_SIZE / 2) >> l;
+            for (int k = 0; k < WAVETABLE_SIZE; k++) {
+                int harmonic = k <= WAVETABLE_SIZE / 2 ? k : WAVETABLE_SIZE - k;
+                level[k] = harmonic < maxHarmonic ? spectrum[k] : 0;
+            }
+            Wavetable_FFT(level, WAVETABLE_SIZE, 1);
+            float* out = Wavetable_Frame(l, f, x);
+            for (int i = 0; i < WAVETABLE_SIZE; i++)
+                out[i] = (float) level[i].real();
+            out[WAVETABLE_SIZE] = out[0];
+        }
+    }
+
+    delete[] spectrum;
+    delete[] level;
+    return x;
+}
+
+OSL_API void Wavetable_Free(Wavetable* x) {
+    _free(x->data);
+    _free(x);
+}
+
+/* Built-in tables */
+
+static Wavetable* wavetable_shared[2];
+float* wavetable_sine;
+
+/// Builds the shared tables when the library is loaded, so that no oscillator ever allocates on the audio thread.
+struct WavetableInit {
+    WavetableInit() {
+        float* frames = (float*) _malloc(4 * WAVETABLE_SIZE * sizeof(float));
+        for (int i = 0; i < WAVETABLE_SIZE; i++) {
+            float t = (float) i / WAVETABLE_SIZE;
+            frames[i] = sinf(t * 2 * (float) M_PI);
+            frames[WAVETABLE_SIZE + i] = t <= 0.5f ? t * 4 - 1 : 3 - t * 4;
+            frames[2 * WAVETABLE_SIZE + i] = t * 2 - 1;
+            frames[3 * WAVETABLE_SIZE + i] = t >= 0.5f ? 1.f : -1.f;
+        }
+        wavetable_shared[WAVETABLE_SINE] = Wavetable_New(frames, 1, WAVETABLE_SIZE);
+        wavetable_shared[WAVETABLE_BASIC] = Wavetable_New(frames, 4, WAVETABLE_SIZE);
+        /// The sine has a single harmonic, so the FFT round trip would only add noise
+        wavetable_sine = wavetable_shared[WAVETABLE_SINE]->data;
+        for (int i = 0; i <= WAVETABLE_SIZE; i++)
+            wavetable_sine[i] = (float) sin(2 * M_PI * i / WAVETABLE_SIZE);
+        _free(frames);
+    }
+};
+static WavetableInit wavetable_init;
+
+OSL_API Wavetable* Wavetable_GetShared(int which) {
+    if (which < 0 || which > WAVETABLE_BASIC)
+        return NULL;
+    return wavetable_shared[which];
+}
+
+/* Processing audio */
+
+OSL_API void WavetableOscillator_Process(float buffer[], float freqExpBuffer[], float morphBuffer[], int n,
+                                         int channels, WavetableOscillator* x) {
+    Wavetable* table = x->table;
+    int frames = n / channels;
+    double sampleDuration = 1.0 / x->sampleRate;
+
+    float phases[WAVETABLE_CHUNK];
+    float amps[WAVETABLE_CHUNK];
+    float morphs[WAVETABLE_CHUNK];
+    float out[WAVETABLE_CHUNK];
+
+    for (int chunk = 0; chunk < frames; chunk += WAVETABLE_CHUNK) {
+        int m = frames - chunk < WAVETABLE_CHUNK ? frames - chunk : WAVETABLE_CHUNK;
+
+        /// 1. Phase, amplitude and morph position per frame
+        float maxIncrement = 0;
+        for (int j = 0; j < m; j++) {
+            int i = (chunk + j) * channels;
+            float t = (float) i / n;
+            float frequency = x->prevFrequency + t * (x->frequency - x->prevFrequency); // slope limiting
+            if (freqExpBuffer)
+                frequency *= powf(2, _clamp(freqExpBuffer[i], -1.f, 1.f) * 10.f);
+            float increment = (float) (_clamp(frequency, -24000.f, 24000.f) * sampleDuration);
+            maxIncrement = _max(maxIncrement, fabsf(increment));
+
+            float morph = x->prevMorph + t * (x->morph - x->prevMorph);
+            if (morphBuffer)
+                morph += morphBuffer[i];
+            morphs[j] = _clamp(morph, 0.f, 1.f) * (table->numFrames - 1);
+            amps[j] = x->prevAmplitude + t * (x->amplitude - x->prevAmplitude);
+            phases[j] = (float) x->phase * WAVETABLE_SIZE;
+
+            x->phase += increment;
+            x->phase -= floor(x->phase);
+        }
+
+        /// 2. The lowest level whose highest harmonic stays below Nyquist for the fastest frame of the chunk
+        int level = 0;
+        if (maxIncrement > 0) {
+            int e;
+            frexpf(maxIncrement * WAVETABLE_SIZE, &e); // 2^(e-1) <= increment * size < 2^e
+            level = e < 0 ? 0 : (e > WAVETABLE_LEVELS - 1 ? WAVETABLE_LEVELS - 1 : e);
+        }
+
+        /// 3. Interpolation within and between frames
+        for (int j = 0; j < m; j++) {
+            int frame = (int) morphs[j];
+            if (frame > table->numFrames - 2)
+                frame = table->numFrames > 1 ? table->numFrames - 2 : 0;
+            float blend = table->numFrames > 1 ? morphs[j] - frame : 0.f;
+            const float* a = Wavetable_Frame(level, frame, table);
+            const float* b = table->numFrames > 1 ? a + WAVETABLE_STRIDE : a;
+
+            int pos = (int) phases[j];
+            float frac = phases[j] - pos;
+            pos &= WAVETABLE_SIZE - 1;
+            float va = a[pos] + frac * (a[pos + 1] - a[pos]);
+            float vb = b[pos] + frac * (b[pos + 1] - b[pos]);
+            out[j] = (va + blend * (vb - va)) * amps[j];
+        }
+
+        /// 4. Interleaving
+        for (int j = 0; j < m; j++) {
+            for (int c = 0; c < channels; c++)
+                buffer[(chunk + j) * channels + c] = out[j];
+        }
+    }
+
+    x->prevFrequency = x->frequency;
+    x->prevAmplitude = x->amplitude;
+    x->prevMorph = x->morph;
+}
+
+/* Setting and getting parameters */
+
+OSL_API void WavetableOscillator_SetParam(float value, int param, WavetableOscillator* x) {
+    assert(param < P_N);
+
+    switch (param) {
+    case P_FREQUENCY:
+        x->frequency = value;
+        break;
+    case P_AMPLITUDE:
+        x->amplitude = value;
+        break;
+    case P_MORPH:
+        x->morph = _clamp(value, 0.f, 1.f);
+        break;
+    case P_RESET:
+        x->phase = 0;
+        break;
+    }
+}
+
+OSL_API void WavetableOscillator_SetTable(Wavetable* table, WavetableOscillator* x) {
+    if (table)
+        x->table = table;
+}
+
+/* Allocating and freeing */
+
+OSL_API WavetableOscillator* WavetableOscillator_New(float sampleRate) {
+    WavetableOscillator* x = (WavetableOscillator*) _malloc(sizeof(WavetableOscillator));
+    x->sampleRate = sampleRate;
+    x->frequency = x->prevFrequency = 261.6256f; // C4
+    x->amplitude = x->prevAmplitude = 1;
+    x->morph = x->prevMorph = 0;
+    x->phase = 0;
+    x->table = wavetable_shared[WAVETABLE_BASIC];
+    return x;
+}
+
+OSL_API void WavetableOscillator_Free(WavetableOscillator* x) {
+    _free(x);
+}
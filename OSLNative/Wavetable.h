@@ -0,0 +1,127 @@
+// This file is part of OpenSoundLab, which is based on SoundStage VR.
+//
+// Copyright © 2020-2024 OSLLv1 Spherical Labs OpenSoundLab
+//
+// OpenSoundLab is licensed under the OpenSoundLab License Agreement (OSLLv1).
+// You may obtain a copy of the License at
+// https://github.com/SphericalLabs/OpenSoundLab/LICENSE-OSLLv1.md
+//
+// By using, modifying, or distributing this software, you agree to be bound by the terms of the license.
+//
+//
+// Copyright © 2020 Apache 2.0 Maximilian Maroe SoundStage VR
+// Copyright © 2019-2020 Apache 2.0 James Surine SoundStage VR
+// Copyright © 2017 Apache 2.0 Google LLC SoundStage VR
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Wavetable oscillator with band-limited mip levels.
+///
+/// A Wavetable holds numFrames single-cycle waveforms of WAVETABLE_SIZE samples. For every frame, it stores one mip
+/// level per octave: level L keeps only the harmonics up to WAVETABLE_SIZE / 2 >> L, so an oscillator can always pick a
+/// level that has no content above Nyquist. The levels are computed once with an FFT when the table is created.
+///
+/// Tables are read-only after creation and are shared by all oscillators that use them. The built-in tables (a sine,
+/// and a morph table sine -> triangle -> saw -> square) are created when the library is loaded; Wavetable_Sine() reads
+/// the sine table and replaces libm sin() in the other oscillators.
+///
+/// The oscillator reads with linear interpolation and crossfades between the two frames next to the morph position.
+/// Phase, mip level and morph position are computed per chunk first, so that the interpolation loop has no
+/// dependencies between samples and can be vectorised.
+///
+/// Wavetable_New() and Wavetable_Free() must not be called from the audio thread. The oscillator functions are not
+/// thread-safe, hence the caller must avoid simultaneous access from multiple threads.
+
+#ifndef Wavetable_h
+#define Wavetable_h
+
+#include "main.h"
+
+#define WAVETABLE_SIZE 2048 // samples per frame, must be a power of 2
+#define WAVETABLE_LEVELS 10 // level 9 only keeps the fundamental, for fundamentals from 12 kHz up
+#define WAVETABLE_STRIDE (WAVETABLE_SIZE + 1) // one guard sample per frame for the interpolation
+
+#define WAVETABLE_SINE 0  // built-in: 1 frame
+#define WAVETABLE_BASIC 1 // built-in: sine, triangle, saw, square
+
+struct Wavetable {
+    int numFrames;
+    float* data; // [level][frame][WAVETABLE_STRIDE]
+};
+
+struct WavetableOscillator {
+    // public
+    float frequency;
+    float amplitude;
+    float morph; // 0..1 across the frames of the table
+
+    // internal
+    float sampleRate;
+    double phase;
+    float prevFrequency;
+    float prevAmplitude;
+    float prevMorph;
+    Wavetable* table;
+};
+
+/// The sine table, level 0 of WAVETABLE_SINE.
+extern float* wavetable_sine;
+
+/// Sine of phase * 2 * pi for phase in [0, 1), read from the shared table with linear interpolation.
+static inline float Wavetable_Sine(float phase) {
+    float pos = phase * WAVETABLE_SIZE;
+    int i = (int) pos;
+    float frac = pos - i;
+    i &= WAVETABLE_SIZE - 1;
+    return wavetable_sine[i] + frac * (wavetable_sine[i + 1] - wavetable_sine[i]);
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Tables */
+
+/// Creates a table from numFrames single-cycle waveforms of frameSize samples each (frameSize must be a power of 2, and
+/// is resampled to WAVETABLE_SIZE).
+OSL_API Wavetable* Wavetable_New(const float* frames, int numFrames, int frameSize);
+/// Returns one of the built-in tables (WAVETABLE_SINE, WAVETABLE_BASIC). They must not be freed.
+OSL_API Wavetable* Wavetable_GetShared(int which);
+/// Releases a table created by Wavetable_New(). No oscillator may use it anymore.
+OSL_API void Wavetable_Free(Wavetable* x);
+
+/* Processing audio */
+
+/// Renders 1 block of n interleaved samples. freqExpBuffer (0.1V/Oct) and morphBuffer (added to morph) may be NULL.
+OSL_API void WavetableOscillator_Process(float buffer[], float freqExpBuffer[], float morphBuffer[], int n,
+                                         int channels, WavetableOscillator* x);
+
+/* Setting and getting parameters */
+
+/// Sets the parameter to the specified value.
+OSL_API void WavetableOscillator_SetParam(float value, int param, WavetableOscillator* x);
+/// Switches to another table. The table must stay alive as long as the oscillator uses it.
+OSL_API void WavetableOscillator_SetTable(Wavetable* table, WavetableOscillator* x);
+
+/* Allocating and freeing */
+
+/// Allocates an oscillator that plays the built-in WAVETABLE_BASIC table.
+OSL_API WavetableOscillator* WavetableOscillator_New(float sampleRate);
+/// Releases allocated resources. The table is not freed.
+OSL_API void WavetableOscillator_Free(WavetableOscillator* x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* Wavetable_h */
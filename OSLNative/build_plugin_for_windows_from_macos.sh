@@ -4,7 +4,7 @@
 SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
 OUTPUT_DIR="${SCRIPT_DIR}/../Assets/OSLNative/x64/Release"
 OUTPUT_FILE="OSLNative.dll"
-SOURCE_FILES="Artefact.cpp Compressor.cpp CRingBuffer.cpp Delay.cpp Filter.cpp FreeVerb/freeverb/components/allpass.cpp FreeVerb/freeverb/components/comb.cpp FreeVerb/freeverb/components/revmodel.cpp Freeverb.cpp main.cpp MasterBusRecorder/AudioPluginUtil.cpp MasterBusRecorder/MasterBusRecorder.cpp resample.cpp RingBuffer.cpp util.c"
+SOURCE_FILES="Artefact.cpp Biquad.cpp BufferArena.cpp Clip.cpp ClipStream.cpp Compressor.cpp CRingBuffer.cpp Delay.cpp Envelope.cpp Filter.cpp FilterBank.cpp FreeVerb/freeverb/components/allpass.cpp FreeVerb/freeverb/components/comb.cpp FreeVerb/freeverb/components/revmodel.cpp Freeverb.cpp Granular.cpp Graph.cpp main.cpp MasterBusRecorder/AudioPluginUtil.cpp MasterBusRecorder/MasterBusRecorder.cpp Noise.cpp Oscillator.cpp OscillatorBank.cpp resample.cpp RingBuffer.cpp SampleCodec.cpp SamplePool.cpp Scheduler.cpp Signal.cpp util.c Wavetable.cpp"
 INCLUDES="-IMasterBusRecorder -IFreeVerb/dfx-library -IFreeVerb/freeverb/components"
 DEFINES="-DWIN32 -D_WINDOWS -D_USRDLL -DOSLNative_EXPORTS -DNDEBUG"
 FLAGS="-shared -static-libgcc -static-libstdc++ -Wl,--add-stdcall-alias -O3 -std=c++17"
@@ -27,13 +27,13 @@
 
 #include "main.h"
 #include "util.h"
+#include "Signal.h"
 #include <math.h>
 #include <stdlib.h>
-#include <random>
-#include "libs/pcg-cpp/include/pcg_random.hpp"
-#include <random>
+#include "Noise.h"
 
 #define PI 3.14159265
+#define NOISE_CHUNK 256 // frames rendered at once by NoiseProcessBuffer
 
 extern "C" {
 
@@ -41,6 +41,12 @@ float lerp(float a, float b, float f) {
     return (a * (1.0f - f)) + (b * f);
 }
 
+/// Whether an eased follower has reached its target. The lerp stalls a few ulps away from it, so the tolerance is
+/// relative.
+static inline bool settled(float value, float target) {
+    return fabsf(value - target) <= 1e-5f * fabsf(target) + 1e-7f;
+}
+
 void SetArrayToFixedValue(float buf[], int length, float value) {
     for (int i = 0; i < length; ++i) // how pre-increment? clicks?
         buf[i] = value;
@@ -202,10 +208,14 @@ void GateProcessBuffer(float buffer[], int length, int channels, bool incoming,
                           // clock, -2/+2 at 6' clock)
         {
             float endAmp = 4 * amp - 2;
-            for (int i = 0; i < length; i++)
-                buffer[i] = endAmp; // endAmp;
-        } else                      // act as attenverter for cv input?
+            Signal_Fill(buffer, length, endAmp);
+        } else // act as attenverter for cv input?
         {
+            float control;
+            if (Signal_Classify(controlBuffer, length, &control) != SIGNAL_AUDIO) {
+                Signal_Fill(buffer, length, amp * 2 * (control + 1) - 1.0f);
+                return;
+            }
             for (int i = 0; i < length; i++) {
                 buffer[i] = amp * 2 * (controlBuffer[i] + 1) - 1.0f;
             }
@@ -220,6 +230,14 @@ void GateProcessBuffer(float buffer[], int length, int channels, bool incoming,
             }
         } else // act as a VCA
         {
+            float control;
+            if (Signal_Classify(controlBuffer, length, &control) != SIGNAL_AUDIO) {
+                /// same as below, with the constant part factored out
+                float gain = .5f * (control + 1) * endAmp;
+                for (int i = 0; i < length; i++)
+                    buffer[i] = gain * buffer[i] + gain - 1.0f;
+                return;
+            }
             for (int i = 0; i < length; i++) {
                 // buffer[i] = ((controlBuffer[i] + 1) / 2.0f) * ((buffer[i] + 1) / 2.0f) * endAmp;
                 // buffer[i] = .25f * (controlBuffer[i] + 1) * (buffer[i] + 1) * endAmp;
@@ -274,19 +292,9 @@ void GateProcessBuffer(float buffer[], int length, int channels, bool incoming,
 
 // Define the NoiseProcessor structure in C++
 struct NoiseProcessor {
-    pcg32 rng;
-    std::uniform_real_distribution<float> dist;
-    uint64_t seed;
-    uint64_t step;
-    NoiseProcessor(uint64_t seed) : rng(seed), dist(-1.0f, 1.0f), seed(seed), step(0) {
-    }
-    float generate() {
-        step++;
-        return dist(rng);
-    }
-    void jump_ahead(uint64_t steps) {
-        rng.advance(steps);
-        step += steps;
+    Noise noise;
+    NoiseProcessor(uint64_t seed) {
+        Noise_Seed(seed, &noise);
     }
 };
 
@@ -302,11 +310,18 @@ void NoiseProcessBuffer(NoiseProcessor* processor, float* buffer, int length, in
                         float* lastSample, int* counter, int speedFrames, bool* updated) {
     if (sampleRatePercent > .95f) {
         *updated = true;
-        for (int i = 0; i < length; i += channels) {
-            *lastSample = processor->generate();
-            for (int c = 0; c < channels; ++c) {
-                buffer[i + c] = *lastSample;
+        float chunk[NOISE_CHUNK];
+        int frames = length / channels;
+        for (int start = 0; start < frames; start += NOISE_CHUNK) {
+            int n = frames - start < NOISE_CHUNK ? frames - start : NOISE_CHUNK;
+            Noise_Process(chunk, n, &processor->noise);
+            float* out = buffer + start * channels;
+            for (int i = 0; i < n; i++) {
+                for (int c = 0; c < channels; ++c) {
+                    out[i * channels + c] = chunk[i];
+                }
             }
+            *lastSample = chunk[n - 1];
         }
     } else {
         for (int i = 0; i < length; i += channels) {
@@ -314,7 +329,7 @@ void NoiseProcessBuffer(NoiseProcessor* processor, float* buffer, int length, in
             if (*counter > speedFrames) {
                 *updated = true;
                 *counter = 0;
-                *lastSample = processor->generate();
+                *lastSample = Noise_Next(&processor->noise);
             }
             for (int c = 0; c < channels; ++c) {
                 buffer[i + c] = *lastSample;
@@ -324,18 +339,16 @@ void NoiseProcessBuffer(NoiseProcessor* processor, float* buffer, int length, in
 }
 
 void SyncNoiseProcessor(NoiseProcessor* processor, int seed, int steps) {
-    processor->rng.seed(seed);
-    processor->rng.advance(steps);
-    processor->seed = seed;
-    processor->step = steps;
+    Noise_Seed(seed, &processor->noise);
+    Noise_Seek(steps, &processor->noise);
 }
 
 int GetCurrentSeed(NoiseProcessor* processor) {
-    return processor->seed;
+    return processor->noise.seed;
 }
 
 int GetCurrentStep(NoiseProcessor* processor) {
-    return processor->step;
+    return Noise_GetPosition(&processor->noise);
 }
 
 int DrumSignalGenerator(float buffer[], int length, int channels, bool signalOn, int counter) {
@@ -382,6 +395,15 @@ void ADSRSignalGenerator(float buffer[], int length, int channels, int frames[],
         return;
     }
 
+    /// Sustaining or finished, and the smoother has settled: the whole buffer is constant. The ADSR module uses the
+    /// segment-based generator in Envelope.h instead.
+    float hold = curFrame == 4 ? 0.f : volumes[1];
+    if ((curFrame == 4 || (curFrame == 2 && sustaining)) && settled(ADSRvolume, hold)) {
+        ADSRvolume = hold;
+        Signal_Fill(buffer, length, hold);
+        return;
+    }
+
     for (int i = 0; i < length; i += channels) {
         buffer[i + 1] = buffer[i] = ADSRvolume =
             lerp(getADSR(curFrame, startVal, frameCount, frames, volumes), ADSRvolume, .98f);
@@ -403,112 +425,61 @@ void ADSRSignalGenerator(float buffer[], int length, int channels, int frames[],
 void KeyFrequencySignalGenerator(float buffer[], int length, int channels, int semitone, float keyMultConst,
                                  float& filteredVal) {
     float val = (float) semitone / 12.f * 0.1f;
+    /// Once the follower has settled, the whole buffer is constant
+    if (settled(filteredVal, val)) {
+        filteredVal = val;
+        Signal_Fill(buffer, length, val);
+        return;
+    }
     for (int i = 0; i < length; i += channels) {
         buffer[i] = buffer[i + 1] = filteredVal =
             lerp(val, filteredVal, .9f); // lerp as eased follower, downscale 1V/Oct to 0.1V/Oct
     }
 }
 
-double ClipSignalGenerator(float buffer[], float freqExpBuffer[], float freqLinBuffer[], float ampBuffer[],
-                           float seqBuffer[], int length, float lastSeqGen[2], int channels, bool freqExpGen,
-                           bool freqLinGen, bool ampGen, bool seqGen, double floatingBufferCount, int sampleBounds[2],
-                           float playbackSpeed, float lastPlayBackSpeed, void* clip, int clipChannels, float amplitude,
-                           float lastAmplitude, bool playdirection, bool looping, double _sampleDuration,
-                           int bufferCount, bool& active, int windowLength = 0) {
-    // clip not yet or not available anymore, but wouldn't check for segmentation fault due to outdated pointer
-    if (!clip) {
-        return floatingBufferCount;
-    }
-
-    float* clipdata = reinterpret_cast<float*>(clip);
-    float sampleBoundsCenter = (sampleBounds[0] + sampleBounds[1]) * 0.5f;
-
-    for (int i = 0; i < length; i += channels) {
-
-        float endAmplitude = amplitude;
-        if (lastAmplitude != amplitude)
-            endAmplitude = lerp(lastAmplitude, amplitude, (float) i / length); // slope limiting
-        if (ampGen)
-            endAmplitude = endAmplitude * ampBuffer[i]; // -1,1, allows for ring modulation
-
-        float endPlaybackSpeed = playbackSpeed;
-        if (lastPlayBackSpeed != playbackSpeed)
-            endPlaybackSpeed = lerp(lastPlayBackSpeed, playbackSpeed, (float) i / length); // slope limiting
-
-        if (active) {
-            if (freqExpGen)
-                floatingBufferCount += endPlaybackSpeed * pow(2, _clamp(freqExpBuffer[i], -1.f, 1.f) *
-                                                                     10.f); // exp fm, upscale 0.1V/Oct to 1V/Oct
-            else
-                floatingBufferCount += endPlaybackSpeed;
-            if (freqLinGen)
-                floatingBufferCount += freqLinBuffer[i] * 20.f; // lin fm
-        }
-
-        bool endOfSample = false;
-        if (floatingBufferCount > sampleBounds[1]) {
-            endOfSample = true;
-            floatingBufferCount = fmod(floatingBufferCount - sampleBounds[0], sampleBounds[1] - sampleBounds[0]) +
-                                  sampleBounds[0] + 1; // wrap over playhead offset
-        } else if (floatingBufferCount <
-                   sampleBounds[0] + 1) // still needed? this introduces problems when resetting to 0 (instead of 1)
-                                        // while having playback speeds below 1, this will always be caught here and
-                                        // then playback stops immediately
-        {
-            endOfSample = true;
-            floatingBufferCount =
-                sampleBounds[1] - fmod(floatingBufferCount - sampleBounds[0],
-                                       sampleBounds[1] - sampleBounds[0]); // wrap over playhead offset
-        }
-
-        if (endOfSample) {
-            if (!looping)
-                active = false;
-        }
-
-        if (seqGen) {
-            if (seqBuffer[i] > 0.f && lastSeqGen[0] <= 0.f) {
-                if (playbackSpeed >= 0)
-                    floatingBufferCount = bufferCount =
-                        sampleBounds[0] +
-                        1; // WARNING: Due to the code structure in the  ClipSignalGenerator function resetting to 0
-                           // (instead of 0 + 1) would mean that playback does not work anymore for speeds lower than
-                           // 1f. It would always floor() to 0 and would not move through the file anymore.
-                else
-                    floatingBufferCount = bufferCount = sampleBounds[1];
-                active = true;
-            }
-            lastSeqGen[0] = seqBuffer[i];
-        }
-
-        float windowing = 1.f;
-        if (windowLength != 0) {
-            if (floatingBufferCount < sampleBounds[0] + windowLength && floatingBufferCount <= sampleBoundsCenter) {
-                windowing = _map(floatingBufferCount, sampleBounds[0], sampleBounds[0] + windowLength, 0.f, 1.f, 0.5f);
-            } else if (floatingBufferCount > sampleBounds[1] - windowLength) {
-                windowing = _map(floatingBufferCount, sampleBounds[1] - windowLength, sampleBounds[1], 1.f, 0.f, 0.5f);
-            } else {
-                windowing = 1.f;
-            }
-        }
-
-        if (active) {
-            // linear interpolation
-            buffer[i] = lerp(clipdata[(int) floor(floatingBufferCount) * clipChannels],
-                             clipdata[(int) ceil(floatingBufferCount) * clipChannels],
-                             fmod(floatingBufferCount, floor(floatingBufferCount))) *
-                        endAmplitude * windowing;
-            ;
-
-            if (clipChannels == 2) {
-                buffer[i + 1] = lerp(clipdata[(int) floor(floatingBufferCount) * clipChannels + 1],
-                                     clipdata[(int) ceil(floatingBufferCount) * clipChannels + 1],
-                                     fmod(floatingBufferCount, floor(floatingBufferCount))) *
-                                endAmplitude * windowing;
-            } else {
-                buffer[i + 1] = buffer[i];
-            }
-        }
+void KeyFrequencyControlGenerator(float control[], int frames, int controlRate, int semitone, float& filteredVal) {
+    float val = (float) semitone / 12.f * 0.1f;
+    float follow = powf(.9f, (float) controlRate); // the same follower as above, applied controlRate times at once
+    for (int start = 0, k = 0; start < frames; start += controlRate, k++) {
+        if (start + controlRate > frames)
+            follow = powf(.9f, (float) (frames - start));
+        control[k] = filteredVal = val + (filteredVal - val) * follow;
+    }
+}
+
+static float* offsetOrNull(float* buffer, int offset) {
+    return buffer ? buffer + offset : NULL;
+}
+
+static float expFmFactor(float cv) {
+    return powf(2, _clamp(cv, -1.f, 1.f) * 10.f); // convert 0.1V/Oct to 1V/Oct
+}
+
+double ClipSignalGeneratorControlRate(float buffer[], float freqExpControl[], float& prevFreqExpControl,
+                                      int controlRate, float freqLinBuffer[], float ampBuffer[], float seqBuffer[],
+                                      int length, float lastSeqGen[2], int channels, bool freqLinGen, bool ampGen,
+                                      bool seqGen, double floatingBufferCount, int sampleBounds[2],
+                                      float playbackSpeed, float lastPlaybackSpeed, void* clip, int clipChannels,
+                                      float amplitude, float lastAmplitude, bool playdirection, bool looping,
+                                      double _sampleDuration, int bufferCount, bool& active, int windowLength) {
+    /// Each segment is rendered with the exp fm folded into a playback speed ramp, so pow() only runs at the segment
+    /// borders.
+    int frames = length / channels;
+    float startFactor = expFmFactor(prevFreqExpControl);
+    for (int start = 0, k = 0; start < frames; start += controlRate, k++) {
+        int end = start + controlRate < frames ? start + controlRate : frames;
+        float endFactor = expFmFactor(freqExpControl[k]);
+        float t0 = (float) start / frames, t1 = (float) end / frames;
+        int offset = start * channels;
+        floatingBufferCount = ClipSignalGenerator(
+            buffer + offset, NULL, offsetOrNull(freqLinBuffer, offset), offsetOrNull(ampBuffer, offset),
+            offsetOrNull(seqBuffer, offset), (end - start) * channels, lastSeqGen, channels, false, freqLinGen, ampGen,
+            seqGen, floatingBufferCount, sampleBounds, lerp(lastPlaybackSpeed, playbackSpeed, t1) * endFactor,
+            lerp(lastPlaybackSpeed, playbackSpeed, t0) * startFactor, clip, clipChannels,
+            lerp(lastAmplitude, amplitude, t1), lerp(lastAmplitude, amplitude, t0), playdirection, looping,
+            _sampleDuration, bufferCount, active, windowLength);
+        startFactor = endFactor;
+        prevFreqExpControl = freqExpControl[k];
     }
     return floatingBufferCount;
 }
@@ -525,85 +496,31 @@ void XylophoneMergeSignalsWithoutOsc(float buf[], int length, float buf1[], floa
     }
 }
 
-void OscillatorSignalGenerator(float buffer[], int length, int channels, double& _phase, float analogWave,
-                               float frequency, float prevFrequency, float amplitude, float prevAmplitude,
-                               float& prevSyncValue, float frequencyExpBuffer[], float frequencyLinBuffer[],
-                               float amplitudeBuffer[], float syncBuffer[], float pwmBuffer[], bool bFreqExpGen,
-                               bool bFreqLinGen, bool bAmpGen, bool bSyncGen, bool bPwmGen, double _sampleDuration,
-                               double& dspTime) {
-    int waveMode = (int) roundf(analogWave * 3);
-
-    for (int i = 0; i < length; i += channels) {
-
-        // manage phase reset/sync
-        if (bSyncGen) {
-            if (syncBuffer[i] > 0.f && prevSyncValue <= 0.f)
-                _phase = 0.;
-
-            prevSyncValue = syncBuffer[i];
-        }
-
-        if (waveMode == 0) { // sine
-            buffer[i] = sin(_phase * 2 * PI);
-        } else if (waveMode == 1) { // square
-            if (bPwmGen) {
-                buffer[i] = _phase >= (pwmBuffer[i] + 1) / 2.f ? 1.f : -1.f; // expects value range -1,1f
-            } else {
-                buffer[i] = _phase >= 0.5f ? 1.f : -1.f;
-            }
-        } else if (waveMode == 2) { // saw
-            buffer[i] = _phase * 2 - 1;
-        } else { // tri
-            if (_phase <= 0.5f) {
-                buffer[i] = _phase * 2;
-            } else if (_phase > 0.5f) {
-                buffer[i] = 1 - (_phase - 0.5f) * 2;
-            }
-            buffer[i] = buffer[i] * 2 - 1; // [0,1]->[-1,1]
-        }
-
-        // frequency compute
-        float endFrequency = frequency;
-        if (prevFrequency != frequency)
-            endFrequency = lerp(prevFrequency, frequency, (float) i / length); // slope limiting
-
-        // amp compute
-        float endAmplitude = amplitude;
-        if (prevAmplitude != amplitude)
-            endAmplitude = lerp(prevAmplitude, amplitude, (float) i / length); // slope limiting
-
-        // calc control inputs
-        if (bFreqExpGen) {
-            endFrequency = endFrequency * powf(2, _clamp(frequencyExpBuffer[i], -1.f, 1.f) *
-                                                      10.f); // convert 0.1V/Oct to 1V/Oct; this has to be clamped,
-                                                             // could crash the system otherwise, think 2^320
-        }
-        if (bFreqLinGen) {
-            endFrequency = endFrequency + frequencyLinBuffer[i] * 8000.f; // add lin fm, thru zero, 1V / 100Hz
-        }
-        if (bAmpGen) {
-            endAmplitude =
-                endAmplitude *
-                amplitudeBuffer[i]; // expects 0,1 for fading, but allows for negative inputs, will invert phase then
-        }
-
-        // update phase for next sample
-        _phase += _clamp(endFrequency, -24000.f, 24000.f) * _sampleDuration; // clamp to +/- 24kHz
-
-        // wrap into [0,1) for both positive and through-zero frequencies without distorting phase
-        double wrappedPhase = _phase - floor(_phase);
-        if (wrappedPhase < 0.0) {
-            wrappedPhase += 1.0;
-        } else if (wrappedPhase >= 1.0) {
-            wrappedPhase -= 1.0;
-        }
-        _phase = wrappedPhase;
-
-        // final buffer
-        buffer[i] = buffer[i + 1] = buffer[i] * endAmplitude;
-
-        // dsptime update
-        dspTime += _sampleDuration;
+void OscillatorSignalGeneratorControlRate(float buffer[], int length, int channels, double& _phase, float analogWave,
+                                          float frequency, float prevFrequency, float amplitude, float prevAmplitude,
+                                          float& prevSyncValue, float frequencyExpControl[],
+                                          float& prevFrequencyExpControl, int controlRate, float frequencyLinBuffer[],
+                                          float amplitudeBuffer[], float syncBuffer[], float pwmBuffer[],
+                                          bool bFreqLinGen, bool bAmpGen, bool bSyncGen, bool bPwmGen,
+                                          double _sampleDuration, double& dspTime) {
+    /// Each segment is rendered with the exp fm folded into the frequency ramp, so powf() only runs at the segment
+    /// borders.
+    int frames = length / channels;
+    float startFactor = expFmFactor(prevFrequencyExpControl);
+    for (int start = 0, k = 0; start < frames; start += controlRate, k++) {
+        int end = start + controlRate < frames ? start + controlRate : frames;
+        float endFactor = expFmFactor(frequencyExpControl[k]);
+        float t0 = (float) start / frames, t1 = (float) end / frames;
+        int offset = start * channels;
+        OscillatorSignalGenerator(buffer + offset, (end - start) * channels, channels, _phase, analogWave,
+                                  lerp(prevFrequency, frequency, t1) * endFactor,
+                                  lerp(prevFrequency, frequency, t0) * startFactor, lerp(prevAmplitude, amplitude, t1),
+                                  lerp(prevAmplitude, amplitude, t0), prevSyncValue, NULL,
+                                  offsetOrNull(frequencyLinBuffer, offset), offsetOrNull(amplitudeBuffer, offset),
+                                  offsetOrNull(syncBuffer, offset), offsetOrNull(pwmBuffer, offset), false, bFreqLinGen,
+                                  bAmpGen, bSyncGen, bPwmGen, _sampleDuration, dspTime);
+        startFactor = endFactor;
+        prevFrequencyExpControl = frequencyExpControl[k];
     }
 }
 
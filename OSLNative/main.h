@@ -72,10 +72,47 @@ OSL_API double ClipSignalGenerator(float buffer[], float freqExpBuffer[], float
                                    int clipChannels, float amplitude, float lastAmplitude, bool playdirection,
                                    bool looping, double _sampleDuration, int bufferCount, bool& active,
                                    int windowLength);
+/// Same as ClipSignalGenerator(), with one of the INTERPOLATION_ modes from util.h instead of linear interpolation, and
+/// without the unused legacy parameters playdirection, _sampleDuration and bufferCount.
+OSL_API double ClipSignalGeneratorInterpolated(float buffer[], float freqExpBuffer[], float freqLinBuffer[],
+                                               float ampBuffer[], float seqBuffer[], int length, float lastSeqGen[2],
+                                               int channels, bool freqExpGen, bool freqLinGen, bool ampGen,
+                                               bool seqGen, double floatingBufferCount, int sampleBounds[2],
+                                               float playbackSpeed, float lastPlaybackSpeed, void* clip,
+                                               int clipChannels, float amplitude, float lastAmplitude, bool looping,
+                                               bool& active, int windowLength, int interpolation);
+/// Same as ClipSignalGeneratorInterpolated(), but plays a sample from the SamplePool. Plays nothing if the handle is
+/// not valid.
+OSL_API double ClipSignalGeneratorPooled(float buffer[], float freqExpBuffer[], float freqLinBuffer[],
+                                         float ampBuffer[], float seqBuffer[], int length, float lastSeqGen[2],
+                                         int channels, bool freqExpGen, bool freqLinGen, bool ampGen, bool seqGen,
+                                         double floatingBufferCount, int sampleBounds[2], float playbackSpeed,
+                                         float lastPlaybackSpeed, int sample, float amplitude, float lastAmplitude,
+                                         bool looping, bool& active, int windowLength, int interpolation);
 OSL_API void ADSRSignalGenerator(float buffer[], int length, int channels, int frames[], int& frameCount, bool active,
                                  float& ADSRvolume, float volumes[], float startVal, int& curFrame, bool sustaining);
 OSL_API void KeyFrequencySignalGenerator(float buffer[], int length, int channels, int semitone, float keyMultConst,
                                          float& filteredVal);
+
+/* Control-rate variants, see Signal.h. The exp fm input is passed as one value per controlRate frames. */
+OSL_API void KeyFrequencyControlGenerator(float control[], int frames, int controlRate, int semitone,
+                                          float& filteredVal);
+OSL_API double ClipSignalGeneratorControlRate(float buffer[], float freqExpControl[], float& prevFreqExpControl,
+                                              int controlRate, float freqLinBuffer[], float ampBuffer[],
+                                              float seqBuffer[], int length, float lastSeqGen[2], int channels,
+                                              bool freqLinGen, bool ampGen, bool seqGen, double floatingBufferCount,
+                                              int sampleBounds[2], float playbackSpeed, float lastPlaybackSpeed,
+                                              void* clip, int clipChannels, float amplitude, float lastAmplitude,
+                                              bool playdirection, bool looping, double _sampleDuration,
+                                              int bufferCount, bool& active, int windowLength);
+OSL_API void OscillatorSignalGeneratorControlRate(float buffer[], int length, int channels, double& _phase,
+                                                  float analogWave, float frequency, float prevFrequency,
+                                                  float amplitude, float prevAmplitude, float& prevSyncValue,
+                                                  float frequencyExpControl[], float& prevFrequencyExpControl,
+                                                  int controlRate, float frequencyLinBuffer[], float amplitudeBuffer[],
+                                                  float syncBuffer[], float pwmBuffer[], bool bFreqLinGen,
+                                                  bool bAmpGen, bool bSyncGen, bool bPwmGen, double _sampleDuration,
+                                                  double& dspTime);
 OSL_API void XylophoneMergeSignalsWithOsc(float buf[], int length, float buf1[], float buf2[]);
 OSL_API void XylophoneMergeSignalsWithoutOsc(float buf[], int length, float buf1[], float buf2[]);
 OSL_API void OscillatorSignalGenerator(float buffer[], int length, int channels, double& _phase, float analogWave,
@@ -76,6 +76,30 @@ void createResampleTable() {
     printv("%ff\n}", table->diff[TABLE_SIZE - 1]);*/
 }
 
+struct wsinc_polyphase {
+    float coeffs[WSINC_POLYPHASE_PHASES + 1][WSINC_POLYPHASE_TAPS];
+
+    wsinc_polyphase() {
+        for (int p = 0; p <= WSINC_POLYPHASE_PHASES; p++) {
+            float fraction = (float) p / WSINC_POLYPHASE_PHASES;
+            float sum = 0.f;
+            for (int k = 0; k < WSINC_POLYPHASE_TAPS; k++) {
+                float distance = fabsf(k - ZEROCROSSINGS_PER_AXIS - fraction) * VALUES_PER_ZEROCROSSING;
+                int i = (int) distance;
+                coeffs[p][k] = i < TABLE_SIZE - 1 ? wsinc_table[i] + (distance - i) * wsinc_diff_table[i] : 0.f;
+                sum += coeffs[p][k];
+            }
+            for (int k = 0; k < WSINC_POLYPHASE_TAPS; k++)
+                coeffs[p][k] /= sum;
+        }
+    }
+};
+
+const float* wsinc_polyphase_table() {
+    static const wsinc_polyphase table; // built on first use, thread-safe
+    return table.coeffs[0];
+}
+
 float wsinc_resample(float smpls[CONV_LENGTH], float ratio) {
     float y = 0;
     float exact_idx = 0;
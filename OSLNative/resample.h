@@ -40,6 +40,8 @@
 #define CUTOFF_FREQ_NORMALIZED 0.85
 #define CONV_LENGTH 2 * ZEROCROSSINGS_PER_AXIS + 1
 #define TABLE_SIZE (VALUES_PER_ZEROCROSSING * (ZEROCROSSINGS_PER_AXIS + 1))
+#define WSINC_POLYPHASE_TAPS (2 * (ZEROCROSSINGS_PER_AXIS + 1)) // taps -11 to 12 around the left sample
+#define WSINC_POLYPHASE_PHASES 256                              // rows of the polyphase table, interpolated in between
 
 typedef struct _sincTable {
     float val[TABLE_SIZE];
@@ -52,12 +54,22 @@ typedef struct _sincTable {
 extern "C" {
 #endif
 
+/* The windowed sinc from 0 to ZEROCROSSINGS_PER_AXIS + 1 zero crossings, and the difference to the next value. */
+extern float wsinc_table[TABLE_SIZE];
+extern float wsinc_diff_table[TABLE_SIZE];
+
 void createResampleTable();
 /* ratio must be in range [-1...1]. */
 float wsinc_resample(float smpls[CONV_LENGTH], float ratio);
 // A global buffer you can use to store the input samples so you don't have to allocate extra memory for it.
 extern float wsinc_convBuffer[CONV_LENGTH];
 
+/* Polyphase version of wsinc_table: row p holds the WSINC_POLYPHASE_TAPS coefficients for the fraction
+ p / WSINC_POLYPHASE_PHASES, for p = 0 ... WSINC_POLYPHASE_PHASES, so that they are read contiguously instead of being
+ looked up tap by tap. Every row is normalised to unity gain at DC, so a constant signal does not ripple with the
+ fraction. Built on first use, thread-safe. */
+const float* wsinc_polyphase_table();
+
 #ifdef __cplusplus
 }
 #endif
@@ -64,6 +64,9 @@
 #define INTERPOLATION_NONE 1
 #define INTERPOLATION_LINEAR 2
 #define INTERPOLATION_WSINC 3
+#define INTERPOLATION_CUBIC 4
+#define INTERPOLATION_LAGRANGE 5 // 3rd order, only DELAYMODE_FRACTIONAL
+#define INTERPOLATION_ALLPASS 6  // 1st order, only DELAYMODE_FRACTIONAL
 
 #ifdef __cplusplus
 extern "C" {